@@ -0,0 +1,174 @@
+/*
+ * Binary control API (wled00/binapi.h): validation and parse cost compared to JSON
+ * Run with: pio test -e native -f test_binapi
+ */
+
+#include <unity.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include "../../wled00/src/dependencies/json/ArduinoJson-v6.h"
+#include "../../wled00/binapi.h"
+
+// on, bri, tt, segment 0 (color, effect, speed, intensity, palette), segment 1 (bounds, color)
+static const uint8_t packet[] = {
+  BINAPI_MAGIC, BINAPI_VERSION, 0,
+  BIN_ON, 1, 1,
+  BIN_BRI, 1, 128,
+  BIN_TT, 2, 5, 0,
+  BIN_SEG, 19, 0,
+    BIN_S_COLOR, 4, 0, 255, 0, 0,
+    BIN_S_FX, 1, 9,
+    BIN_S_SPEED, 1, 150,
+    BIN_S_INTENSITY, 1, 100,
+    BIN_S_PALETTE, 1, 3,
+  BIN_SEG, 13, 1,
+    BIN_S_BOUNDS, 4, 0, 0, 60, 0,
+    BIN_S_COLOR, 4, 0, 0, 0, 255,
+};
+
+// the same command as JSON API request
+static const char json[] =
+  "{\"on\":true,\"bri\":128,\"tt\":5,\"seg\":[{\"id\":0,\"col\":[[255,0,0]],\"fx\":9,\"sx\":150,\"ix\":100,\"pal\":3},"
+  "{\"id\":1,\"start\":0,\"stop\":60,\"col\":[[0,0,255]]}]}";
+
+struct Cmd {
+  uint8_t on, bri, fx[2], sx[2], ix[2], pal[2];
+  uint16_t tt, start[2], stop[2];
+  uint32_t col[2];
+};
+
+static bool parseBin(const uint8_t *data, size_t len, Cmd &c) {
+  if (binValidate(data, len) != BINAPI_OK) return false;
+  BinReader rd(data + BINAPI_HEADER_LEN, len - BINAPI_HEADER_LEN);
+  uint8_t type, vlen;
+  const uint8_t *v;
+  while (rd.next(type, v, vlen)) {
+    switch (type) {
+      case BIN_ON:  c.on  = v[0]; break;
+      case BIN_BRI: c.bri = v[0]; break;
+      case BIN_TT:  c.tt  = binU16(v); break;
+      case BIN_SEG: {
+        uint8_t id = v[0] & 1;
+        BinReader srd(v + 1, vlen - 1);
+        uint8_t st, sl;
+        const uint8_t *sv;
+        while (srd.next(st, sv, sl)) {
+          switch (st) {
+            case BIN_S_BOUNDS:    c.start[id] = binU16(sv); c.stop[id] = binU16(sv+2); break;
+            case BIN_S_COLOR:     c.col[id] = (sv[1] << 16) | (sv[2] << 8) | sv[3]; break;
+            case BIN_S_FX:        c.fx[id]  = sv[0]; break;
+            case BIN_S_SPEED:     c.sx[id]  = sv[0]; break;
+            case BIN_S_INTENSITY: c.ix[id]  = sv[0]; break;
+            case BIN_S_PALETTE:   c.pal[id] = sv[0]; break;
+          }
+        }
+        break;
+      }
+    }
+  }
+  return true;
+}
+
+// what deserializeState() does before applying: parse into the JSON document, look up the members
+static bool parseJson(JsonDocument &doc, Cmd &c) {
+  if (deserializeJson(doc, json, sizeof(json) - 1)) return false;
+  JsonObject root = doc.as<JsonObject>();
+  c.on  = root["on"] | false;
+  c.bri = root["bri"] | 0;
+  c.tt  = root["tt"] | 0;
+  for (JsonObject s : root["seg"].as<JsonArray>()) {
+    uint8_t id = (s["id"] | 0) & 1;
+    c.start[id] = s["start"] | 0;
+    c.stop[id]  = s["stop"] | 0;
+    JsonArray col = s["col"][0];
+    if (!col.isNull()) c.col[id] = ((uint8_t)col[0] << 16) | ((uint8_t)col[1] << 8) | (uint8_t)col[2];
+    c.fx[id]  = s["fx"] | 0;
+    c.sx[id]  = s["sx"] | 0;
+    c.ix[id]  = s["ix"] | 0;
+    c.pal[id] = s["pal"] | 0;
+  }
+  return true;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_parse_equivalent(void) {
+  Cmd b, j;
+  memset(&b, 0, sizeof(b));
+  memset(&j, 0, sizeof(j));
+  DynamicJsonDocument doc(2048);
+  TEST_ASSERT_TRUE(parseBin(packet, sizeof(packet), b));
+  TEST_ASSERT_TRUE(parseJson(doc, j));
+  TEST_ASSERT_EQUAL_MEMORY(&j, &b, sizeof(Cmd));
+  TEST_ASSERT_EQUAL(0xFF0000, b.col[0]);
+  TEST_ASSERT_EQUAL(60, b.stop[1]);
+}
+
+void test_header(void) {
+  uint8_t p[] = {BINAPI_MAGIC, BINAPI_VERSION, 0};
+  TEST_ASSERT_EQUAL(BINAPI_OK, binValidate(p, sizeof(p)));
+  TEST_ASSERT_EQUAL(BINAPI_ERR_FORMAT, binValidate(p, 2));
+  p[0] = '{';
+  TEST_ASSERT_EQUAL(BINAPI_ERR_FORMAT, binValidate(p, sizeof(p)));
+  p[0] = BINAPI_MAGIC; p[1] = BINAPI_VERSION + 1;
+  TEST_ASSERT_EQUAL(BINAPI_ERR_VERSION, binValidate(p, sizeof(p)));
+}
+
+// nothing is applied from a packet cut off anywhere inside a record
+void test_truncated(void) {
+  size_t ends[] = {3, 6, 9, 13, 34, sizeof(packet)}; // record boundaries
+  for (size_t len = 3; len <= sizeof(packet); len++) {
+    bool boundary = false;
+    for (size_t e : ends) boundary |= e == len;
+    TEST_ASSERT_EQUAL_MESSAGE(boundary ? BINAPI_OK : BINAPI_ERR_FORMAT, binValidate(packet, len), "length");
+  }
+}
+
+void test_short_value(void) {
+  uint8_t p[] = {BINAPI_MAGIC, BINAPI_VERSION, 0, BIN_TT, 1, 5};
+  TEST_ASSERT_EQUAL(BINAPI_ERR_FORMAT, binValidate(p, sizeof(p)));
+  uint8_t s[] = {BINAPI_MAGIC, BINAPI_VERSION, 0, BIN_SEG, 4, 0, BIN_S_COLOR, 1, 0};
+  TEST_ASSERT_EQUAL(BINAPI_ERR_FORMAT, binValidate(s, sizeof(s)));
+  uint8_t n[] = {BINAPI_MAGIC, BINAPI_VERSION, 0, BIN_SEG, 4, 0, BIN_S_FX, 2, 9}; // nested record exceeds segment
+  TEST_ASSERT_EQUAL(BINAPI_ERR_FORMAT, binValidate(n, sizeof(n)));
+}
+
+void test_unknown_skipped(void) {
+  uint8_t p[] = {BINAPI_MAGIC, BINAPI_VERSION, 0, 0x7F, 3, 1, 2, 3, BIN_BRI, 1, 42};
+  TEST_ASSERT_EQUAL(BINAPI_OK, binValidate(p, sizeof(p)));
+  Cmd c = {};
+  TEST_ASSERT_TRUE(parseBin(p, sizeof(p), c));
+  TEST_ASSERT_EQUAL(42, c.bri);
+}
+
+// parsing a binary command must cost at least 10x less than parsing the JSON one
+void test_parse_cost(void) {
+  const int runs = 20000;
+  DynamicJsonDocument doc(2048);
+  volatile uint32_t sink = 0;
+  Cmd c;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < runs; i++) { c = {}; parseBin(packet, sizeof(packet), c); sink += c.col[1]; }
+  auto t1 = std::chrono::steady_clock::now();
+  for (int i = 0; i < runs; i++) { c = {}; parseJson(doc, c); sink += c.col[1]; }
+  auto t2 = std::chrono::steady_clock::now();
+  double bin = std::chrono::duration<double, std::nano>(t1 - t0).count() / runs;
+  double js  = std::chrono::duration<double, std::nano>(t2 - t1).count() / runs;
+  char msg[128];
+  snprintf(msg, sizeof(msg), "binary %.0f ns (%u bytes), JSON %.0f ns (%u bytes), %.1fx", bin, (unsigned)sizeof(packet), js, (unsigned)sizeof(json) - 1, js / bin);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_TRUE(js >= 10 * bin);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_parse_equivalent);
+  RUN_TEST(test_header);
+  RUN_TEST(test_truncated);
+  RUN_TEST(test_short_value);
+  RUN_TEST(test_unknown_skipped);
+  RUN_TEST(test_parse_cost);
+  return UNITY_END();
+}
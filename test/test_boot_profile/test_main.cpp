@@ -0,0 +1,81 @@
+/*
+ * Boot phase timestamps (wled00/boot_profile.h): replayed boot records each phase once, in order
+ * Run with: pio test -e native -f test_boot_profile
+ */
+
+#include <unity.h>
+#include "../../wled00/src/dependencies/json/ArduinoJson-v6.h"
+#include "../../wled00/boot_profile.h"
+
+static uint32_t now;
+static int deferredRuns;
+
+// first loop iterations as WLED::loop() does them, network connects at connectAt and drops at dropAt
+static void loops(BootProfile &bt, int n, int connectAt, int dropAt) {
+  bool connected = false;
+  for (int i = 0; i < n; i++, now += 8) {
+    if (!bt.reached(BOOT_DEFERRED)) {
+      deferredRuns++;
+      now += 40; // ledmap names
+      bt.mark(BOOT_DEFERRED, now);
+    }
+    if (i == dropAt) connected = false;
+    else if (i >= connectAt && !connected) { connected = true; bt.mark(BOOT_NETWORK, now); }
+  }
+}
+
+void setUp(void) { now = 0; deferredRuns = 0; }
+void tearDown(void) {}
+
+// WLED::setup() order, phases end in increasing order and after setup() only deferred and network follow
+void test_boot_sequence(void) {
+  BootProfile bt;
+  const uint8_t setupPhases[] = {BOOT_FS, BOOT_CFG, BOOT_STRIP, BOOT_FRAME, BOOT_USERMODS, BOOT_SETUP};
+  const uint32_t cost[] = {60, 15, 20, 5, 30, 80};
+  for (size_t i = 0; i < sizeof(setupPhases); i++) {
+    TEST_ASSERT_FALSE(bt.reached(setupPhases[i]));
+    now += cost[i];
+    TEST_ASSERT_TRUE(bt.mark(setupPhases[i], now));
+  }
+  TEST_ASSERT_FALSE(bt.reached(BOOT_DEFERRED));
+  TEST_ASSERT_FALSE(bt.reached(BOOT_NETWORK));
+  TEST_ASSERT_EQUAL(100, bt[BOOT_FRAME]);   // first frame before usermods and web server
+  loops(bt, 500, 200, 300);                 // network drops and reconnects
+  TEST_ASSERT_EQUAL(1, deferredRuns);
+  for (uint8_t p = 1; p < BOOT_PHASES; p++) TEST_ASSERT_GREATER_THAN(bt[p-1], bt[p]);
+  TEST_ASSERT_EQUAL(210 + 40 + 200*8, bt[BOOT_NETWORK]); // first connection (loop 200), not the reconnect
+}
+
+// a phase is recorded once, later marks (reconnect, bus re-initialization) are ignored
+void test_mark_once(void) {
+  BootProfile bt;
+  TEST_ASSERT_TRUE(bt.mark(BOOT_NETWORK, 1500));
+  TEST_ASSERT_FALSE(bt.mark(BOOT_NETWORK, 90000));
+  TEST_ASSERT_EQUAL(1500, bt[BOOT_NETWORK]);
+  TEST_ASSERT_TRUE(bt.mark(BOOT_FS, 0));    // at power-up still counts as reached
+  TEST_ASSERT_TRUE(bt.reached(BOOT_FS));
+  TEST_ASSERT_FALSE(bt.mark(BOOT_PHASES, 5));
+  TEST_ASSERT_FALSE(bt.reached(BOOT_PHASES));
+  TEST_ASSERT_EQUAL(0, bt[BOOT_PHASES]);
+}
+
+// /json/info "boot": one entry per phase, 0 for phases not reached yet
+void test_info(void) {
+  BootProfile bt;
+  bt.mark(BOOT_FS, 60);
+  bt.mark(BOOT_CFG, 75);
+  bt.mark(BOOT_NETWORK, 2100);
+  DynamicJsonDocument doc(512);
+  bt.addTo(doc.createNestedArray("boot"));
+  char out[64];
+  serializeJson(doc, out, sizeof(out));
+  TEST_ASSERT_EQUAL_STRING(R"({"boot":[60,75,0,0,0,0,0,2100]})", out);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_boot_sequence);
+  RUN_TEST(test_mark_once);
+  RUN_TEST(test_info);
+  return UNITY_END();
+}
@@ -0,0 +1,114 @@
+/*
+ * Effect & palette catalogs (wled00/catalog_cache.h): ETag revalidation and cache invalidation
+ * Run with: pio test -e native -f test_catalog_cache
+ */
+
+#include <unity.h>
+#include <string.h>
+#include <stdlib.h>
+#include "../../wled00/catalog_cache.h"
+
+#define ENTRIES 4
+#define PATH_EFFECTS  8 // JSON_PATH_* (json.cpp)
+#define PATH_PALETTES 5
+
+static CatalogEntry cache[ENTRIES];
+
+// getCatalogEntry() without the serialization
+static CatalogEntry* get(uint16_t version, uint8_t path, int16_t page, bool &hit) {
+  CatalogEntry *entry;
+  CatalogEntry *cached = findCatalogEntry(cache, ENTRIES, version, path, page, entry);
+  hit = cached != nullptr;
+  if (cached) return cached;
+  if (!entry) return nullptr;
+  entry->data = strdup("[]");
+  entry->len = 2;
+  entry->version = version;
+  entry->path = path;
+  entry->page = page;
+  entry->users = 0;
+  return entry;
+}
+
+void setUp(void) { memset(cache, 0, sizeof(cache)); }
+void tearDown(void) { for (CatalogEntry &e : cache) free(e.data); }
+
+void test_etag_format(void) {
+  char etag[CATALOG_ETAG_LEN];
+  formatCatalogETag(etag, 2404120, 0xbeef, 3);
+  TEST_ASSERT_EQUAL_STRING("\"2404120-beef-0003\"", etag);
+  formatCatalogETag(etag, 4294967295u, 0xFFFF, 0xFFFF); // longest possible
+  TEST_ASSERT_EQUAL_STRING("\"4294967295-ffff-ffff\"", etag);
+}
+
+// 304 only if the client has the current catalog
+void test_etag_match(void) {
+  const char *etag = "\"2404120-beef-0003\"";
+  TEST_ASSERT_TRUE(catalogETagMatches("\"2404120-beef-0003\"", etag));
+  TEST_ASSERT_TRUE(catalogETagMatches("W/\"2404120-beef-0003\"", etag));       // weak comparison
+  TEST_ASSERT_TRUE(catalogETagMatches("\"x\", \"2404120-beef-0003\"", etag));  // list
+  TEST_ASSERT_TRUE(catalogETagMatches("\"x\",W/\"2404120-beef-0003\" ", etag));
+  TEST_ASSERT_TRUE(catalogETagMatches("*", etag));
+  TEST_ASSERT_FALSE(catalogETagMatches("\"2404120-beef-0002\"", etag));       // custom palettes reloaded
+  TEST_ASSERT_FALSE(catalogETagMatches("\"2404120-cafe-0003\"", etag));       // rebooted
+  TEST_ASSERT_FALSE(catalogETagMatches("2404120-beef-0003", etag));           // unquoted
+  TEST_ASSERT_FALSE(catalogETagMatches("\"2404120-beef-0003", etag));
+  TEST_ASSERT_FALSE(catalogETagMatches("", etag));
+  TEST_ASSERT_FALSE(catalogETagMatches(nullptr, etag));
+}
+
+// catalogs and palette pages are cached separately and served from RAM until the version changes
+void test_hit_miss(void) {
+  bool hit;
+  CatalogEntry *fx = get(1, PATH_EFFECTS, 0, hit);
+  TEST_ASSERT_FALSE(hit);
+  TEST_ASSERT_TRUE(get(1, PATH_EFFECTS, 0, hit) == fx);
+  TEST_ASSERT_TRUE(hit);
+  CatalogEntry *p0 = get(1, PATH_PALETTES, 0, hit);
+  TEST_ASSERT_FALSE(hit);
+  CatalogEntry *p1 = get(1, PATH_PALETTES, 1, hit);
+  TEST_ASSERT_FALSE(hit);
+  TEST_ASSERT_TRUE(p0 != p1 && p0 != fx);
+  TEST_ASSERT_TRUE(get(1, PATH_PALETTES, 1, hit) == p1);
+  TEST_ASSERT_TRUE(hit);
+}
+
+// a version change frees stale entries, except those still being sent
+void test_invalidation(void) {
+  bool hit;
+  CatalogEntry *fx = get(1, PATH_EFFECTS, 0, hit);
+  CatalogEntry *pal = get(1, PATH_PALETTES, 0, hit);
+  pal->users = 1; // response in progress
+  CatalogEntry *fx2 = get(2, PATH_EFFECTS, 0, hit);
+  TEST_ASSERT_FALSE(hit);
+  TEST_ASSERT_TRUE(fx2 == fx); // stale entry was freed and reused
+  TEST_ASSERT_EQUAL(2, fx2->version);
+  TEST_ASSERT_NOT_NULL(pal->data);
+  TEST_ASSERT_EQUAL(1, pal->version);
+  CatalogEntry *pal2 = get(2, PATH_PALETTES, 0, hit);
+  TEST_ASSERT_FALSE(hit);
+  TEST_ASSERT_TRUE(pal2 != pal);
+  pal->users = 0; // response finished
+  get(2, PATH_PALETTES, 0, hit);
+  TEST_ASSERT_TRUE(hit);
+  TEST_ASSERT_NULL(pal->data);
+}
+
+// all entries in use: not cached, served by the regular path
+void test_full(void) {
+  bool hit;
+  for (int i = 0; i < ENTRIES; i++) TEST_ASSERT_NOT_NULL(get(1, PATH_PALETTES, i, hit));
+  TEST_ASSERT_NULL(get(1, PATH_PALETTES, ENTRIES, hit));
+  TEST_ASSERT_NOT_NULL(get(1, PATH_PALETTES, 0, hit));
+  TEST_ASSERT_TRUE(hit);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_etag_format);
+  RUN_TEST(test_etag_match);
+  RUN_TEST(test_hit_miss);
+  RUN_TEST(test_invalidation);
+  RUN_TEST(test_full);
+  return UNITY_END();
+}
@@ -0,0 +1,79 @@
+/*
+ * cfg.json read filter (wled00/cfg_filter.h): everything deserializeConfig() reads passes in a single pass
+ * Run with: pio test -e native -f test_cfg_filter
+ */
+
+#include <unity.h>
+#include "../../wled00/src/dependencies/json/ArduinoJson-v6.h"
+#include "../../wled00/cfg_filter.h"
+
+// cfg.json as written by serializeConfig() with all optional sections (shortened), two LED outputs and two usermods
+static const char cfg[] = R"({"rev":[1,0],"vid":2404120,"id":{"mdns":"wled-desk","name":"Desk","inv":"Light","sui":false},
+"nw":{"ins":[{"ssid":"home","pskl":12,"ip":[0,0,0,0],"gw":[0,0,0,0],"sn":[255,255,255,0]}]},
+"ap":{"ssid":"WLED-AP","pskl":8,"chan":1,"hide":0,"behav":0,"ip":[4,3,2,1]},"wifi":{"sleep":true,"phy":false},"eth":{"type":0},
+"hw":{"led":{"total":180,"maxpwr":850,"ledma":55,"cct":false,"cr":false,"cb":0,"fps":42,"rgbwm":255,"ld":true,
+"ins":[{"start":0,"len":120,"pin":[16],"order":0,"rev":false,"skip":0,"type":22,"ref":false,"rgbwm":0,"freq":0,"maxpwr":0,"ledma":55},
+{"start":120,"len":60,"pin":[17],"order":1,"rev":true,"skip":1,"type":22,"ref":false,"rgbwm":0,"freq":0,"maxpwr":0,"ledma":55}]},
+"com":[],"btn":{"max":4,"pull":true,"ins":[{"type":2,"pin":[0],"macros":[0,0,0]}],"tt":32,"mqtt":false},
+"ir":{"pin":-1,"type":0,"sel":true},"relay":{"pin":12,"rev":true},"baud":1152,"if":{"i2c-pin":[-1,-1],"spi-pin":[-1,-1,-1]}},
+"light":{"scale-bri":100,"pal-mode":0,"aseg":false,"gc":{"bri":1,"col":2.8,"val":2.8},"tr":{"mode":true,"fx":true,"dur":7,"pal":0,"rpc":5},
+"nl":{"mode":1,"dur":60,"tbri":0,"macro":0}},"def":{"ps":0,"on":true,"bri":128},
+"if":{"sync":{"port0":21324,"port1":65506,"recv":{"bri":true,"col":true,"fx":true,"grp":1,"seg":false,"sb":false},"send":{"dir":false,"btn":false,"va":false,"hue":true,"macro":false,"grp":1,"ret":0}},
+"nodes":{"list":true,"bcast":true},"live":{"en":true,"mso":true,"port":5568,"mc":false,"dmx":{"uni":1,"seqskip":false,"e131prio":0,"addr":1,"dss":0,"mode":4},"timeout":25,"maxbri":false,"no-gc":true,"offset":0},
+"va":{"alexa":false,"macros":[0,0],"p":0},"mqtt":{"en":false,"broker":"","port":1883,"user":"","pskl":0,"cid":"WLED-1","rtn":false,"topics":{"device":"wled/1","group":"wled/all"}},
+"hue":{"en":false,"id":1,"iv":25,"recv":{"on":true,"bri":true,"col":true},"ip":[0,0,0,0]},"ntp":{"en":false,"host":"0.wled.pool.ntp.org","tz":0,"offset":0,"ampm":false,"ln":0,"lt":0}},
+"ol":{"clock":0,"cntdwn":false,"min":0,"max":29,"o12pix":0,"o5m":false,"osec":false},
+"timers":{"cntdwn":{"goal":[20,1,1,0,0,0],"macro":0},"ins":[{"en":1,"hour":7,"min":30,"macro":3,"dow":127,"start":{"mon":1,"day":1},"end":{"mon":12,"day":31}}]},
+"remote":{"remote_enabled":false,"linked_remote":""},"ota":{"lock":false,"lock-wifi":false,"pskl":7,"aota":true},
+"dmx":{"chan":3,"gap":3,"start":1,"start-led":0,"fixmap":[1,2,3,0,0,0,0,0,0,0,0,0,0,0,0],"e131proxy":0},
+"um":{"AudioReactive":{"enabled":true,"analogmic":{"pin":36},"config":{"squelch":10,"gain":60,"AGC":0}},"Temperature":{"enabled":true,"pin":14,"rev":true}}})";
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_single_pass(void) {
+  DynamicJsonDocument full(16384), filtered(16384), filter(CFG_FILTER_SIZE);
+  cfgReadFilter(filter);
+  TEST_ASSERT_FALSE(filter.overflowed());
+  TEST_ASSERT_TRUE(deserializeJson(full, cfg) == DeserializationError::Ok);
+  TEST_ASSERT_TRUE(deserializeJson(filtered, cfg, DeserializationOption::Filter(filter)) == DeserializationError::Ok);
+
+  // the filtered document is the full one without the version info
+  full.remove("rev");
+  full.remove("vid");
+  TEST_ASSERT_TRUE(full == filtered);
+}
+
+// members of the same name on deeper levels (bus "rev", relay "rev", usermods) are kept
+void test_nested_names_kept(void) {
+  DynamicJsonDocument doc(16384), filter(CFG_FILTER_SIZE);
+  cfgReadFilter(filter);
+  deserializeJson(doc, cfg, DeserializationOption::Filter(filter));
+  TEST_ASSERT_TRUE(doc["hw"]["led"]["ins"][1]["rev"].as<bool>());
+  TEST_ASSERT_EQUAL(2, doc["hw"]["led"]["ins"].size());
+  TEST_ASSERT_TRUE(doc["hw"]["relay"]["rev"].as<bool>());
+  TEST_ASSERT_EQUAL(14, doc["um"]["Temperature"]["pin"].as<int>());
+  TEST_ASSERT_TRUE(doc["um"]["Temperature"]["rev"].as<bool>());
+  TEST_ASSERT_EQUAL(60, doc["um"]["AudioReactive"]["config"]["gain"].as<int>());
+  TEST_ASSERT_FALSE(doc.containsKey("vid"));
+}
+
+// a configuration of an older release with missing and unknown sections
+void test_old_config(void) {
+  DynamicJsonDocument doc(1024), filter(CFG_FILTER_SIZE);
+  cfgReadFilter(filter);
+  deserializeJson(doc, R"({"vid":2203150,"def":{"bri":10},"hw":{"led":{"total":30}},"legacy":{"a":[1,2,3]}})", DeserializationOption::Filter(filter));
+  TEST_ASSERT_EQUAL(10, doc["def"]["bri"].as<int>());
+  TEST_ASSERT_EQUAL(30, doc["hw"]["led"]["total"].as<int>());
+  TEST_ASSERT_FALSE(doc.containsKey("vid"));
+  TEST_ASSERT_FALSE(doc.containsKey("legacy"));
+  TEST_ASSERT_EQUAL(2, doc.size());
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_single_pass);
+  RUN_TEST(test_nested_names_kept);
+  RUN_TEST(test_old_config);
+  return UNITY_END();
+}
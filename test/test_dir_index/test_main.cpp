@@ -0,0 +1,92 @@
+/*
+ * Directory index (wled00/dir_index.h): lookups agree with the directory, or defer to exists()
+ * Run with: pio test -e native -f test_dir_index
+ */
+
+#include <unity.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "../../wled00/dir_index.h"
+
+// root directory as listed by the file system (names with or without leading slash)
+static void scan(DirIndex<8> &idx, const std::vector<std::string> &files) {
+  uint8_t gen = idx.beginScan();
+  for (auto &f : files) idx.add(f.c_str());
+  TEST_ASSERT_TRUE(idx.endScan(gen));
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// ESP8266 and ESP32 core 3.x list "/name", ESP32 core 2.x "name"
+void test_hash_leading_slash(void) {
+  TEST_ASSERT_EQUAL(DirIndex<8>::hash("/cfg.json"), DirIndex<8>::hash("cfg.json"));
+  TEST_ASSERT_NOT_EQUAL(DirIndex<8>::hash("/ledmap1.json"), DirIndex<8>::hash("/ledmap2.json"));
+}
+
+// existing files are found, others reported missing without touching the file system
+void test_lookup(void) {
+  DirIndex<8> idx;
+  TEST_ASSERT_EQUAL(DIR_INDEX_UNKNOWN, idx.lookup("/cfg.json")); // not built yet
+  scan(idx, {"cfg.json", "presets.json", "/ledmap1.json", "palette0.json"});
+  TEST_ASSERT_EQUAL(4, idx.size());
+  TEST_ASSERT_EQUAL(DIR_INDEX_FOUND, idx.lookup("/cfg.json"));
+  TEST_ASSERT_EQUAL(DIR_INDEX_FOUND, idx.lookup("/ledmap1.json"));
+  for (int i = 2; i < 10; i++) {
+    char f[16];
+    snprintf(f, sizeof(f), "/ledmap%d.json", i);
+    TEST_ASSERT_EQUAL(DIR_INDEX_MISSING, idx.lookup(f));
+  }
+  TEST_ASSERT_EQUAL(DIR_INDEX_UNKNOWN, idx.lookup("/www/index.htm")); // subdirectories are not indexed
+  TEST_ASSERT_EQUAL(DIR_INDEX_UNKNOWN, idx.lookup("cfg.json"));
+}
+
+// with more files than fit, hits are still certain but misses are not
+void test_full(void) {
+  DirIndex<8> idx;
+  std::vector<std::string> files;
+  for (int i = 0; i < 12; i++) files.push_back("/file" + std::to_string(i) + ".json");
+  scan(idx, files);
+  TEST_ASSERT_EQUAL(8, idx.size());
+  TEST_ASSERT_EQUAL(DIR_INDEX_FOUND, idx.lookup("/file0.json"));
+  TEST_ASSERT_EQUAL(DIR_INDEX_UNKNOWN, idx.lookup("/file11.json"));
+  TEST_ASSERT_EQUAL(DIR_INDEX_UNKNOWN, idx.lookup("/nothere.json"));
+  scan(idx, {"/cfg.json"});             // rebuilt with fewer files
+  TEST_ASSERT_EQUAL(DIR_INDEX_MISSING, idx.lookup("/nothere.json"));
+}
+
+// invalidate() (upload, /edit, remove) defers to exists() until the next scan
+void test_invalidate(void) {
+  DirIndex<8> idx;
+  scan(idx, {"/cfg.json"});
+  idx.invalidate();
+  TEST_ASSERT_FALSE(idx.valid());
+  TEST_ASSERT_EQUAL(DIR_INDEX_UNKNOWN, idx.lookup("/cfg.json"));
+  TEST_ASSERT_EQUAL(DIR_INDEX_UNKNOWN, idx.lookup("/presets.json"));
+  scan(idx, {"/cfg.json", "/presets.json"});
+  TEST_ASSERT_EQUAL(DIR_INDEX_FOUND, idx.lookup("/presets.json"));
+}
+
+// a file created while the directory is scanned (async web server task) may be missing from the scan,
+// so the index stays invalid and is built again
+void test_invalidated_during_scan(void) {
+  DirIndex<8> idx;
+  uint8_t gen = idx.beginScan();
+  idx.add("/cfg.json");
+  idx.invalidate();                     // upload of /presets.json finished
+  TEST_ASSERT_FALSE(idx.endScan(gen));
+  TEST_ASSERT_EQUAL(DIR_INDEX_UNKNOWN, idx.lookup("/presets.json"));
+  scan(idx, {"/cfg.json", "/presets.json"});
+  TEST_ASSERT_EQUAL(DIR_INDEX_FOUND, idx.lookup("/presets.json"));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_hash_leading_slash);
+  RUN_TEST(test_lookup);
+  RUN_TEST(test_full);
+  RUN_TEST(test_invalidate);
+  RUN_TEST(test_invalidated_during_scan);
+  return UNITY_END();
+}
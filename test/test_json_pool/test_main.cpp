@@ -0,0 +1,92 @@
+/*
+ * JSON document pool ownership (wled00/json_pool.h): lease policy of acquireJsonDocument()
+ * Run with: pio test -e native -f test_json_pool
+ */
+
+#include <unity.h>
+#include "../../wled00/json_pool.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// single document (ESP8266, ESP32 without PSRAM): leases and the global "doc" exclude each other
+void test_single_document(void) {
+  JsonPoolOwners<1> pool;
+  TEST_ASSERT_EQUAL(1, pool.count(false));
+  TEST_ASSERT_EQUAL(0, pool.claim(10, true, false));
+  TEST_ASSERT_EQUAL(10, pool.owner(0));
+  TEST_ASSERT_EQUAL(-1, pool.claim(11, true, true));
+  TEST_ASSERT_EQUAL(-1, pool.claim(12, false, false));
+  TEST_ASSERT_EQUAL(0, pool.count(true));
+  pool.release(0);
+  TEST_ASSERT_EQUAL(0, pool.claim(11, true, true));
+}
+
+// leases prefer additional documents so state consumers (primary) still get the global one
+void test_additional_preferred(void) {
+  JsonPoolOwners<3> pool;
+  pool.setPresent(1, true);
+  pool.setPresent(2, true);
+  TEST_ASSERT_EQUAL(3, pool.count(true));
+  TEST_ASSERT_EQUAL(2, pool.claim(10, false, false));
+  TEST_ASSERT_EQUAL(1, pool.claim(11, false, false));
+  TEST_ASSERT_EQUAL(0, pool.claim(12, true, true));
+  TEST_ASSERT_EQUAL(-1, pool.claim(13, true, false));
+  pool.release(1);
+  TEST_ASSERT_EQUAL(-1, pool.claim(13, true, true)); // primary only takes the global one
+  TEST_ASSERT_EQUAL(1, pool.claim(13, true, false));
+}
+
+// failed allocation at boot (no PSRAM): slot is never handed out
+void test_missing_document(void) {
+  JsonPoolOwners<2> pool;
+  pool.setPresent(1, false);
+  TEST_ASSERT_EQUAL(1, pool.count(false));
+  TEST_ASSERT_EQUAL(0, pool.claim(10, true, false));
+  TEST_ASSERT_EQUAL(-1, pool.claim(11, true, false));
+}
+
+// a waiting loop consumer blocks network callbacks, not other loop consumers
+void test_loop_priority(void) {
+  JsonPoolOwners<2> pool;
+  pool.setPresent(1, true);
+  TEST_ASSERT_EQUAL(0, pool.claim(10, true, true));  // e.g. config save holds "doc"
+  pool.waitBegin();                                   // preset load waits for "doc"
+  TEST_ASSERT_EQUAL(-1, pool.claim(20, false, false)); // /json request: must not take the free document
+  TEST_ASSERT_EQUAL(1, pool.claim(21, true, false));  // loop lease is served
+  pool.release(1);
+  pool.waitEnd();
+  TEST_ASSERT_EQUAL(1, pool.claim(20, false, false));
+  pool.waitEnd(); // unbalanced, must not underflow
+  pool.release(0);
+  TEST_ASSERT_EQUAL(0, pool.claim(22, false, true));
+}
+
+// random sequence of leases and releases by loop and network consumers: no document is held twice
+void test_exclusive(void) {
+  JsonPoolOwners<3> pool;
+  pool.setPresent(1, true);
+  pool.setPresent(2, true);
+  int8_t held[8];
+  for (int i = 0; i < 8; i++) held[i] = -1;
+  unsigned seed = 45;
+  for (int n = 0; n < 100000; n++) {
+    seed = seed * 1103515245 + 12345;
+    int m = (seed >> 16) % 8;
+    if (held[m] >= 0) { pool.release(held[m]); held[m] = -1; continue; }
+    held[m] = pool.claim(m+1, m < 4, m == 0);
+    if (held[m] < 0) continue;
+    for (int o = 0; o < 8; o++) if (o != m) TEST_ASSERT_TRUE(held[o] != held[m]);
+    TEST_ASSERT_EQUAL(m+1, pool.owner(held[m]));
+  }
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_single_document);
+  RUN_TEST(test_additional_preferred);
+  RUN_TEST(test_missing_document);
+  RUN_TEST(test_loop_priority);
+  RUN_TEST(test_exclusive);
+  return UNITY_END();
+}
@@ -0,0 +1,165 @@
+/*
+ * Binary live view version 3 frames (wled00/live_enc.h): decoding every encoding gives the sampled frame
+ * Run with: pio test -e native -f test_live_enc
+ */
+
+#include <unity.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <vector>
+#include "../../wled00/live_enc.h"
+
+// what a client does with a received payload, returns false on malformed data
+static bool decode(const uint8_t *p, size_t len, uint8_t enc, size_t n, std::vector<uint16_t> &out) {
+  out.clear();
+  size_t pos = 0;
+  if (enc == LIVE_ENC_RGB565) {
+    if (len != 2*n) return false;
+    for (size_t i = 0; i < n; i++) out.push_back(p[2*i] | (p[2*i+1] << 8));
+    return true;
+  }
+  std::vector<uint16_t> pal;
+  if (enc == LIVE_ENC_PALRLE) {
+    size_t cnt = p[0] ? p[0] : 256;
+    for (size_t i = 0; i < cnt; i++) pal.push_back(p[1+2*i] | (p[2+2*i] << 8));
+    pos = 1 + 2*cnt;
+  }
+  while (pos < len) {
+    uint8_t run = p[pos];
+    if (!run) return false;
+    uint16_t c;
+    if (enc == LIVE_ENC_PALRLE) { if (p[pos+1] >= pal.size()) return false; c = pal[p[pos+1]]; pos += 2; }
+    else { c = p[pos+1] | (p[pos+2] << 8); pos += 3; }
+    out.insert(out.end(), run, c);
+  }
+  return pos == len && out.size() == n;
+}
+
+static std::vector<uint8_t> encode(const std::vector<uint16_t> &px, uint8_t &enc) {
+  LivePalette pal;
+  if (enc == LIVE_ENC_PALRLE && !pal.build(px.data(), px.size())) enc = LIVE_ENC_RLE565; // as makeLiveBuffer()
+  std::vector<uint8_t> buf(encodeLive565(nullptr, px.data(), px.size(), enc, &pal));
+  TEST_ASSERT_EQUAL(buf.size(), encodeLive565(buf.data(), px.data(), px.size(), enc, &pal));
+  return buf;
+}
+
+static void roundTrip(const std::vector<uint16_t> &px, uint8_t enc, uint8_t expectedEnc, const char *name) {
+  uint8_t e = enc;
+  std::vector<uint8_t> buf = encode(px, e);
+  TEST_ASSERT_EQUAL_MESSAGE(expectedEnc, e, name);
+  std::vector<uint16_t> out;
+  TEST_ASSERT_TRUE_MESSAGE(decode(buf.data(), buf.size(), e, px.size(), out), name);
+  TEST_ASSERT_TRUE_MESSAGE(out == px, name);
+}
+
+// frames of typical effects: solid, gradient with runs, sparkle (noise), full palette, >256 colors
+static std::vector<uint16_t> frame(int kind, size_t n) {
+  std::vector<uint16_t> px(n);
+  for (size_t i = 0; i < n; i++) switch (kind) {
+    case 0: px[i] = 0xF800; break;
+    case 1: px[i] = toRGB565(i * 256 / n, 0, 255 - i * 256 / n); break;
+    case 2: px[i] = rand() % 10 ? 0 : 0xFFFF; break;
+    case 3: px[i] = (i % 256) * 97; break;                 // exactly 256 colors
+    default: px[i] = rand(); break;
+  }
+  return px;
+}
+
+void setUp(void) { srand(33); }
+void tearDown(void) {}
+
+void test_round_trip(void) {
+  const char *names[] = {"solid", "gradient", "sparkle", "256 colors", "noise"};
+  for (int kind = 0; kind < 5; kind++) for (size_t n : {1, 30, 255, 256, 600, 8192}) {
+    std::vector<uint16_t> px = frame(kind, n);
+    char msg[40];
+    snprintf(msg, sizeof(msg), "%s, %u pixels", names[kind], (unsigned)n);
+    roundTrip(px, LIVE_ENC_RGB565, LIVE_ENC_RGB565, msg);
+    roundTrip(px, LIVE_ENC_RLE565, LIVE_ENC_RLE565, msg);
+    LivePalette pal;
+    roundTrip(px, LIVE_ENC_PALRLE, pal.build(px.data(), n) ? LIVE_ENC_PALRLE : LIVE_ENC_RLE565, msg);
+  }
+}
+
+// more than 256 colors falls back to RLE565, 256 fit (count byte 0)
+void test_palette_limit(void) {
+  LivePalette pal;
+  std::vector<uint16_t> px = frame(3, 1024);
+  TEST_ASSERT_TRUE(pal.build(px.data(), px.size()));
+  TEST_ASSERT_EQUAL(256, pal.count);
+  uint8_t enc = LIVE_ENC_PALRLE;
+  std::vector<uint8_t> buf = encode(px, enc);
+  TEST_ASSERT_EQUAL(LIVE_ENC_PALRLE, enc);
+  TEST_ASSERT_EQUAL(0, buf[0]);
+  px.push_back(1); // 257th color
+  TEST_ASSERT_FALSE(pal.build(px.data(), px.size()));
+}
+
+// runs are split at 255
+void test_long_run(void) {
+  std::vector<uint16_t> px(1000, 0x1234);
+  uint8_t enc = LIVE_ENC_RLE565;
+  std::vector<uint8_t> buf = encode(px, enc);
+  TEST_ASSERT_EQUAL(4*3, buf.size());
+  TEST_ASSERT_EQUAL(255, buf[0]);
+  TEST_ASSERT_EQUAL(1000 - 3*255, buf[9]);
+}
+
+// payload sizes of typical frames, 600 LEDs
+void test_sizes(void) {
+  const char *names[] = {"solid", "gradient", "sparkle", "256 colors", "noise"};
+  for (int kind = 0; kind < 5; kind++) {
+    std::vector<uint16_t> px = frame(kind, 600);
+    uint8_t e565 = LIVE_ENC_RGB565, eRle = LIVE_ENC_RLE565, ePal = LIVE_ENC_PALRLE;
+    size_t s565 = encode(px, e565).size(), sRle = encode(px, eRle).size(), sPal = encode(px, ePal).size();
+    char msg[100];
+    snprintf(msg, sizeof(msg), "%-10s RGB888 %u B, RGB565 %u B, RLE565 %u B, PALRLE %u B%s", names[kind],
+             600*3, (unsigned)s565, (unsigned)sRle, (unsigned)sPal, ePal == LIVE_ENC_PALRLE ? "" : " (fallback)");
+    TEST_MESSAGE(msg);
+  }
+  std::vector<uint16_t> solid = frame(0, 600);
+  uint8_t e = LIVE_ENC_RLE565;
+  TEST_ASSERT_LESS_THAN(20, encode(solid, e).size());
+}
+
+// sampled frame never exceeds the limit and covers the whole strip/matrix
+void test_sampling(void) {
+  uint16_t step, w, h;
+  liveSampling(false, 0, 0, 600, 8192, step, w, h);
+  TEST_ASSERT_EQUAL(1, step); TEST_ASSERT_EQUAL(600, w); TEST_ASSERT_EQUAL(1, h);
+  liveSampling(false, 0, 0, 8193, 8192, step, w, h);
+  TEST_ASSERT_EQUAL(2, step); TEST_ASSERT_EQUAL(4097, w);
+  TEST_ASSERT_EQUAL(8192, livePixelIndex(w-1, w, h, step, 0));
+  liveSampling(false, 0, 0, 0, 8192, step, w, h);
+  TEST_ASSERT_EQUAL(0, w);
+  for (size_t len = 1; len < 40000; len += 997) {
+    liveSampling(false, 0, 0, len, 1024, step, w, h);
+    TEST_ASSERT_LESS_OR_EQUAL(1024, w);
+    TEST_ASSERT_LESS_THAN(len, livePixelIndex(w-1, w, h, step, 0));
+    TEST_ASSERT_GREATER_OR_EQUAL(len, livePixelIndex(w-1, w, h, step, 0) + step);
+  }
+  liveSampling(true, 128, 128, 128*128, 8192, step, w, h);
+  TEST_ASSERT_EQUAL(2, step); TEST_ASSERT_EQUAL(64, w); TEST_ASSERT_EQUAL(64, h);
+  TEST_ASSERT_EQUAL(2*128 + 2, livePixelIndex(65, w, h, step, 128)); // row 1, column 1
+  TEST_ASSERT_EQUAL(126*128 + 126, livePixelIndex(w*h-1, w, h, step, 128));
+  liveSampling(true, 64, 32, 64*32, 8192, step, w, h);
+  TEST_ASSERT_EQUAL(1, step); TEST_ASSERT_EQUAL(64, w); TEST_ASSERT_EQUAL(32, h);
+}
+
+void test_header(void) {
+  uint8_t hdr[LIVE_HDR_SIZE];
+  writeLiveHeader(hdr, LIVE_ENC_PALRLE, 300, 4097, 1);
+  const uint8_t expected[LIVE_HDR_SIZE] = {'L', 3, LIVE_ENC_PALRLE, 255, 0x01, 0x10, 1, 0};
+  TEST_ASSERT_EQUAL_MEMORY(expected, hdr, LIVE_HDR_SIZE);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_palette_limit);
+  RUN_TEST(test_long_run);
+  RUN_TEST(test_sizes);
+  RUN_TEST(test_sampling);
+  RUN_TEST(test_header);
+  return UNITY_END();
+}
@@ -0,0 +1,119 @@
+/*
+ * Palette LUT (WLED_PALETTE_LUT, Segment::color_from_palette()): result equivalence and cost
+ * FastLED is not available on the host, ColorFromPalette() below is its CRGBPalette16 version
+ * (FastLED 3.6 colorutils.cpp, FASTLED_SCALE8_FIXED) and the LUT path is the one of color_from_palette().
+ * Run with: pio test -e native -f test_palette_lut
+ */
+
+#include <unity.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+struct CRGB {
+  uint8_t r, g, b;
+  CRGB& nscale8(uint8_t scale) { // FASTLED_SCALE8_FIXED
+    uint16_t s = scale + 1;
+    r = (r * s) >> 8; g = (g * s) >> 8; b = (b * s) >> 8;
+    return *this;
+  }
+};
+typedef CRGB CRGBPalette16[16];
+
+static inline uint8_t scale8(uint8_t i, uint8_t scale) { return (uint16_t(i) * (1 + uint16_t(scale))) >> 8; }
+
+static CRGB ColorFromPalette(const CRGBPalette16 &pal, uint8_t index, uint8_t brightness) { // LINEARBLEND
+  uint8_t hi4 = index >> 4, lo4 = index & 0x0F;
+  CRGB c = pal[hi4];
+  if (lo4) {
+    const CRGB &n = pal[(hi4 + 1) & 0x0F];
+    uint8_t f2 = lo4 << 4, f1 = 255 - f2;
+    c.r = scale8(c.r, f1) + scale8(n.r, f2);
+    c.g = scale8(c.g, f1) + scale8(n.g, f2);
+    c.b = scale8(c.b, f1) + scale8(n.b, f2);
+  }
+  if (brightness != 255) {
+    if (brightness) {
+      brightness++;
+      if (c.r) c.r = scale8(c.r, brightness);
+      if (c.g) c.g = scale8(c.g, brightness);
+      if (c.b) c.b = scale8(c.b, brightness);
+    } else c.r = c.g = c.b = 0;
+  }
+  return c;
+}
+
+// Segment::fillPaletteLUT()
+static void fillLUT(CRGB *lut, const CRGBPalette16 &pal) {
+  for (unsigned i = 0; i < 256; i++) lut[i] = ColorFromPalette(pal, i, 255);
+}
+
+// LUT path of Segment::color_from_palette()
+static inline CRGB lutColor(const CRGB *lut, uint8_t index, uint8_t pbri) {
+  CRGB c = lut[index];
+  if (pbri != 255) {
+    if (pbri) c.nscale8(pbri + 1);
+    else      c = {0, 0, 0};
+  }
+  return c;
+}
+
+static CRGBPalette16 pal;
+static CRGB lut[256];
+static volatile uint32_t sink;
+
+void setUp(void) {
+  srand(7);
+  for (CRGB &c : pal) c = {uint8_t(rand()), uint8_t(rand()), uint8_t(rand())};
+  fillLUT(lut, pal);
+}
+
+void tearDown(void) {}
+
+// the LUT returns exactly what ColorFromPalette() returns, for every index and brightness
+void test_equivalence(void) {
+  char msg[40];
+  for (unsigned bri = 0; bri < 256; bri++) for (unsigned i = 0; i < 256; i++) {
+    CRGB a = ColorFromPalette(pal, i, bri), b = lutColor(lut, i, bri);
+    snprintf(msg, sizeof(msg), "index %u bri %u", i, bri);
+    TEST_ASSERT_EQUAL_MESSAGE(a.r, b.r, msg);
+    TEST_ASSERT_EQUAL_MESSAGE(a.g, b.g, msg);
+    TEST_ASSERT_EQUAL_MESSAGE(a.b, b.b, msg);
+  }
+}
+
+template<class F> static double nsPerPixel(F f, unsigned frames, unsigned leds) {
+  auto t0 = std::chrono::steady_clock::now();
+  for (unsigned fr = 0; fr < frames; fr++) for (unsigned i = 0; i < leds; i++) f(fr, i);
+  auto t1 = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / (double(frames) * leds);
+}
+
+// per pixel cost of a rainbow-like effect (palette index moves with the LED and the frame) on 300 LEDs
+void test_benchmark(void) {
+  const unsigned frames = 20000, leds = 300;
+  double interp = nsPerPixel([](unsigned fr, unsigned i) {
+    CRGB c = ColorFromPalette(pal, uint8_t(i + fr), uint8_t(128 + (i & 127)));
+    sink += c.r + c.g + c.b;
+  }, frames, leds);
+  double lookup = nsPerPixel([](unsigned fr, unsigned i) {
+    CRGB c = lutColor(lut, uint8_t(i + fr), uint8_t(128 + (i & 127)));
+    sink += c.r + c.g + c.b;
+  }, frames, leds);
+  auto t0 = std::chrono::steady_clock::now();
+  for (unsigned n = 0; n < 1000; n++) { fillLUT(lut, pal); sink += lut[n & 0xFF].r; }
+  double fill = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / 1000;
+  char msg[160];
+  snprintf(msg, sizeof(msg), "ColorFromPalette %.2f ns/px, LUT %.2f ns/px, LUT fill %.0f ns (%u bytes), break-even after %.0f px",
+           interp, lookup, fill, (unsigned)sizeof(lut), fill / (interp - lookup));
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_TRUE(lookup < interp);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_equivalence);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
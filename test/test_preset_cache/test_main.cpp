@@ -0,0 +1,216 @@
+/*
+ * Preset cache and playlist prefetch (wled00/preset_cache.h): LRU bounds and invalidation,
+ * cost of a playlist step with and without the cached preset
+ * A cache miss parses the preset's JSON from presets.json, a hit (prefetched entry) deserializes MessagePack from RAM.
+ * Only the parsing part is measured here, reading the flash adds to the miss on the device.
+ * Run with: pio test -e native -f test_preset_cache
+ */
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include "../../wled00/src/dependencies/json/ArduinoJson-v6.h"
+#include "../../wled00/preset_cache.h"
+
+// preset as saved by the UI (3 segments)
+static const char preset[] = R"({"on":true,"bri":128,"transition":7,"mainseg":0,"seg":[
+{"id":0,"start":0,"stop":60,"grp":1,"spc":0,"of":0,"on":true,"frz":false,"bri":255,"cct":127,"set":0,"n":"Left","col":[[255,160,0],[0,0,0],[0,0,0]],"fx":9,"sx":128,"ix":128,"pal":11,"c1":128,"c2":128,"c3":16,"sel":true,"rev":false,"mi":false,"o1":false,"o2":false,"o3":false,"si":0,"m12":0},
+{"id":1,"start":60,"stop":120,"grp":1,"spc":0,"of":0,"on":true,"frz":false,"bri":255,"cct":127,"set":0,"col":[[0,120,255],[0,0,0],[0,0,0]],"fx":28,"sx":200,"ix":80,"pal":6,"c1":128,"c2":128,"c3":16,"sel":false,"rev":true,"mi":false,"o1":false,"o2":false,"o3":false,"si":0,"m12":0},
+{"id":2,"start":120,"stop":180,"grp":1,"spc":0,"of":0,"on":true,"frz":false,"bri":255,"cct":127,"set":0,"col":[[255,0,90],[0,0,0],[0,0,0]],"fx":65,"sx":90,"ix":190,"pal":35,"c1":128,"c2":128,"c3":16,"sel":false,"rev":false,"mi":true,"o1":false,"o2":false,"o3":false,"si":0,"m12":0}]})";
+
+static std::string largePreset() { // 16 segments, larger than half of the ESP8266 cache (1 KiB)
+  std::string p = R"({"on":true,"bri":200,"seg":[)";
+  for (int i = 0; i < 16; i++) {
+    char s[240];
+    snprintf(s, sizeof(s), R"(%s{"id":%d,"start":%d,"stop":%d,"col":[[255,%d,0],[0,0,0],[0,0,0]],"fx":%d,"sx":128,"ix":128,"pal":%d,"c1":128,"c2":128,"c3":16,"sel":true,"rev":false,"mi":false})",
+             i ? "," : "", i, i*10, i*10+10, i*15, i % 100, i % 50);
+    p += s;
+  }
+  return p + "]}";
+}
+
+// preset as in presets.json, padded to roughly the given MessagePack size
+static void presetDoc(DynamicJsonDocument &doc, int id, size_t size = 40) {
+  char json[600];
+  snprintf(json, sizeof(json), R"({"on":true,"bri":%d,"seg":[{"id":0,"fx":%d,"col":[[255,%d,0]]}],"n":"%s"})",
+           id, id % 100, id, std::string(size > 40 ? size - 40 : 1, 'x').c_str());
+  deserializeJson(doc, (const char*)json); // copies strings
+}
+
+static void stats(std::vector<double> &t, double &p50, double &p99, double &max) {
+  std::sort(t.begin(), t.end());
+  p50 = t[t.size()/2];
+  p99 = t[t.size()*99/100];
+  max = t.back();
+}
+
+template<class F> static std::vector<double> measure(F f, int runs) {
+  std::vector<double> t;
+  for (int i = 0; i < runs; i++) {
+    auto t0 = std::chrono::steady_clock::now();
+    f();
+    t.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count());
+  }
+  return t;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// cached MessagePack deserializes to the same document as the JSON in presets.json
+void test_cached_equals_file(void) {
+  DynamicJsonDocument a(8192), b(8192);
+  deserializeJson(a, preset);
+  std::vector<uint8_t> mp(measureMsgPack(a));
+  serializeMsgPack(a, mp.data(), mp.size());
+  TEST_ASSERT_TRUE(deserializeMsgPack(b, (const uint8_t*)mp.data(), mp.size()) == DeserializationError::Ok);
+  TEST_ASSERT_TRUE(a == b);
+}
+
+// step cost with (hit) and without (miss) the prefetched entry, spread over many steps
+void test_step_jitter(void) {
+  const int runs = 5000;
+  DynamicJsonDocument doc(8192);
+  deserializeJson(doc, preset);
+  std::vector<uint8_t> mp(measureMsgPack(doc));
+  serializeMsgPack(doc, mp.data(), mp.size());
+  size_t jsonLen = strlen(preset);
+
+  auto miss = measure([&]() { deserializeJson(doc, (const char*)preset, jsonLen); }, runs);
+  auto hit  = measure([&]() { deserializeMsgPack(doc, (const uint8_t*)mp.data(), mp.size()); }, runs);
+  double m50, m99, mMax, h50, h99, hMax;
+  stats(miss, m50, m99, mMax);
+  stats(hit, h50, h99, hMax);
+  char msg[200];
+  snprintf(msg, sizeof(msg), "miss (JSON %u B): p50 %.2f us, p99 %.2f us, max %.2f us | hit (MessagePack %u B): p50 %.2f us, p99 %.2f us, max %.2f us",
+           (unsigned)jsonLen, m50, m99, mMax, (unsigned)mp.size(), h50, h99, hMax);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_TRUE(h50 < m50);
+  TEST_ASSERT_TRUE(h99 < m99);
+}
+
+// presets above PRESET_CACHE_BYTES/2 are not cached, so prefetching them is skipped
+void test_large_preset_size(void) {
+  DynamicJsonDocument doc(16384);
+  std::string p = largePreset();
+  TEST_ASSERT_TRUE(deserializeJson(doc, p) == DeserializationError::Ok);
+  size_t len = measureMsgPack(doc);
+  char msg[100];
+  snprintf(msg, sizeof(msg), "16 segment preset: JSON %u B, MessagePack %u B", (unsigned)p.size(), (unsigned)len);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_GREATER_THAN(2048/2, len);   // ESP8266: never cached
+  TEST_ASSERT_LESS_THAN(16384/2, len);     // ESP32: cached
+  PresetCache<4, 2048> esp8266;
+  PresetCache<16, 16384> esp32;
+  TEST_ASSERT_FALSE(esp8266.store(1, doc));
+  TEST_ASSERT_TRUE(esp8266.tooLarge(1));
+  TEST_ASSERT_TRUE(esp32.store(1, doc));
+  TEST_ASSERT_FALSE(esp32.tooLarge(1));
+}
+
+// what is read from the cache is what was stored
+void test_round_trip(void) {
+  PresetCache<4, 2048> cache;
+  DynamicJsonDocument src(1024), dst(1024);
+  deserializeJson(src, R"({"on":true,"bri":128,"transition":7,"seg":[{"id":0,"n":"a \"name\"","col":[[255,0,0],[0,0,0,255]]}],"playlist":{"ps":[1,2],"dur":[300,-1]},"win":"&A=5","n":"Preset"})");
+  TEST_ASSERT_FALSE(cache.read(5, dst));
+  TEST_ASSERT_TRUE(cache.store(5, src));
+  TEST_ASSERT_TRUE(cache.contains(5));
+  TEST_ASSERT_TRUE(cache.read(5, dst));
+  TEST_ASSERT_TRUE(src == dst);
+  TEST_ASSERT_EQUAL(measureMsgPack(src), cache.bytes());
+  src.clear(); // cached copy does not reference the source
+  TEST_ASSERT_TRUE(cache.read(5, src));
+  TEST_ASSERT_TRUE(src == dst);
+}
+
+// least recently used (stored or read) is evicted first when entries run out
+void test_lru_entries(void) {
+  PresetCache<3, 2048> cache;
+  DynamicJsonDocument doc(1024);
+  for (int id = 1; id <= 3; id++) { presetDoc(doc, id); cache.store(id, doc); }
+  cache.read(1, doc);            // 2 is now the oldest
+  presetDoc(doc, 4); cache.store(4, doc);
+  TEST_ASSERT_TRUE(cache.contains(1));
+  TEST_ASSERT_FALSE(cache.contains(2));
+  TEST_ASSERT_TRUE(cache.contains(3));
+  TEST_ASSERT_TRUE(cache.contains(4));
+  presetDoc(doc, 5); cache.store(5, doc);
+  TEST_ASSERT_FALSE(cache.contains(3));
+}
+
+// total size stays within the limit, as many old entries as needed are evicted, too large presets are flagged
+void test_byte_limit(void) {
+  PresetCache<16, 512> cache;
+  DynamicJsonDocument doc(2048);
+  for (int id = 1; id <= 100; id++) {
+    presetDoc(doc, id, 40 + (id * 37) % 200);
+    cache.store(id, doc);
+    TEST_ASSERT_LESS_OR_EQUAL(512, cache.bytes());
+    TEST_ASSERT_TRUE(cache.contains(id));
+  }
+  presetDoc(doc, 200, 300);
+  TEST_ASSERT_FALSE(cache.store(200, doc)); // more than half of the cache
+  TEST_ASSERT_TRUE(cache.tooLarge(200));
+  TEST_ASSERT_FALSE(cache.tooLarge(100));
+  TEST_ASSERT_TRUE(cache.contains(100));    // nothing evicted for it
+}
+
+// storing a preset again replaces it (no duplicate entries)
+void test_replace(void) {
+  PresetCache<4, 2048> cache;
+  DynamicJsonDocument doc(1024), out(1024);
+  presetDoc(doc, 7);
+  cache.store(7, doc);
+  size_t before = cache.bytes();
+  presetDoc(doc, 7, 100);
+  cache.store(7, doc);
+  TEST_ASSERT_EQUAL(measureMsgPack(doc), cache.bytes());
+  TEST_ASSERT_NOT_EQUAL(before, cache.bytes());
+  TEST_ASSERT_TRUE(cache.read(7, out));
+  TEST_ASSERT_TRUE(doc == out);
+}
+
+// invalidate() (savePreset(), /edit upload) drops all entries and size flags on next use
+void test_invalidate(void) {
+  PresetCache<4, 512> cache;
+  DynamicJsonDocument doc(2048);
+  presetDoc(doc, 1); cache.store(1, doc);
+  presetDoc(doc, 2, 400); cache.store(2, doc);
+  TEST_ASSERT_TRUE(cache.tooLarge(2));
+  cache.invalidate();
+  TEST_ASSERT_FALSE(cache.contains(1));
+  TEST_ASSERT_FALSE(cache.tooLarge(2));
+  TEST_ASSERT_EQUAL(0, cache.bytes());
+  TEST_ASSERT_FALSE(cache.read(1, doc));
+}
+
+// LRU order survives the 16 bit tick wrapping around
+void test_tick_wrap(void) {
+  PresetCache<2, 2048> cache;
+  DynamicJsonDocument doc(1024);
+  presetDoc(doc, 1); cache.store(1, doc);
+  presetDoc(doc, 2); cache.store(2, doc);
+  for (int i = 0; i < 70000; i++) cache.read(i & 1 ? 1 : 2, doc); // 1 read last
+  presetDoc(doc, 3); cache.store(3, doc);
+  TEST_ASSERT_TRUE(cache.contains(1));
+  TEST_ASSERT_FALSE(cache.contains(2));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_cached_equals_file);
+  RUN_TEST(test_step_jitter);
+  RUN_TEST(test_large_preset_size);
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_lru_entries);
+  RUN_TEST(test_byte_limit);
+  RUN_TEST(test_replace);
+  RUN_TEST(test_invalidate);
+  RUN_TEST(test_tick_wrap);
+  return UNITY_END();
+}
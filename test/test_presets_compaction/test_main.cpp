@@ -0,0 +1,196 @@
+/*
+ * presets.json free extents and compaction (wled00/presets_index.h): compacted file holds the same presets
+ * Run with: pio test -e native -f test_presets_compaction
+ */
+
+#include <unity.h>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdio>
+#include "../../wled00/src/dependencies/json/ArduinoJson-v6.h"
+#include "../../wled00/presets_index.h"
+
+// in-memory stand-in for fs::File
+struct MemFile {
+  std::string data;
+  size_t pos = 0;
+  bool failWrite = false;
+  void seek(size_t p) { pos = p; }
+  size_t position() const { return pos; }
+  size_t read(uint8_t *buf, size_t n) {
+    n = std::min(n, data.size() - std::min(pos, data.size()));
+    memcpy(buf, data.data() + pos, n);
+    pos += n;
+    return n;
+  }
+  size_t write(const uint8_t *buf, size_t n) {
+    if (failWrite) return 0;
+    data.replace(pos, std::min(n, data.size() - pos), (const char*)buf, n);
+    pos += n;
+    return n;
+  }
+  size_t write(uint8_t c) { return write(&c, 1); }
+};
+
+static bool scan(const std::string &file, std::vector<presetidx_t> &index, std::vector<freeext_t> &extents) {
+  PresetIndexScanner scanner(index, extents);
+  scanner.feed((const uint8_t*)file.data(), file.size());
+  return scanner.complete;
+}
+
+// runs the compactor like handlePresetsCompaction(), returns number of steps (0 on error)
+static int compact(MemFile &src, MemFile &dst, const std::vector<presetidx_t> &index, PresetsCompactor &c, size_t budget) {
+  uint8_t buf[64];
+  if (!c.begin(dst, index.size())) return 0;
+  for (int steps = 1; steps < 100000; steps++) {
+    int8_t res = c.step(index, src, dst, budget, buf, sizeof(buf));
+    if (res < 0) return 0;
+    if (res) return steps;
+  }
+  return 0;
+}
+
+// presets.json after some edits: replaced and deleted presets left spaces behind
+static std::string fragmentedFile(int presets) {
+  std::string file = R"({"0":{})";
+  for (int id = 1; id <= presets; id++) {
+    char p[200];
+    snprintf(p, sizeof(p), R"(,"%d":{"on":true,"bri":%d,"seg":[{"id":0,"fx":%d,"n":"a \"}\" b"}],"n":"Preset %d"})", id, id, id % 100, id);
+    file += p;
+    if (id % 3 == 0) file += std::string(200 + id, ' ');
+  }
+  file += "}";
+  return file;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// adjacent extents are merged, too small ones ignored, the smallest is dropped when the list is full
+void test_extent_bookkeeping(void) {
+  std::vector<freeext_t> ext;
+  addFreeExtent(ext, 100, 4);
+  TEST_ASSERT_EQUAL(0, ext.size());
+  addFreeExtent(ext, 104, 4);  // merged with nothing (first one was dropped)
+  TEST_ASSERT_EQUAL(0, ext.size());
+  addFreeExtent(ext, 100, 20);
+  addFreeExtent(ext, 120, 10); // after
+  addFreeExtent(ext, 90, 10);  // before
+  TEST_ASSERT_EQUAL(1, ext.size());
+  TEST_ASSERT_EQUAL(90, ext[0].pos);
+  TEST_ASSERT_EQUAL(40, ext[0].len);
+
+  for (uint32_t i = 1; i < MAX_FREE_EXTENTS; i++) addFreeExtent(ext, 1000*i, 10 + i);
+  TEST_ASSERT_EQUAL(MAX_FREE_EXTENTS, ext.size());
+  addFreeExtent(ext, 100000, 9); // smaller than all, not added
+  TEST_ASSERT_EQUAL(MAX_FREE_EXTENTS, ext.size());
+  uint32_t pos = 100000;
+  TEST_ASSERT_FALSE(findFreeExtent(ext, 9, pos, true));
+  addFreeExtent(ext, 200000, 500); // replaces the smallest (11 at 1000)
+  TEST_ASSERT_EQUAL(MAX_FREE_EXTENTS, ext.size());
+  pos = 1000;
+  TEST_ASSERT_FALSE(findFreeExtent(ext, 1, pos, true));
+  TEST_ASSERT_TRUE(findFreeExtent(ext, 400, pos));
+  TEST_ASSERT_EQUAL(200000, pos);
+}
+
+// using part of an extent keeps the rest if it can still hold a preset
+void test_extent_use(void) {
+  std::vector<freeext_t> ext;
+  addFreeExtent(ext, 100, 100);
+  useFreeExtent(ext, 120, 50);  // leaves 20 before, 30 after
+  TEST_ASSERT_EQUAL(2, ext.size());
+  uint32_t pos = 100;
+  TEST_ASSERT_TRUE(findFreeExtent(ext, 20, pos, true));
+  pos = 170;
+  TEST_ASSERT_TRUE(findFreeExtent(ext, 30, pos, true));
+  TEST_ASSERT_FALSE(findFreeExtent(ext, 31, pos));
+  useFreeExtent(ext, 172, 25);  // 2 and 3 left, dropped
+  useFreeExtent(ext, 100, 20);
+  TEST_ASSERT_EQUAL(0, ext.size());
+  addFreeExtent(ext, 100, 10);
+  useFreeExtent(ext, 95, 10);   // not within an extent, nothing changes
+  TEST_ASSERT_EQUAL(1, ext.size());
+}
+
+// compaction starts with enough waste, or with less if requested (after ERR_FS_QUOTA)
+void test_waste(void) {
+  std::vector<presetidx_t> index = {{10, 1000, 1}, {1020, 500, 2}};
+  uint32_t live = presetsLiveSize(index);
+  TEST_ASSERT_EQUAL(8 + 1007 + 507, live);
+  TEST_ASSERT_EQUAL(0, presetsCompactionWaste(index, live, true));
+  TEST_ASSERT_EQUAL(0, presetsCompactionWaste(index, live + PRESETS_COMPACT_MIN_WASTE - 1, true));
+  TEST_ASSERT_EQUAL(PRESETS_COMPACT_MIN_WASTE, presetsCompactionWaste(index, live + PRESETS_COMPACT_MIN_WASTE, false));
+  index.push_back({2000, 20000, 3});
+  live = presetsLiveSize(index);
+  TEST_ASSERT_EQUAL(0, presetsCompactionWaste(index, live + 3000, false)); // less than a quarter
+  TEST_ASSERT_EQUAL(3000, presetsCompactionWaste(index, live + 3000, true));
+  TEST_ASSERT_EQUAL(0, presetsCompactionWaste(index, 100, true));         // index larger than file
+}
+
+// compacted file has the same presets at the new offsets and no free space, for any chunk size
+void test_compaction(void) {
+  std::string file = fragmentedFile(60);
+  std::vector<presetidx_t> index;
+  std::vector<freeext_t> extents;
+  TEST_ASSERT_TRUE(scan(file, index, extents));
+  TEST_ASSERT_EQUAL(20, extents.size());
+  uint32_t waste = presetsCompactionWaste(index, file.size(), false);
+  TEST_ASSERT_TRUE(waste > 0);
+
+  DynamicJsonDocument before(65536), after(65536);
+  TEST_ASSERT_TRUE(deserializeJson(before, file) == DeserializationError::Ok);
+  for (size_t budget : {1, 13, 1024, 100000}) {
+    MemFile src, dst;
+    src.data = file;
+    PresetsCompactor c;
+    int steps = compact(src, dst, index, c, budget);
+    TEST_ASSERT_TRUE(steps > 0);
+    TEST_ASSERT_LESS_OR_EQUAL(presetsLiveSize(index), dst.data.size()); // keys are counted with 3 digits
+    TEST_ASSERT_GREATER_OR_EQUAL(waste, file.size() - dst.data.size());
+    TEST_ASSERT_TRUE(deserializeJson(after, dst.data) == DeserializationError::Ok);
+    TEST_ASSERT_TRUE(before == after);
+
+    // the compactor's index is what a fresh scan of the new file gives
+    std::vector<presetidx_t> rescanned;
+    TEST_ASSERT_TRUE(scan(dst.data, rescanned, extents));
+    TEST_ASSERT_EQUAL(0, extents.size());
+    TEST_ASSERT_EQUAL(rescanned.size(), c.index.size());
+    for (size_t i = 0; i < rescanned.size(); i++) {
+      TEST_ASSERT_EQUAL(rescanned[i].id, c.index[i].id);
+      TEST_ASSERT_EQUAL(rescanned[i].pos, c.index[i].pos);
+      TEST_ASSERT_EQUAL(rescanned[i].len, c.index[i].len);
+    }
+  }
+}
+
+// a stale index (file changed behind it) or a failing write stops the compaction
+void test_compaction_errors(void) {
+  std::string file = fragmentedFile(10);
+  std::vector<presetidx_t> index;
+  std::vector<freeext_t> extents;
+  scan(file, index, extents);
+  MemFile src, dst;
+  PresetsCompactor c;
+  src.data = file;
+  src.data.insert(index[4].pos - 5, "  ");   // objects moved
+  TEST_ASSERT_EQUAL(0, compact(src, dst, index, c, 1024));
+  src.data = file.substr(0, file.size() / 2); // truncated
+  dst.data.clear(); dst.pos = 0;
+  TEST_ASSERT_EQUAL(0, compact(src, dst, index, c, 1024));
+  src.data = file;
+  dst.data.clear(); dst.pos = 0;
+  dst.failWrite = true;
+  TEST_ASSERT_EQUAL(0, compact(src, dst, index, c, 1024));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_extent_bookkeeping);
+  RUN_TEST(test_extent_use);
+  RUN_TEST(test_waste);
+  RUN_TEST(test_compaction);
+  RUN_TEST(test_compaction_errors);
+  return UNITY_END();
+}
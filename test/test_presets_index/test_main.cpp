@@ -0,0 +1,139 @@
+/*
+ * presets.json index (wled00/presets_index.h): single pass scan finds every preset object at its offset
+ * Run with: pio test -e native -f test_presets_index
+ */
+
+#include <unity.h>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdio>
+#include "../../wled00/src/dependencies/json/ArduinoJson-v6.h"
+#include "../../wled00/presets_index.h"
+
+// scan as buildPresetIndex() does, file read in chunks of the given size
+static bool scan(const std::string &file, size_t chunk, std::vector<presetidx_t> &index, std::vector<freeext_t> &extents) {
+  PresetIndexScanner scanner(index, extents);
+  for (size_t pos = 0; pos < file.size(); pos += chunk)
+    scanner.feed((const uint8_t*)file.data() + pos, std::min(chunk, file.size() - pos));
+  return scanner.complete;
+}
+
+// every indexed object is what deserializing the whole file gives for its key,
+// and the key (with optional whitespace) is in front of it, as checked by readIndexedObject()
+static void verify(const std::string &file, const std::vector<presetidx_t> &index, size_t expectedCount) {
+  DynamicJsonDocument all(65536), one(4096);
+  TEST_ASSERT_TRUE(deserializeJson(all, file) == DeserializationError::Ok);
+  TEST_ASSERT_EQUAL(expectedCount, index.size());
+  for (const presetidx_t &e : index) {
+    char key[8];
+    snprintf(key, sizeof(key), "\"%d\":", e.id);
+    TEST_ASSERT_EQUAL('{', file[e.pos]);
+    TEST_ASSERT_EQUAL('}', file[e.pos + e.len - 1]);
+    size_t n = e.pos;
+    while (n && isspace((unsigned char)file[n-1])) n--;
+    TEST_ASSERT_TRUE(n >= strlen(key) && !file.compare(n - strlen(key), strlen(key), key));
+    TEST_ASSERT_TRUE(deserializeJson(one, file.substr(e.pos, e.len)) == DeserializationError::Ok);
+    TEST_ASSERT_TRUE(one == all[std::to_string(e.id)]);
+  }
+}
+
+static const std::vector<size_t> chunks = {1, 7, 256, 4096};
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// presets.json as written by savePreset()
+void test_regular_file(void) {
+  std::string file = R"({"0":{})";
+  for (int id = 1; id <= 40; id++) {
+    char p[200];
+    snprintf(p, sizeof(p), R"(,"%d":{"on":true,"bri":%d,"seg":[{"id":0,"fx":%d,"col":[[255,0,0]]}],"n":"Preset %d"})", id, id*5, id, id);
+    file += p;
+  }
+  file += "}";
+  for (size_t c : chunks) {
+    std::vector<presetidx_t> index;
+    std::vector<freeext_t> extents;
+    TEST_ASSERT_TRUE(scan(file, c, index, extents));
+    verify(file, index, 40);
+    TEST_ASSERT_EQUAL(0, extents.size());
+  }
+}
+
+// strings with braces, quotes and digits do not confuse the scanner, playlists and nested objects are fine
+void test_tricky_strings(void) {
+  std::string file = R"({"0":{},"1":{"n":"{\"2\":{}}","ql":"}"},"2":{"playlist":{"ps":[1,3],"dur":[30,30]},"n":"a\\"},"3":{"n":"\"3\":{","seg":{"i":[0,"FF0000"]}}})";
+  for (size_t c : chunks) {
+    std::vector<presetidx_t> index;
+    std::vector<freeext_t> extents;
+    TEST_ASSERT_TRUE(scan(file, c, index, extents));
+    verify(file, index, 3);
+  }
+}
+
+// whitespace between key and object (hand edited file) is not free space
+void test_whitespace_after_key(void) {
+  std::string file = "{\"0\":{},\"1\":                {\"bri\":1},\n\"2\":\n\t{\"bri\":2}}";
+  std::vector<presetidx_t> index;
+  std::vector<freeext_t> extents;
+  TEST_ASSERT_TRUE(scan(file, 5, index, extents));
+  verify(file, index, 2);
+  TEST_ASSERT_EQUAL(0, extents.size());
+}
+
+// deleted and shrunk presets leave spaces which are found as free extents, small gaps are ignored
+void test_free_space(void) {
+  std::string file = R"({"0":{},"1":{"bri":1})" + std::string(40, ' ') + R"(,"3":{"bri":3}   ,"4":{"bri":4})" + std::string(9, ' ') + "}";
+  std::vector<presetidx_t> index;
+  std::vector<freeext_t> extents;
+  TEST_ASSERT_TRUE(scan(file, 3, index, extents));
+  verify(file, index, 3);
+  TEST_ASSERT_EQUAL(2, extents.size());
+  for (const freeext_t &e : extents) {
+    TEST_ASSERT_TRUE(e.len == 40 || e.len == 9);
+    TEST_ASSERT_TRUE(file.substr(e.pos, e.len) == std::string(e.len, ' '));
+    TEST_ASSERT_TRUE(file[e.pos - 1] != ' ' && file[e.pos + e.len] != ' ');
+  }
+}
+
+// anything the index does not cover marks it incomplete (no compaction), presets are still indexed
+void test_incomplete(void) {
+  const char *files[] = {
+    R"({"0":{},"1":{"bri":1},"abc":{"x":1},"2":{"bri":2}})",  // non-numeric key
+    R"({"0":{},"1":{"bri":1},"1":{"bri":9},"2":{"bri":2}})",  // duplicate, first one is indexed (as found by the key search)
+    R"({"0":{},"1":{"bri":1},"7":5,"2":{"bri":2}})",          // non-object value
+    R"({"0":{},"1":{"bri":1},"256":{"bri":0},"2":{"bri":2}})" // out of range
+  };
+  for (const char *f : files) {
+    std::vector<presetidx_t> index;
+    std::vector<freeext_t> extents;
+    TEST_ASSERT_FALSE(scan(f, 4, index, extents));
+    TEST_ASSERT_EQUAL(2, index.size());
+    TEST_ASSERT_EQUAL(1, index[0].id);
+    TEST_ASSERT_EQUAL(2, index[1].id);
+  }
+}
+
+// lookup by id
+void test_find(void) {
+  std::string file = R"({"0":{},"12":{"bri":1},"250":{"bri":2}})";
+  std::vector<presetidx_t> index;
+  std::vector<freeext_t> extents;
+  scan(file, 16, index, extents);
+  TEST_ASSERT_NOT_NULL(findPresetIndex(index, 12));
+  TEST_ASSERT_EQUAL(250, findPresetIndex(index, 250)->id);
+  TEST_ASSERT_NULL(findPresetIndex(index, 1));
+  TEST_ASSERT_NULL(findPresetIndex(index, 0));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_regular_file);
+  RUN_TEST(test_tricky_strings);
+  RUN_TEST(test_whitespace_after_key);
+  RUN_TEST(test_free_space);
+  RUN_TEST(test_incomplete);
+  RUN_TEST(test_find);
+  return UNITY_END();
+}
@@ -0,0 +1,146 @@
+/*
+ * Presets journal (wled00/presets_journal.h): replay after power loss
+ * Run with: pio test -e native -f test_presets_journal
+ */
+
+#include <unity.h>
+#include <vector>
+#include <map>
+#include <string>
+#include <cstring>
+#include "../../wled00/src/dependencies/json/ArduinoJson-v6.h"
+#include "../../wled00/presets_journal.h"
+
+#define FS_BUFSIZE 256 // as in file.cpp
+
+// read only file backed by memory, File API subset used by journalScan()
+struct MemFile {
+  const std::vector<uint8_t>& data;
+  size_t len, pos = 0;
+  MemFile(const std::vector<uint8_t>& d, size_t l) : data(d), len(l) {}
+  size_t size() const { return len; }
+  size_t read(uint8_t* buf, size_t n) {
+    if (n > len - pos) n = len - pos;
+    memcpy(buf, data.data() + pos, n);
+    pos += n;
+    return n;
+  }
+};
+
+struct Record { uint8_t id; size_t pos; uint16_t len; };
+
+static std::vector<uint8_t> journal;
+static std::vector<size_t> boundaries; // end of each record
+
+static void append(uint8_t id, const char* json) {
+  std::vector<uint8_t> rec(JOURNAL_HDR_LEN);
+  if (json) {
+    DynamicJsonDocument doc(8192);
+    deserializeJson(doc, json);
+    rec.resize(JOURNAL_HDR_LEN + measureMsgPack(doc));
+    serializeMsgPack(doc, rec.data() + JOURNAL_HDR_LEN, rec.size() - JOURNAL_HDR_LEN);
+  }
+  TEST_ASSERT_TRUE(journalEncode(rec.data(), id, rec.size() - JOURNAL_HDR_LEN));
+  journal.insert(journal.end(), rec.begin(), rec.end());
+  boundaries.push_back(journal.size());
+}
+
+static size_t scan(const std::vector<uint8_t>& data, size_t len, std::vector<Record>& found) {
+  MemFile f(data, len);
+  found.clear();
+  return journalScan<FS_BUFSIZE>(f, [&](uint8_t id, size_t pos, uint16_t l) { found.push_back({id, pos, l}); });
+}
+
+// latest record of each preset, as loadPresetJournal() indexes them
+static std::map<uint8_t, Record> replay(const std::vector<Record>& found) {
+  std::map<uint8_t, Record> latest;
+  for (auto& r : found) latest[r.id] = r;
+  return latest;
+}
+
+void setUp(void) {
+  journal.clear();
+  boundaries.clear();
+  append(1, "{\"on\":true,\"bri\":128,\"n\":\"Evening\"}");
+  std::string big = "{\"seg\":[";
+  for (int i = 0; i < 16; i++) big += (i ? ",{\"id\":" : "{\"id\":") + std::to_string(i) + ",\"col\":[[255,160,0],[0,0,0],[0,0,0]],\"fx\":9,\"sx\":128}";
+  big += "]}";
+  append(2, big.c_str()); // larger than FS_BUFSIZE, checksummed in blocks
+  append(1, "{\"on\":false,\"bri\":40}");
+  append(3, nullptr);     // deleted
+}
+
+void tearDown(void) {}
+
+void test_complete_journal(void) {
+  std::vector<Record> found;
+  TEST_ASSERT_EQUAL(journal.size(), scan(journal, journal.size(), found));
+  TEST_ASSERT_EQUAL(4, found.size());
+  TEST_ASSERT_GREATER_THAN(FS_BUFSIZE, found[1].len);
+
+  auto latest = replay(found);
+  TEST_ASSERT_EQUAL(3, latest.size());
+  TEST_ASSERT_EQUAL(0, latest[3].len);
+  DynamicJsonDocument doc(512);
+  TEST_ASSERT_TRUE(deserializeMsgPack(doc, journal.data() + latest[1].pos + JOURNAL_HDR_LEN, latest[1].len) == DeserializationError::Ok);
+  TEST_ASSERT_FALSE(doc["on"].as<bool>());
+  TEST_ASSERT_EQUAL(40, doc["bri"].as<int>());
+}
+
+// power lost while appending: the file ends anywhere
+void test_truncated_at_every_offset(void) {
+  std::vector<Record> found;
+  for (size_t cut = 0; cut <= journal.size(); cut++) {
+    size_t complete = 0, valid = 0;
+    for (size_t b : boundaries) if (b <= cut) { complete++; valid = b; }
+    TEST_ASSERT_EQUAL_MESSAGE(valid, scan(journal, cut, found), "valid bytes");
+    TEST_ASSERT_EQUAL_MESSAGE(complete, found.size(), "records");
+  }
+}
+
+// power lost after the file size was updated but before the data was written
+void test_erased_tail(void) {
+  std::vector<Record> found;
+  for (size_t i = 0; i < boundaries.size(); i++) {
+    size_t start = i ? boundaries[i-1] : 0;
+    for (uint8_t fill : {0x00, 0xFF}) {
+      std::vector<uint8_t> data(journal.begin(), journal.begin() + boundaries[i]);
+      for (size_t p = start + JOURNAL_HDR_LEN; p < boundaries[i]; p++) data[p] = fill;
+      if (boundaries[i] - start == JOURNAL_HDR_LEN) continue; // deleted preset, header only
+      TEST_ASSERT_EQUAL(start, scan(data, data.size(), found));
+      TEST_ASSERT_EQUAL(i, found.size());
+    }
+  }
+}
+
+// any single corrupt byte drops the record containing it and everything after it
+void test_corrupt_byte(void) {
+  std::vector<Record> found;
+  for (size_t p = 0; p < journal.size(); p++) {
+    size_t start = 0, i = 0;
+    while (boundaries[i] <= p) start = boundaries[i++];
+    for (uint8_t flip : {0x01, 0x80, 0xFF}) {
+      std::vector<uint8_t> data = journal;
+      data[p] ^= flip;
+      TEST_ASSERT_EQUAL_MESSAGE(start, scan(data, data.size(), found), "valid bytes");
+      TEST_ASSERT_EQUAL_MESSAGE(i, found.size(), "records");
+    }
+  }
+}
+
+void test_invalid_id(void) {
+  uint8_t rec[JOURNAL_HDR_LEN];
+  TEST_ASSERT_FALSE(journalEncode(rec, 0, 0));
+  TEST_ASSERT_FALSE(journalEncode(rec, 251, 0));
+  TEST_ASSERT_TRUE(journalEncode(rec, 250, 0));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_complete_journal);
+  RUN_TEST(test_truncated_at_every_offset);
+  RUN_TEST(test_erased_tail);
+  RUN_TEST(test_corrupt_byte);
+  RUN_TEST(test_invalid_id);
+  return UNITY_END();
+}
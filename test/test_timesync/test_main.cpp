@@ -0,0 +1,136 @@
+/*
+ * Effect clock sync estimator (wled00/timesync.h): simulated node pair with offset clocks and jittery network
+ * Run with: pio test -e native -f test_timesync
+ */
+
+#include <unity.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "../../wled00/timesync.h"
+
+// peer (sync source) runs its millis() with an offset to ours, its timebase is constant
+struct Peer {
+  uint32_t offset, timebase;
+  uint32_t millisAt(uint32_t ours) const { return ours + offset; }
+};
+
+// one request/response exchange of handleTimeSync()/handleTimeSyncPacket(), returns t4
+static uint32_t exchange(PeerClock &pc, const Peer &peer, uint32_t t1, unsigned up, unsigned proc, unsigned down) {
+  uint32_t t2 = peer.millisAt(t1 + up);
+  uint32_t t3 = t2 + proc;
+  uint32_t t4 = t1 + up + proc + down;
+  pc.addSample(t1, t2, t3, t4, t3 + peer.timebase);
+  return t4;
+}
+
+// own timebase which gives the peer's effect time
+static uint32_t idealTimebase(const Peer &peer) { return peer.offset + peer.timebase; }
+
+void setUp(void) { srand(27); }
+void tearDown(void) {}
+
+// symmetric delays: exact estimate
+void test_symmetric(void) {
+  PeerClock pc;
+  Peer peer = {123456789u, 4000u};
+  exchange(pc, peer, 1000, 10, 2, 10);
+  TEST_ASSERT_TRUE(pc.isValid());
+  TEST_ASSERT_EQUAL_UINT32(idealTimebase(peer), pc.getTarget());
+  TEST_ASSERT_EQUAL(20, pc.getRTT());
+}
+
+// queuing delays on some samples: the one with the shortest round trip wins
+void test_min_rtt_filter(void) {
+  PeerClock pc;
+  Peer peer = {0xFFFFF000u, 77u}; // wraps around
+  uint32_t t = 5000;
+  for (int i = 0; i < TIMESYNC_SAMPLES; i++) {
+    unsigned up = 3 + rand() % 5, down = 3 + rand() % 5;
+    if (i % 3 == 0) up += 60 + rand() % 100;  // Wi-Fi power save, retries
+    if (i % 3 == 1) down += 60 + rand() % 100;
+    exchange(pc, peer, t, up, 1, down);
+    t += 250;
+  }
+  int32_t err = int32_t(pc.getTarget() - idealTimebase(peer));
+  char msg[60];
+  snprintf(msg, sizeof(msg), "error %d ms, rtt %u ms", (int)err, pc.getRTT());
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_INT_WITHIN(3, 0, err); // half of the asymmetry of the best sample
+  TEST_ASSERT_LESS_THAN(16, pc.getRTT());
+}
+
+// samples with too long round trip or negative round trip are rejected
+void test_reject(void) {
+  PeerClock pc;
+  Peer peer = {1000, 0};
+  TEST_ASSERT_FALSE(pc.addSample(0, peer.millisAt(200), peer.millisAt(200), TIMESYNC_MAX_RTT + 100, 0));
+  TEST_ASSERT_FALSE(pc.addSample(100, peer.millisAt(100), peer.millisAt(200), 150, 0)); // peer processing longer than round trip
+  TEST_ASSERT_FALSE(pc.isValid());
+}
+
+// phase error is slewed by at most TIMESYNC_SLEW_MS per call, large errors are stepped
+void test_slew_and_step(void) {
+  PeerClock pc;
+  Peer peer = {500, 0};
+  exchange(pc, peer, 1000, 5, 0, 5);
+  uint32_t target = idealTimebase(peer);
+  uint32_t tb = target + 40;
+  TEST_ASSERT_EQUAL(40, pc.phaseError(tb));
+  int calls = 0;
+  while (tb != target && calls < 1000) {
+    uint32_t next = pc.slew(tb);
+    TEST_ASSERT_INT_WITHIN(TIMESYNC_SLEW_MS, 0, int32_t(next - tb));
+    tb = next;
+    calls++;
+  }
+  TEST_ASSERT_EQUAL(40 / TIMESYNC_SLEW_MS, calls);
+  TEST_ASSERT_EQUAL_UINT32(target, pc.slew(target - TIMESYNC_STEP_MS - 1));
+  TEST_ASSERT_EQUAL_UINT32(12345, PeerClock().slew(12345)); // no estimate yet
+}
+
+// peer restarting its effect clock discards the old samples
+void test_peer_step(void) {
+  PeerClock pc;
+  Peer peer = {500, 0};
+  uint32_t t = 1000;
+  for (int i = 0; i < 4; i++, t += 250) exchange(pc, peer, t, 2, 0, 2);
+  TEST_ASSERT_EQUAL(4, pc.getSamples());
+  peer.timebase = 60000;
+  exchange(pc, peer, t, 20, 0, 20); // longer round trip, would lose against the old samples
+  TEST_ASSERT_EQUAL(1, pc.getSamples());
+  TEST_ASSERT_EQUAL_UINT32(idealTimebase(peer), pc.getTarget());
+}
+
+// sync of a follower over time: requests every 2 s, slew every 20 ms
+// once converged the phase error stays within half the round trip of the best sample (NTP error bound)
+void test_simulation(void) {
+  PeerClock pc;
+  Peer peer = {987654u, 31337u};
+  uint32_t timebase = idealTimebase(peer) + 250; // initial step from a notification with unknown delay
+  int32_t maxErr = 0;
+  for (uint32_t now = 0; now < 120000; now += TIMESYNC_SLEW_MS * 20) {
+    if (now % 2000 == 0) exchange(pc, peer, now, 2 + rand() % 30, rand() % 3, 2 + rand() % 30);
+    timebase = pc.slew(timebase);
+    if (now > 30000) {
+      int32_t real = int32_t(timebase - idealTimebase(peer));
+      TEST_ASSERT_LESS_OR_EQUAL(pc.getRTT()/2 + TIMESYNC_SLEW_MS, abs(real));
+      if (abs(real) > maxErr) maxErr = abs(real);
+    }
+  }
+  char msg[60];
+  snprintf(msg, sizeof(msg), "max. phase error %d ms, rtt %u ms", (int)maxErr, pc.getRTT());
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_LESS_THAN(250, maxErr); // vs. the initial step
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_symmetric);
+  RUN_TEST(test_min_rtt_filter);
+  RUN_TEST(test_reject);
+  RUN_TEST(test_slew_and_step);
+  RUN_TEST(test_peer_step);
+  RUN_TEST(test_simulation);
+  return UNITY_END();
+}
@@ -0,0 +1,134 @@
+/*
+ * v13 notifier delta records (wled00/udp_delta.h): encode/decode round trip
+ * Run with: pio test -e native -f test_udp_delta
+ */
+
+#include <unity.h>
+#include <cstring>
+#include <cstdlib>
+#include "../../wled00/udp_delta.h"
+
+// sender side of notify(): segment record of the last full packet and the sticky change mask
+struct Sender {
+  uint8_t base[UDP_SEG_SIZE];
+  uint64_t dirty;
+  void full(const uint8_t *rec) { memcpy(base, rec, UDP_SEG_SIZE); dirty = 0; }
+  size_t delta(const uint8_t *rec, uint8_t *out) {
+    dirty = udpDeltaMask(rec, base, dirty);
+    return dirty ? udpPackDelta(out, rec, dirty) : 0;
+  }
+};
+
+// receiver side of handleNotifications(): own segment record, changed bytes are applied
+static bool receive(uint8_t *own, const uint8_t *pkt, size_t len) {
+  uint8_t rec[UDP_SEG_SIZE];
+  uint64_t mask = 0;
+  memcpy(rec, own, UDP_SEG_SIZE);
+  if (udpUnpackDelta(pkt, len, rec, mask) != len) return false;
+  for (size_t b = 1; b < UDP_SEG_SIZE; b++) if ((mask >> b) & 0x01) own[b] = rec[b];
+  return true;
+}
+
+static uint8_t a[UDP_SEG_SIZE], b[UDP_SEG_SIZE];
+
+void setUp(void) {
+  for (size_t i = 0; i < UDP_SEG_SIZE; i++) a[i] = b[i] = i * 7;
+  a[0] = b[0] = 0; // segment ID
+  b[11] = a[11] + 1; // effect
+  b[15] = a[15] ^ 0xFF; b[16] = a[16] ^ 0xFF; // primary color
+}
+
+void tearDown(void) {}
+
+void test_round_trip(void) {
+  Sender tx; tx.full(a);
+  uint8_t rx[UDP_SEG_SIZE];
+  memcpy(rx, a, UDP_SEG_SIZE);
+  uint8_t pkt[UDP_DELTA_HDR_SIZE + UDP_SEG_SIZE];
+  size_t len = tx.delta(b, pkt);
+  TEST_ASSERT_EQUAL(UDP_DELTA_HDR_SIZE + 3, len);
+  TEST_ASSERT_TRUE(receive(rx, pkt, len));
+  TEST_ASSERT_EQUAL_MEMORY(b, rx, UDP_SEG_SIZE);
+}
+
+// A -> B -> A: the bytes that went back to the full packet values must still be sent
+void test_change_undone(void) {
+  Sender tx; tx.full(a);
+  uint8_t rx[UDP_SEG_SIZE];
+  memcpy(rx, a, UDP_SEG_SIZE);
+  uint8_t pkt[UDP_DELTA_HDR_SIZE + UDP_SEG_SIZE];
+  TEST_ASSERT_TRUE(receive(rx, pkt, tx.delta(b, pkt)));
+  size_t len = tx.delta(a, pkt);
+  TEST_ASSERT_GREATER_THAN(0, len);
+  TEST_ASSERT_TRUE(receive(rx, pkt, len));
+  TEST_ASSERT_EQUAL_MEMORY(a, rx, UDP_SEG_SIZE);
+}
+
+// a lost delta is repaired by the next one
+void test_lost_delta(void) {
+  Sender tx; tx.full(a);
+  uint8_t rx[UDP_SEG_SIZE], c[UDP_SEG_SIZE];
+  memcpy(rx, a, UDP_SEG_SIZE);
+  memcpy(c, a, UDP_SEG_SIZE);
+  c[12] = a[12] + 5; // speed only
+  uint8_t pkt[UDP_DELTA_HDR_SIZE + UDP_SEG_SIZE];
+  tx.delta(b, pkt); // lost
+  TEST_ASSERT_TRUE(receive(rx, pkt, tx.delta(c, pkt)));
+  TEST_ASSERT_EQUAL_MEMORY(c, rx, UDP_SEG_SIZE);
+}
+
+// random changes and losses, the receiver matches the sender after every delta it gets
+void test_random_sequence(void) {
+  srand(1);
+  Sender tx; tx.full(a);
+  uint8_t cur[UDP_SEG_SIZE], rx[UDP_SEG_SIZE];
+  memcpy(cur, a, UDP_SEG_SIZE);
+  memcpy(rx, a, UDP_SEG_SIZE);
+  uint8_t pkt[UDP_DELTA_HDR_SIZE + UDP_SEG_SIZE];
+  for (int step = 0; step < 5000; step++) {
+    int n = rand() % 4;
+    for (int k = 0; k < n; k++) {
+      size_t pos = 1 + rand() % (UDP_SEG_SIZE - 1);
+      cur[pos] = (rand() % 3) ? rand() : a[pos]; // often back to the full packet value
+    }
+    if (rand() % 50 == 0) { // periodic full packet
+      tx.full(cur);
+      memcpy(rx, cur, UDP_SEG_SIZE);
+      continue;
+    }
+    size_t len = tx.delta(cur, pkt);
+    if (rand() % 5 == 0) continue; // lost
+    if (len) TEST_ASSERT_TRUE(receive(rx, pkt, len));
+    TEST_ASSERT_EQUAL_MEMORY(cur, rx, UDP_SEG_SIZE);
+  }
+}
+
+void test_truncated(void) {
+  Sender tx; tx.full(a);
+  uint8_t pkt[UDP_DELTA_HDR_SIZE + UDP_SEG_SIZE], rec[UDP_SEG_SIZE];
+  uint64_t mask;
+  size_t len = tx.delta(b, pkt);
+  for (size_t cut = 0; cut < len; cut++) TEST_ASSERT_EQUAL(0, udpUnpackDelta(pkt, cut, rec, mask));
+  TEST_ASSERT_EQUAL(len, udpUnpackDelta(pkt, len, rec, mask));
+}
+
+// the segment ID (byte 0) and bits beyond the record are never taken from the mask
+void test_mask_bounds(void) {
+  uint8_t pkt[UDP_DELTA_HDR_SIZE] = {3, 0x01, 0, 0, 0, 0xF0}, rec[UDP_SEG_SIZE];
+  memcpy(rec, a, UDP_SEG_SIZE);
+  uint64_t mask;
+  TEST_ASSERT_EQUAL(UDP_DELTA_HDR_SIZE, udpUnpackDelta(pkt, sizeof(pkt), rec, mask));
+  TEST_ASSERT_EQUAL(0, mask);
+  TEST_ASSERT_EQUAL_MEMORY(a, rec, UDP_SEG_SIZE);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_change_undone);
+  RUN_TEST(test_lost_delta);
+  RUN_TEST(test_random_sequence);
+  RUN_TEST(test_truncated);
+  RUN_TEST(test_mask_bounds);
+  return UNITY_END();
+}
@@ -0,0 +1,158 @@
+/*
+ * HTTP API request parser (wled00/win_query.h): replay of a request corpus against the previous parser
+ * Run with: pio test -e native -f test_win_query
+ */
+
+#include <unity.h>
+#include <string>
+#include <cstdio>
+#include "../../wled00/win_query.h"
+
+// search strings of the previous handleSet(), which called indexOf() for each of them on the whole request
+// strings with '=' read the value following them, the others are flags
+static const char *oldKeys[] = {
+  "SM=", "SS=", "SV=", "&S=", "S2=", "GP=", "SP=", "RV=", "MI=", "SB=", "SW=", "PS=", "P1=", "P2=", "PL=",
+  "&A=", "&R=", "&G=", "&B=", "&W=", "R2=", "G2=", "B2=", "W2=", "LX=", "LY=", "HU=", "SA=", "H2", "&K=", "K2",
+  "CL=", "C2=", "C3=", "SR", "SC", "FX=", "SX=", "IX=", "FP=", "X1=", "X2=", "X3=", "M1=", "M2=", "M3=",
+  "FXD=", "OL=", "&M=", "NL=", "ND", "NT=", "NF=", "&T=", "TT=", "ST=", "CT=", "LO=", "RB", "RD=", "RN=",
+  "NM=", "U0=", "U1=", "IN", "NN"
+};
+
+// requests as sent by the UI, IR/button presets, home automation integrations and the documentation
+static const char *corpus[] = {
+  "win",
+  "win&T=2",
+  "win&A=128",
+  "win&A=~10",
+  "win&A=~-10&NN",
+  "win&A=w~25",
+  "win&T=1&A=255&FX=0&CL=hFFAA00",
+  "win&FX=9&SX=200&IX=100&FP=5",
+  "win&FX=r&FP=r",
+  "win&FX=~&SX=~-16",
+  "win&CL=hFF0000&C2=h00FF00&C3=h0000FF",
+  "win&CL=16711680",
+  "win&R=255&G=0&B=0&W=0&R2=0&G2=0&B2=255&W2=0",
+  "win&HU=21845&SA=255",
+  "win&HU=21845&SA=128&H2",
+  "win&K=3000",
+  "win&K=6500&K2",
+  "win&SR=0",
+  "win&SR=1",
+  "win&SR",
+  "win&SC",
+  "win&SM=1&SS=1&SV=2&S=0&S2=30&GP=2&SP=1&RV=1&MI=0&SB=200&SW=1",
+  "win&SS=0&SV=1&RV=0&MI=1",
+  "win&SW=2",
+  "win&NL=10&ND",
+  "win&NL=0",
+  "win&NL=30&NT=5&NF=2",
+  "win&PS=5",
+  "win&PL=3",
+  "win&P1=1&P2=5&PL=~",
+  "win&P1=2&P2=8&PL=~-",
+  "win&TT=500&A=0",
+  "win&TT=0&FX=28&X1=100&X2=50&X3=20&M1=1&M2=0&M3=1",
+  "win&FX=65&FXD=1",
+  "win&LX=100&LY=250",
+  "win&ST=1700000000&CT=1700003600",
+  "win&LO=1",
+  "win&LO=0&RD=1&RN=1",
+  "win&OL=1&M=4",
+  "win&NM=1",
+  "win&U0=10&U1=20",
+  "win&IN&FX=3&A=~8",
+  "win&IN&PL=~&P1=1&P2=4",
+  "win&RB",
+  "win&A=5&A=7",
+  "win&T=0&IN",
+};
+
+// value the previous parser read after a search string, false if not found
+static bool oldFind(const char *req, const char *key, std::string &val) {
+  const char *p = strstr(req, key);
+  if (!p || p == req) return false; // indexOf() > 0
+  p += strlen(key);
+  const char *e = strchr(p, '&');
+  val.assign(p, e ? e - p : strlen(p));
+  return true;
+}
+
+static uint32_t keyOf(const char *oldKey, bool &isFlag) {
+  char k[4] = {0};
+  size_t n = 0;
+  for (const char *c = oldKey; *c && n < 3; c++) if (*c != '&' && *c != '=') k[n++] = *c;
+  isFlag = !strchr(oldKey, '=');
+  return winKey(k);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_corpus_replay(void) {
+  char msg[160];
+  for (const char *req : corpus) {
+    WinQuery q(req);
+    TEST_ASSERT_TRUE(q.valid());
+    for (const char *oldKey : oldKeys) {
+      bool isFlag;
+      uint32_t key = keyOf(oldKey, isFlag);
+      std::string oldVal;
+      bool found = oldFind(req, oldKey, oldVal);
+      snprintf(msg, sizeof(msg), "%s: %s", req, oldKey);
+      if (isFlag) {
+        TEST_ASSERT_EQUAL_MESSAGE(found, q.flag(key), msg);
+        continue;
+      }
+      TEST_ASSERT_EQUAL_MESSAGE(found, q.has(key), msg);
+      if (found) TEST_ASSERT_TRUE_MESSAGE(oldVal == q.get(key), msg);
+    }
+  }
+}
+
+// value parameters need '=', as with the previous parser
+void test_value_needs_equals(void) {
+  WinQuery q("win&RV&A&SX=&FX=5");
+  TEST_ASSERT_FALSE(q.has(WK("RV")));
+  TEST_ASSERT_TRUE(q.flag(WK("RV")));
+  TEST_ASSERT_FALSE(q.has(WK("A")));
+  TEST_ASSERT_EQUAL(0, q.getInt(WK("A")));
+  TEST_ASSERT_TRUE(q.has(WK("SX")));
+  TEST_ASSERT_EQUAL_STRING("", q.get(WK("SX")));
+  TEST_ASSERT_EQUAL(5, q.getInt(WK("FX")));
+}
+
+// keys are matched whole: S= is not found in SS=, T= not in TT=
+void test_whole_keys(void) {
+  WinQuery q("win&SS=2&TT=500");
+  TEST_ASSERT_FALSE(q.has(WK("S")));
+  TEST_ASSERT_FALSE(q.has(WK("T")));
+  TEST_ASSERT_EQUAL(2, q.getInt(WK("SS")));
+  TEST_ASSERT_EQUAL(500, q.getInt(WK("TT")));
+}
+
+void test_not_win(void) {
+  WinQuery q("/json/state");
+  TEST_ASSERT_FALSE(q.valid());
+  TEST_ASSERT_FALSE(q.has(WK("A")));
+}
+
+// many parameters are all kept (no fixed table size)
+void test_long_request(void) {
+  std::string req = "win";
+  for (int i = 0; i < 200; i++) req += "&U0=" + std::to_string(i);
+  req += "&A=9";
+  WinQuery q(req.c_str());
+  TEST_ASSERT_EQUAL(0, q.getInt(WK("U0")));
+  TEST_ASSERT_EQUAL(9, q.getInt(WK("A")));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_corpus_replay);
+  RUN_TEST(test_value_needs_equals);
+  RUN_TEST(test_whole_keys);
+  RUN_TEST(test_not_win);
+  RUN_TEST(test_long_request);
+  return UNITY_END();
+}
@@ -0,0 +1,198 @@
+/*
+ * WebSocket delta state push (wled00/ws_delta.h): deltas applied to the snapshot give the full state
+ * Run with: pio test -e native -f test_ws_delta
+ */
+
+#include <unity.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "../../wled00/src/dependencies/json/ArduinoJson-v6.h"
+#include "../../wled00/ws_delta.h"
+
+#define SEGMENTS 8
+
+// state as serialized by serializeState(), randomly changed between pushes
+struct State {
+  bool on = true;
+  int bri = 128, ps = -1, pl = -1, mainseg = 0;
+  bool nl = false;
+  bool segPresent[SEGMENTS] = {true, true, true};
+  int fx[SEGMENTS] = {0}, sx[SEGMENTS] = {0}, col[SEGMENTS] = {0};
+
+  void change() {
+    switch (rand() % 8) {
+      case 0: on = !on; break;
+      case 1: bri = rand() % 256; break;
+      case 2: ps = rand() % 5 - 1; pl = ps > 2 ? ps : -1; break;
+      case 3: nl = !nl; break; // "nl" added/removed
+      case 4: { int s = rand() % SEGMENTS; segPresent[s] = !segPresent[s]; if (!segPresent[mainseg]) segPresent[mainseg] = true; } break;
+      default: { int s = rand() % SEGMENTS; fx[s] = rand() % 120; sx[s] = rand() % 256; col[s] = rand(); } break;
+    }
+  }
+
+  void serialize(JsonObject root) const {
+    root["on"] = on;
+    root["bri"] = bri;
+    root["transition"] = 7;
+    root["ps"] = ps;
+    root["pl"] = pl;
+    if (nl) { JsonObject n = root.createNestedObject("nl"); n["on"] = true; n["dur"] = 60; }
+    root["mainseg"] = mainseg;
+    JsonArray segs = root.createNestedArray("seg");
+    for (int s = 0; s < SEGMENTS; s++) {
+      if (!segPresent[s]) continue;
+      JsonObject sg = segs.createNestedObject();
+      sg["id"] = s;
+      sg["start"] = s * 10;
+      sg["stop"] = s * 10 + 10;
+      sg["fx"] = fx[s];
+      sg["sx"] = sx[s];
+      sg["col"][0] = col[s];
+    }
+  }
+};
+
+// client side: keys are replaced, null removes, segments are replaced by id, "stop":0 removes
+static void applyDelta(JsonObject client, JsonObjectConst delta) {
+  for (JsonPairConst kv : delta) {
+    if (!strcmp(kv.key().c_str(), "seg")) continue;
+    if (kv.value().isNull()) client.remove(kv.key().c_str());
+    else client[kv.key().c_str()] = kv.value();
+  }
+  JsonArray segs = client["seg"];
+  for (JsonObjectConst sg : delta["seg"].as<JsonArrayConst>()) {
+    int id = sg["id"];
+    int at = -1;
+    for (size_t i = 0; i < segs.size(); i++) if (segs[i]["id"] == id) { at = i; break; }
+    if (sg["stop"] == 0) { if (at >= 0) segs.remove(at); continue; }
+    if (at >= 0) { segs[at] = sg; continue; }
+    size_t pos = 0; // keep segments sorted by id like serializeState()
+    while (pos < segs.size() && segs[pos]["id"].as<int>() < id) pos++;
+    DynamicJsonDocument tmp(4096);
+    JsonArray sorted = tmp.to<JsonArray>();
+    for (size_t i = 0; i < segs.size(); i++) { if (i == pos) sorted.add(sg); sorted.add(segs[i]); }
+    if (pos == segs.size()) sorted.add(sg);
+    client["seg"] = sorted;
+    segs = client["seg"];
+  }
+}
+
+void setUp(void) { srand(32); }
+void tearDown(void) {}
+
+// replay of random changes: snapshot + deltas == full state, unchanged state sends nothing
+void test_replay(void) {
+  WsDeltaState<SEGMENTS> ds;
+  State st;
+  DynamicJsonDocument full(4096), client(8192), msg(4096);
+  st.serialize(msg.to<JsonObject>());
+  TEST_ASSERT_TRUE(ds.reduce(msg.as<JsonObject>())); // first push: everything
+  client.set(msg);
+  size_t fullBytes = 0, deltaBytes = 0;
+  for (int n = 0; n < 2000; n++) {
+    st.change();
+    st.serialize(full.to<JsonObject>());
+    st.serialize(msg.to<JsonObject>());
+    fullBytes += measureJson(full);
+    if (ds.reduce(msg.as<JsonObject>())) {
+      deltaBytes += measureJson(msg);
+      applyDelta(client.as<JsonObject>(), msg.as<JsonObjectConst>());
+      client.garbageCollect(); // replaced members are not freed otherwise
+      TEST_ASSERT_FALSE(client.overflowed());
+    }
+    char m[32];
+    snprintf(m, sizeof(m), "step %d", n);
+    TEST_ASSERT_TRUE_MESSAGE(client.as<JsonObjectConst>() == full.as<JsonObjectConst>(), m); // member order may differ
+  }
+  char m[80];
+  snprintf(m, sizeof(m), "full state %u B, deltas %u B", (unsigned)fullBytes, (unsigned)deltaBytes);
+  TEST_MESSAGE(m);
+  TEST_ASSERT_LESS_THAN(fullBytes / 2, deltaBytes);
+
+  st.serialize(msg.to<JsonObject>());
+  TEST_ASSERT_FALSE(ds.reduce(msg.as<JsonObject>())); // nothing changed
+}
+
+// a single segment change sends only that segment
+void test_single_segment(void) {
+  WsDeltaState<SEGMENTS> ds;
+  State st;
+  DynamicJsonDocument msg(4096);
+  st.serialize(msg.to<JsonObject>());
+  ds.reduce(msg.as<JsonObject>());
+  st.fx[1] = 42;
+  st.serialize(msg.to<JsonObject>());
+  TEST_ASSERT_TRUE(ds.reduce(msg.as<JsonObject>()));
+  TEST_ASSERT_EQUAL(1, msg.size());
+  TEST_ASSERT_EQUAL(1, msg["seg"].size());
+  TEST_ASSERT_EQUAL(1, msg["seg"][0]["id"].as<int>());
+  TEST_ASSERT_EQUAL(42, msg["seg"][0]["fx"].as<int>());
+}
+
+// removed key and segments are announced
+void test_removed(void) {
+  WsDeltaState<SEGMENTS> ds;
+  State st;
+  st.nl = true;
+  DynamicJsonDocument msg(4096);
+  st.serialize(msg.to<JsonObject>());
+  ds.reduce(msg.as<JsonObject>());
+  st.nl = false;
+  st.segPresent[1] = st.segPresent[2] = false;
+  st.serialize(msg.to<JsonObject>());
+  TEST_ASSERT_TRUE(ds.reduce(msg.as<JsonObject>()));
+  TEST_ASSERT_TRUE(msg.containsKey("nl"));
+  TEST_ASSERT_TRUE(msg["nl"].isNull());
+  TEST_ASSERT_EQUAL(2, msg["seg"].size());
+  for (JsonObject sg : msg["seg"].as<JsonArray>()) TEST_ASSERT_EQUAL(0, sg["stop"].as<int>());
+}
+
+// all segments removed: "seg" is created for the removal records
+void test_all_segments_removed(void) {
+  WsDeltaState<SEGMENTS> ds;
+  DynamicJsonDocument msg(1024);
+  deserializeJson(msg, R"({"on":true,"seg":[{"id":0,"stop":30}]})");
+  ds.reduce(msg.as<JsonObject>());
+  deserializeJson(msg, R"({"on":true})");
+  TEST_ASSERT_TRUE(ds.reduce(msg.as<JsonObject>()));
+  TEST_ASSERT_EQUAL(1, msg["seg"].size());
+  TEST_ASSERT_EQUAL(0, msg["seg"][0]["stop"].as<int>());
+}
+
+// after invalidate() (snapshot sent to a single subscriber) everything is sent again
+void test_invalidate(void) {
+  WsDeltaState<SEGMENTS> ds;
+  State st;
+  DynamicJsonDocument full(4096), msg(4096);
+  st.serialize(full.to<JsonObject>());
+  st.serialize(msg.to<JsonObject>());
+  ds.reduce(msg.as<JsonObject>());
+  ds.invalidate();
+  st.serialize(msg.to<JsonObject>());
+  TEST_ASSERT_TRUE(ds.reduce(msg.as<JsonObject>()));
+  TEST_ASSERT_TRUE(msg == full);
+}
+
+// keys too long to be tracked are always sent
+void test_long_key(void) {
+  WsDeltaState<SEGMENTS> ds;
+  DynamicJsonDocument msg(1024);
+  const char *s = R"({"on":true,"a_very_long_usermod_key":1})";
+  deserializeJson(msg, s);
+  ds.reduce(msg.as<JsonObject>());
+  deserializeJson(msg, s);
+  TEST_ASSERT_TRUE(ds.reduce(msg.as<JsonObject>()));
+  TEST_ASSERT_EQUAL(1, msg.size());
+  TEST_ASSERT_TRUE(msg.containsKey("a_very_long_usermod_key"));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_replay);
+  RUN_TEST(test_single_segment);
+  RUN_TEST(test_removed);
+  RUN_TEST(test_all_segments_removed);
+  RUN_TEST(test_invalidate);
+  RUN_TEST(test_long_key);
+  return UNITY_END();
+}
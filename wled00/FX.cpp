@@ -7682,6 +7682,7 @@ void WS2812FX::addEffect(uint8_t id, mode_ptr mode_fn, const char *mode_name) {
     _modeData.push_back(mode_name);
     if (_modeCount < _mode.size()) _modeCount++;
   }
+  _catalogVersion++;
 }
 
 void WS2812FX::setupEffectData() {
@@ -62,6 +62,22 @@
 //#define FRAMETIME        _frametime
 #define FRAMETIME        strip.getFrameTime()
 
+#ifndef WLED_TRANSACTION_TIMEOUT
+  #define WLED_TRANSACTION_TIMEOUT 500 // ms, rendering resumes if a segment transaction is not committed in time
+#endif
+
+// segment palettes are expanded to 256 colors so color_from_palette() is a single lookup (768 bytes per segment)
+#if !defined(ESP8266) && !defined(WLED_DISABLE_PALETTE_LUT)
+  #define WLED_PALETTE_LUT
+  #define PALETTE_LUT_MIN_HEAP 32768 // no new LUTs are allocated below this amount of free heap
+#endif
+#define PALETTE_CACHE_SIZE (MAX_NUM_SEGMENTS+1) // decoded palettes shared by segments (entry 0 is a black fallback)
+
+// source of a segment's current palette (see Segment::getCurrentPalette())
+#define PALETTE_SRC_CACHE      0
+#define PALETTE_SRC_RANDOM     1
+#define PALETTE_SRC_TRANSITION 2
+
 /* each segment uses 52 bytes of SRAM memory, so if you're application fails because of
   insufficient memory, decreasing MAX_NUM_SEGMENTS may help */
 #ifdef ESP8266
@@ -91,7 +107,7 @@
 //#define SEGCOLOR(x)      strip._segments[strip.getCurrSegmentId()].currentColor(x, strip._segments[strip.getCurrSegmentId()].colors[x])
 //#define SEGLEN           strip._segments[strip.getCurrSegmentId()].virtualLength()
 #define SEGCOLOR(x)      strip.segColor(x) /* saves us a few kbytes of code */
-#define SEGPALETTE       Segment::getCurrentPalette()
+#define SEGPALETTE       SEGMENT.getCurrentPalette()
 #define SEGLEN           strip._virtualSegmentLength /* saves us a few kbytes of code */
 #define SPEED_FORMULA_L  (5U + (50U*(255U - SEGMENT.speed))/SEGLEN)
 
@@ -411,13 +427,10 @@ typedef struct Segment {
       };
     };
     uint16_t        _dataLen;
+    uint8_t         _palIdx;                  // palette cache entry (pinned while used), valid if its key matches paletteKey()
+    uint8_t         _palSrc;                  // current palette: cache entry, random palette or transition
     static uint16_t _usedSegmentData;
 
-    // perhaps this should be per segment, not static
-    static CRGBPalette16 _currentPalette;     // palette used for current effect (includes transition, used in color_from_palette())
-    static CRGBPalette16 _randomPalette;      // actual random palette
-    static CRGBPalette16 _newRandomPalette;   // target random palette
-    static unsigned long _lastPaletteChange;  // last random palette change time in millis()
     #ifndef WLED_DISABLE_MODE_BLEND
     static bool          _modeBlend;          // mode/effect blending semaphore
     #endif
@@ -444,6 +457,53 @@ typedef struct Segment {
       {}
     } *_t;
 
+    // random palette (palette 1), allocated while the segment uses it
+    struct RandomPalette {
+      CRGBPalette16 _pal;         // actual random palette
+      CRGBPalette16 _newPal;      // target random palette
+      unsigned long _lastChange;  // last random palette change time in millis()
+      RandomPalette()
+        : _pal(CRGBPalette16(DEFAULT_COLOR))
+        , _newPal(CRGBPalette16(DEFAULT_COLOR))
+        , _lastChange(0)
+      {}
+    } *_rnd;
+
+    // decoded palette shared by all segments using it, segments refer to it by index (_palIdx)
+    // entries no segment refers to are reused least recently used first
+    struct PaletteEntry {
+      CRGBPalette16 _pal;
+      uint32_t      _key;         // loadPalette() inputs (see paletteKey()), 0 if unused
+      uint16_t      _used;        // LRU tick
+      uint8_t       _refs;        // number of segments referring to this entry, not reused while > 0
+      #ifdef WLED_PALETTE_LUT
+      bool          _lutValid;
+      CRGB         *_lut;         // _pal expanded to 256 colors (LINEARBLEND), allocated if enough heap is free
+      #endif
+      PaletteEntry()
+        : _pal(CRGBPalette16(CRGB::Black))
+        , _key(0)
+        , _used(0)
+        , _refs(0)
+      #ifdef WLED_PALETTE_LUT
+        , _lutValid(false)
+        , _lut(nullptr)
+      #endif
+      {}
+    };
+    static std::vector<PaletteEntry> _paletteCache;
+    static uint16_t _paletteTick;
+
+    uint8_t  resolvePalette(uint8_t pal) const;
+    uint32_t paletteKey(uint8_t pal) const;
+    uint8_t  getCachedPalette(uint32_t key);
+    void     releasePalette(void);
+    void     updateRandomPalette(void);
+    #ifdef WLED_PALETTE_LUT
+    static void fillPaletteLUT(PaletteEntry &e);
+    static void freePaletteLUT(PaletteEntry &e);
+    #endif
+
   public:
 
     Segment(uint16_t sStart=0, uint16_t sStop=30) :
@@ -477,7 +537,10 @@ typedef struct Segment {
       data(nullptr),
       _capabilities(0),
       _dataLen(0),
-      _t(nullptr)
+      _palIdx(0),
+      _palSrc(PALETTE_SRC_CACHE),
+      _t(nullptr),
+      _rnd(nullptr)
     {
       #ifdef WLED_DEBUG
       //Serial.printf("-- Creating segment: %p\n", this);
@@ -502,13 +565,15 @@ typedef struct Segment {
       if (name) { delete[] name; name = nullptr; }
       stopTransition();
       deallocateData();
+      delete _rnd;
+      releasePalette();
     }
 
     Segment& operator= (const Segment &orig); // copy assignment
     Segment& operator= (Segment &&orig) noexcept; // move assignment
 
 #ifdef WLED_DEBUG
-    size_t getSize() const { return sizeof(Segment) + (data?_dataLen:0) + (name?strlen(name):0) + (_t?sizeof(Transition):0); }
+    size_t getSize() const { return sizeof(Segment) + (data?_dataLen:0) + (name?strlen(name):0) + (_t?sizeof(Transition):0) + (_rnd?sizeof(RandomPalette):0); }
 #endif
 
     inline bool     getOption(uint8_t n) const { return ((options >> n) & 0x01); }
@@ -527,11 +592,18 @@ typedef struct Segment {
 
     static uint16_t getUsedSegmentData(void)    { return _usedSegmentData; }
     static void     addUsedSegmentData(int len) { _usedSegmentData += len; }
+    #ifdef WLED_PALETTE_LUT
+    static void     freePaletteLUTs(bool all = false); // frees LUTs of unused (or all) palette cache entries, called on low heap
+    #endif
     #ifndef WLED_DISABLE_MODE_BLEND
     static void     modeBlend(bool blend)       { _modeBlend = blend; }
     #endif
-    static void     handleRandomPalette();
-    inline static const CRGBPalette16 &getCurrentPalette(void) { return Segment::_currentPalette; }
+    // palette used by the current effect (includes transition, used in color_from_palette()), set by setCurrentPalette()
+    inline const CRGBPalette16 &getCurrentPalette(void) const {
+      if (_palSrc == PALETTE_SRC_TRANSITION && _t) return _t->_palT;
+      if (_palSrc == PALETTE_SRC_RANDOM && _rnd)   return _rnd->_pal;
+      return _paletteCache[_palIdx < _paletteCache.size() ? _palIdx : 0]._pal;
+    }
 
     void    setUp(uint16_t i1, uint16_t i2, uint8_t grp=1, uint8_t spc=0, uint16_t ofs=UINT16_MAX, uint16_t i1Y=0, uint16_t i2Y=1, uint8_t segId = 255);
     bool    setColor(uint8_t slot, uint32_t c); //returns true if changed
@@ -559,6 +631,7 @@ typedef struct Segment {
     // transition functions
     void     startTransition(uint16_t dur); // transition has to start before actual segment values change
     void     stopTransition(void);
+    inline void alignTransition(unsigned long since, unsigned long t) { if (isInTransition() && _t->_start - since <= t - since) _t->_start = t; } // transitions started after "since" start at "t"
     void     handleTransition(void);
     #ifndef WLED_DISABLE_MODE_BLEND
     void     swapSegenv(tmpsegd_t &tmpSegD);
@@ -570,6 +643,7 @@ typedef struct Segment {
     uint32_t currentColor(uint8_t slot);
     CRGBPalette16 &loadPalette(CRGBPalette16 &tgt, uint8_t pal);
     void     setCurrentPalette(void);
+    void     handleRandomPalette(void);
 
     // 1D strip
     uint16_t virtualLength(void) const;
@@ -722,7 +796,10 @@ class WS2812FX {  // 96 bytes
       _qStopY(0),
       _qGrouping(0),
       _qSpacing(0),
-      _qOffset(0)
+      _qOffset(0),
+      _transactionDepth(0),
+      _transactionStart(0),
+      _catalogVersion(0)
     {
       WS2812FX::instance = this;
       _mode.reserve(_modeCount);     // allocate memory to prevent initial fragmentation (does not increase size())
@@ -765,7 +842,9 @@ class WS2812FX {  // 96 bytes
       fixInvalidSegments(),
       setPixelColor(int n, uint32_t c),
       show(void),
-      setTargetFps(uint8_t fps);
+      setTargetFps(uint8_t fps),
+      beginTransaction(void),
+      commitTransaction(void);
 
     void setColor(uint8_t slot, uint8_t r, uint8_t g, uint8_t b, uint8_t w = 0) { setColor(slot, RGBW32(r,g,b,w)); }
     void fill(uint32_t c) { for (int i = 0; i < getLengthTotal(); i++) setPixelColor(i, c); } // fill whole strip with color (inline)
@@ -789,6 +868,7 @@ class WS2812FX {  // 96 bytes
       deserializeMap(uint8_t n=0);
 
     inline bool isServicing(void) { return _isServicing; }
+    inline bool inTransaction(void) { return _transactionDepth > 0; }
     inline bool hasWhiteChannel(void) {return _hasWhiteChannel;}
     inline bool isOffRefreshRequired(void) {return _isOffRefreshRequired;}
 
@@ -811,6 +891,7 @@ class WS2812FX {  // 96 bytes
     inline uint8_t getPaletteCount() { return 13 + GRADIENT_PALETTE_COUNT; }  // will only return built-in palette count
     inline uint8_t getTargetFps() { return _targetFps; }
     inline uint8_t getModeCount() { return _modeCount; }
+    inline uint16_t getCatalogVersion() { return _catalogVersion; } // changes when effects or custom palettes change
 
     uint16_t
       ablMilliampsMax,
@@ -933,6 +1014,10 @@ class WS2812FX {  // 96 bytes
     uint16_t _qStart, _qStop, _qStartY, _qStopY;
     uint8_t _qGrouping, _qSpacing;
     uint16_t _qOffset;
+    volatile uint8_t _transactionDepth; // changed with a critical section (beginTransaction() may run in the async task)
+    unsigned long    _transactionStart;
+
+    uint16_t _catalogVersion; // invalidates cached effect & palette catalogs (/json/eff, /json/fxda, /json/palx)
 
     uint8_t
       estimateCurrentAndLimitBri(void);
@@ -86,30 +86,32 @@ void WS2812FX::setUpMatrix() {
       // there are no other "key":"value" pairs in it
       // allowed values are: -1 (missing pixel/no LED attached), 0 (inactive/unused pixel), 1 (active/used pixel)
       char    fileName[32]; strcpy_P(fileName, PSTR("/2d-gaps.json")); // reduce flash footprint
-      bool    isFile = WLED_FS.exists(fileName);
+      bool    isFile = fileExists(fileName);
       size_t  gapSize = 0;
       int8_t *gapTable = nullptr;
 
-      if (isFile && requestJSONBufferLock(20)) {
-        DEBUG_PRINT(F("Reading LED gap from "));
-        DEBUG_PRINTLN(fileName);
-        // read the array into global JSON buffer
-        if (readObjectFromFile(fileName, nullptr, &doc)) {
-          // the array is similar to ledmap, except it has only 3 values:
-          // -1 ... missing pixel (do not increase pixel count)
-          //  0 ... inactive pixel (it does count, but should be mapped out (-1))
-          //  1 ... active pixel (it will count and will be mapped)
-          JsonArray map = doc.as<JsonArray>();
-          gapSize = map.size();
-          if (!map.isNull() && gapSize >= customMappingSize) { // not an empty map
-            gapTable = new int8_t[gapSize];
-            if (gapTable) for (size_t i = 0; i < gapSize; i++) {
-              gapTable[i] = constrain(map[i], -1, 1);
+      if (isFile) {
+        JsonLease lease(20);
+        if (lease) {
+          DEBUG_PRINT(F("Reading LED gap from "));
+          DEBUG_PRINTLN(fileName);
+          // read the array into pooled JSON document
+          if (readObjectFromFile(fileName, nullptr, lease.get())) {
+            // the array is similar to ledmap, except it has only 3 values:
+            // -1 ... missing pixel (do not increase pixel count)
+            //  0 ... inactive pixel (it does count, but should be mapped out (-1))
+            //  1 ... active pixel (it will count and will be mapped)
+            JsonArray map = lease->as<JsonArray>();
+            gapSize = map.size();
+            if (!map.isNull() && gapSize >= customMappingSize) { // not an empty map
+              gapTable = new int8_t[gapSize];
+              if (gapTable) for (size_t i = 0; i < gapSize; i++) {
+                gapTable[i] = constrain(map[i], -1, 1);
+              }
             }
           }
+          DEBUG_PRINTLN(F("Gaps loaded."));
         }
-        DEBUG_PRINTLN(F("Gaps loaded."));
-        releaseJSONBufferLock();
       }
 
       uint16_t x, y, pix=0; //pixel
@@ -77,10 +77,8 @@ uint16_t Segment::_usedSegmentData = 0U; // amount of RAM all segments use for t
 uint16_t Segment::maxWidth = DEFAULT_LED_COUNT;
 uint16_t Segment::maxHeight = 1;
 
-CRGBPalette16 Segment::_currentPalette    = CRGBPalette16(CRGB::Black);
-CRGBPalette16 Segment::_randomPalette = CRGBPalette16(DEFAULT_COLOR);
-CRGBPalette16 Segment::_newRandomPalette = CRGBPalette16(DEFAULT_COLOR);
-unsigned long Segment::_lastPaletteChange = 0; // perhaps it should be per segment
+std::vector<Segment::PaletteEntry> Segment::_paletteCache(1); // entry 0: black fallback, never loaded
+uint16_t Segment::_paletteTick = 0;
 
 #ifndef WLED_DISABLE_MODE_BLEND
 bool Segment::_modeBlend = false;
@@ -91,6 +89,9 @@ Segment::Segment(const Segment &orig) {
   //DEBUG_PRINTF("-- Copy segment constructor: %p -> %p\n", &orig, this);
   memcpy((void*)this, (void*)&orig, sizeof(Segment));
   _t = nullptr; // copied segment cannot be in transition
+  _rnd = nullptr;
+  _palIdx = 0; // palette cache entry is looked up again when the copy is rendered
+  _palSrc = PALETTE_SRC_CACHE;
   name = nullptr;
   data = nullptr;
   _dataLen = 0;
@@ -103,6 +104,8 @@ Segment::Segment(Segment &&orig) noexcept {
   //DEBUG_PRINTF("-- Move segment constructor: %p -> %p\n", &orig, this);
   memcpy((void*)this, (void*)&orig, sizeof(Segment));
   orig._t   = nullptr; // old segment cannot be in transition any more
+  orig._rnd = nullptr;
+  orig._palIdx = 0; // palette cache reference is taken over
   orig.name = nullptr;
   orig.data = nullptr;
   orig._dataLen = 0;
@@ -116,9 +119,14 @@ Segment& Segment::operator= (const Segment &orig) {
     if (name) { delete[] name; name = nullptr; }
     stopTransition();
     deallocateData();
+    delete _rnd;
+    releasePalette();
     // copy source
     memcpy((void*)this, (void*)&orig, sizeof(Segment));
     // erase pointers to allocated data
+    _rnd = nullptr;
+    _palIdx = 0;
+    _palSrc = PALETTE_SRC_CACHE;
     data = nullptr;
     _dataLen = 0;
     // copy source data
@@ -135,7 +143,11 @@ Segment& Segment::operator= (Segment &&orig) noexcept {
     if (name) { delete[] name; name = nullptr; } // free old name
     stopTransition();
     deallocateData(); // free old runtime data
+    delete _rnd;
+    releasePalette();
     memcpy((void*)this, (void*)&orig, sizeof(Segment));
+    orig._rnd = nullptr;
+    orig._palIdx = 0;
     orig.name = nullptr;
     orig.data = nullptr;
     orig._dataLen = 0;
@@ -201,7 +213,8 @@ void Segment::resetIfRequired() {
   reset = false;
 }
 
-CRGBPalette16 &Segment::loadPalette(CRGBPalette16 &targetPalette, uint8_t pal) {
+// palette actually loaded for the given palette ID (out of range IDs and effect specific defaults)
+uint8_t Segment::resolvePalette(uint8_t pal) const {
   if (pal < 245 && pal > GRADIENT_PALETTE_COUNT+13) pal = 0;
   if (pal > 245 && (strip.customPalettes.size() == 0 || 255U-pal > strip.customPalettes.size()-1)) pal = 0; // TODO remove strip dependency by moving customPalettes out of strip
   //default palette. Differs depending on effect
@@ -218,23 +231,32 @@ CRGBPalette16 &Segment::loadPalette(CRGBPalette16 &targetPalette, uint8_t pal) {
     case FX_MODE_RAILWAY    : pal =  3; break; // prim + sec
     case FX_MODE_2DSOAP     : pal = 11; break; // rainbow colors
   }
+  return pal;
+}
+
+// identifies the palette produced by loadPalette(), 0 if it changes on its own (random palette)
+uint32_t Segment::paletteKey(uint8_t pal) const {
+  pal = resolvePalette(pal);
+  if (pal == 1) return 0;
+  uint32_t key = pal + 1;
+  if (pal >= 2 && pal <= 5) { // color palettes
+    for (unsigned i = 0; i < NUM_COLORS; i++) key = (key ^ colors[i]) * 16777619UL; // FNV-1a
+    key = (key ^ gammaCorrectCol) * 16777619UL;
+  } else if (pal > 245) {
+    key |= (uint32_t)strip.getCatalogVersion() << 16; // custom palettes reloaded
+  }
+  return key ? key : 1;
+}
+
+CRGBPalette16 &Segment::loadPalette(CRGBPalette16 &targetPalette, uint8_t pal) {
+  pal = resolvePalette(pal);
   switch (pal) {
     case 0: //default palette. Exceptions for specific effects above
       targetPalette = PartyColors_p; break;
-    case 1: {//periodically replace palette with a random one
-      unsigned long timeSinceLastChange = millis() - _lastPaletteChange;
-      if (timeSinceLastChange > randomPaletteChangeTime * 1000U) {
-        _randomPalette = _newRandomPalette;
-        _newRandomPalette = CRGBPalette16(
-                        CHSV(random8(), random8(160, 255), random8(128, 255)),
-                        CHSV(random8(), random8(160, 255), random8(128, 255)),
-                        CHSV(random8(), random8(160, 255), random8(128, 255)),
-                        CHSV(random8(), random8(160, 255), random8(128, 255)));
-        _lastPaletteChange = millis();
-        handleRandomPalette(); // do a 1st pass of blend
-      }
-      targetPalette = _randomPalette;
-      break;}
+    case 1: //periodically replace palette with a random one
+      updateRandomPalette();
+      targetPalette = _rnd ? _rnd->_pal : CRGBPalette16(DEFAULT_COLOR);
+      break;
     case 2: {//primary color only
       CRGB prim = gamma32(colors[0]);
       targetPalette = CRGBPalette16(prim); break;}
@@ -450,24 +472,109 @@ uint32_t Segment::currentColor(uint8_t slot) {
 #endif
 }
 
+// selects the palette for the effect (getCurrentPalette()), palettes are only decoded if not already cached
 void Segment::setCurrentPalette() {
-  loadPalette(_currentPalette, palette);
+  uint32_t key = paletteKey(palette);
+  if (key) {
+    if (_rnd) { delete _rnd; _rnd = nullptr; } // random palette no longer used
+    if (!_palIdx || _paletteCache[_palIdx]._key != key) {
+      releasePalette();
+      _palIdx = getCachedPalette(key);
+      if (_palIdx) _paletteCache[_palIdx]._refs++;
+    }
+    _paletteCache[_palIdx]._used = ++_paletteTick;
+    _palSrc = PALETTE_SRC_CACHE;
+  } else {
+    updateRandomPalette();
+    releasePalette();
+    _palSrc = _rnd ? PALETTE_SRC_RANDOM : PALETTE_SRC_CACHE;
+  }
   unsigned prog = progress();
   if (strip.paletteFade && prog < 0xFFFFU) {
     // blend palettes
     // there are about 255 blend passes of 48 "blends" to completely blend two palettes (in _dur time)
     // minimum blend time is 100ms maximum is 65535ms
+    CRGBPalette16 &target = _palSrc == PALETTE_SRC_RANDOM ? _rnd->_pal : _paletteCache[_palIdx]._pal;
     unsigned noOfBlends = ((255U * prog) / 0xFFFFU) - _t->_prevPaletteBlends;
-    for (unsigned i = 0; i < noOfBlends; i++, _t->_prevPaletteBlends++) nblendPaletteTowardPalette(_t->_palT, _currentPalette, 48);
-    _currentPalette = _t->_palT; // copy transitioning/temporary palette
+    for (unsigned i = 0; i < noOfBlends; i++, _t->_prevPaletteBlends++) nblendPaletteTowardPalette(_t->_palT, target, 48);
+    _palSrc = PALETTE_SRC_TRANSITION; // use transitioning/temporary palette
+  }
+}
+
+// returns the index of the cache entry holding the palette with the given key, loads it into a free or the least recently used entry if needed
+// entries referred to by a segment are never reused, there is one entry per segment so one is always free
+uint8_t Segment::getCachedPalette(uint32_t key) {
+  size_t idx = 0;
+  for (size_t i = 1; i < _paletteCache.size(); i++) {
+    if (_paletteCache[i]._key == key) return i;
+    if (_paletteCache[i]._refs) continue;
+    if (!idx || (uint16_t)(_paletteTick - _paletteCache[i]._used) > (uint16_t)(_paletteTick - _paletteCache[idx]._used)) idx = i;
+  }
+  if (!idx && _paletteCache.size() < PALETTE_CACHE_SIZE) {
+    if (_paletteCache.size() == _paletteCache.capacity()) _paletteCache.reserve(min(2 * _paletteCache.size(), (size_t)PALETTE_CACHE_SIZE)); // don't grow beyond cache size
+    _paletteCache.emplace_back();
+    idx = _paletteCache.size() - 1;
+  }
+  if (!idx) return 0; // all entries in use (segment copies), black fallback
+  PaletteEntry &e = _paletteCache[idx];
+  loadPalette(e._pal, palette);
+  e._key = key;
+  #ifdef WLED_PALETTE_LUT
+  e._lutValid = false;
+  uint32_t heap = ESP.getFreeHeap();
+  if (e._lut && heap < PALETTE_LUT_MIN_HEAP/2) freePaletteLUT(e); // give the LUT of the evicted palette back
+  else if (!e._lut && heap > PALETTE_LUT_MIN_HEAP) e._lut = (CRGB*) malloc(256 * sizeof(CRGB));
+  #endif
+  return idx;
+}
+
+// drops the segment's reference to its palette cache entry
+void Segment::releasePalette() {
+  if (_palIdx && _palIdx < _paletteCache.size() && _paletteCache[_palIdx]._refs) _paletteCache[_palIdx]._refs--;
+  _palIdx = 0;
+}
+
+#ifdef WLED_PALETTE_LUT
+// expands a cached palette into its LUT, done on first use after the entry was loaded
+void Segment::fillPaletteLUT(PaletteEntry &e) {
+  for (unsigned i = 0; i < 256; i++) e._lut[i] = ColorFromPalette(e._pal, i, 255, LINEARBLEND);
+  e._lutValid = true;
+}
+
+void Segment::freePaletteLUT(PaletteEntry &e) {
+  free(e._lut);
+  e._lut = nullptr;
+  e._lutValid = false;
+}
+
+// segments whose LUT is freed fall back to ColorFromPalette(), a new LUT is only allocated when the entry is reloaded
+void Segment::freePaletteLUTs(bool all) {
+  for (PaletteEntry &e : _paletteCache) if (e._lut && (all || !e._refs)) freePaletteLUT(e);
+}
+#endif
+
+// periodically picks a new target for the segment's random palette
+void Segment::updateRandomPalette() {
+  if (!_rnd) _rnd = new RandomPalette();
+  if (!_rnd) return; // failed to allocate
+  if (millis() - _rnd->_lastChange > randomPaletteChangeTime * 1000U) {
+    _rnd->_pal = _rnd->_newPal;
+    _rnd->_newPal = CRGBPalette16(
+                    CHSV(random8(), random8(160, 255), random8(128, 255)),
+                    CHSV(random8(), random8(160, 255), random8(128, 255)),
+                    CHSV(random8(), random8(160, 255), random8(128, 255)),
+                    CHSV(random8(), random8(160, 255), random8(128, 255)));
+    _rnd->_lastChange = millis();
+    handleRandomPalette(); // do a 1st pass of blend
   }
 }
 
 // relies on WS2812FX::service() to call it max every 8ms or more (MIN_SHOW_DELAY)
 void Segment::handleRandomPalette() {
-  // just do a blend; if the palettes are identical it will just compare 48 bytes (same as _randomPalette == _newRandomPalette)
-  // this will slowly blend _newRandomPalette into _randomPalette every 15ms or 8ms (depending on MIN_SHOW_DELAY)
-  nblendPaletteTowardPalette(_randomPalette, _newRandomPalette, 48);
+  if (!_rnd) return;
+  // just do a blend; if the palettes are identical it will just compare 48 bytes (same as _pal == _newPal)
+  // this will slowly blend _newPal into _pal every 15ms or 8ms (depending on MIN_SHOW_DELAY)
+  nblendPaletteTowardPalette(_rnd->_pal, _rnd->_newPal, 48);
 }
 
 // segId is given when called from network callback, changes are queued if that segment is currently in its effect function
@@ -1079,7 +1186,19 @@ uint32_t Segment::color_from_palette(uint16_t i, bool mapping, bool wrap, uint8_
   uint8_t paletteIndex = i;
   if (mapping && virtualLength() > 1) paletteIndex = (i*255)/(virtualLength() -1);
   if (!wrap && strip.paletteBlend != 3) paletteIndex = scale8(paletteIndex, 240); //cut off blend at palette "end"
-  CRGB fastled_col = ColorFromPalette(_currentPalette, paletteIndex, pbri, (strip.paletteBlend == 3)? NOBLEND:LINEARBLEND); // NOTE: paletteBlend should be global
+  #ifdef WLED_PALETTE_LUT
+  if (_palSrc == PALETTE_SRC_CACHE && _palIdx < _paletteCache.size() && _paletteCache[_palIdx]._lut && strip.paletteBlend != 3) {
+    PaletteEntry &e = _paletteCache[_palIdx];
+    if (!e._lutValid) fillPaletteLUT(e);
+    CRGB fastled_col = e._lut[paletteIndex];
+    if (pbri != 255) { // same scaling as ColorFromPalette()
+      if (pbri) fastled_col.nscale8(pbri + 1);
+      else      fastled_col = CRGB::Black;
+    }
+    return RGBW32(fastled_col.r, fastled_col.g, fastled_col.b, 0);
+  }
+  #endif
+  CRGB fastled_col = ColorFromPalette(getCurrentPalette(), paletteIndex, pbri, (strip.paletteBlend == 3)? NOBLEND:LINEARBLEND); // NOTE: paletteBlend should be global
 
   return RGBW32(fastled_col.r, fastled_col.g, fastled_col.b, 0);
 }
@@ -1098,11 +1217,6 @@ void WS2812FX::finalizeInit(void)
     seg.resetIfRequired();
   }
 
-  // for the lack of better place enumerate ledmaps here
-  // if we do it in json.cpp (serializeInfo()) we are getting flashes on LEDs
-  // unfortunately this means we do not get updates after uploads
-  enumerateLedmaps();
-
   _hasWhiteChannel = _isOffRefreshRequired = false;
 
   //if busses failed to load, add default (fresh install, FS issue, ...)
@@ -1163,8 +1277,12 @@ void WS2812FX::service() {
   bool doShow = false;
 
   _isServicing = true;
+  // segments are being changed by a transaction, render them once it is committed
+  if (_transactionDepth && nowUp - _transactionStart < WLED_TRANSACTION_TIMEOUT) {
+    _isServicing = false;
+    return;
+  }
   _segment_index = 0;
-  Segment::handleRandomPalette(); // move it into for loop when each segment has individual random palette
   for (segment &seg : _segments) {
     // process transition (mode changes in the middle of transition)
     seg.handleTransition();
@@ -1172,6 +1290,7 @@ void WS2812FX::service() {
     seg.resetIfRequired();
 
     if (!seg.isActive()) continue;
+    seg.handleRandomPalette(); // blend random palette every service() call, independent of effect timing
 
     // last condition ensures all solid segments are updated at the same time
     if (nowUp > seg.next_time || _triggered || (doShow && seg.mode == FX_MODE_STATIC))
@@ -1559,6 +1678,42 @@ void WS2812FX::setUpSegmentFromQueuedChanges() {
   _queuedChangesSegId = 255;
 }
 
+#ifdef ARDUINO_ARCH_ESP32
+static portMUX_TYPE transactionMux = portMUX_INITIALIZER_UNLOCKED;
+#define TRANSACTION_LOCK()   portENTER_CRITICAL(&transactionMux)
+#define TRANSACTION_UNLOCK() portEXIT_CRITICAL(&transactionMux)
+#else
+#define TRANSACTION_LOCK()
+#define TRANSACTION_UNLOCK()
+#endif
+
+// render pause: segment changes (i.e. from a JSON state update) are applied as they come, but rendered
+// only after commitTransaction(), so they show up in the same frame; transactions may be nested
+void WS2812FX::beginTransaction() {
+  TRANSACTION_LOCK();
+  bool first = !_transactionDepth++;
+  if (first) _transactionStart = millis();
+  TRANSACTION_UNLOCK();
+  if (!first) return;
+  #ifdef ARDUINO_ARCH_ESP32
+  // service() runs in another task, let it finish the current frame
+  while (_isServicing && millis() - _transactionStart < FRAMETIME_FIXED) delay(1);
+  #endif
+}
+
+// makes all transitions started during the pause run in sync and resumes rendering
+void WS2812FX::commitTransaction() {
+  TRANSACTION_LOCK();
+  bool last = _transactionDepth && !--_transactionDepth;
+  TRANSACTION_UNLOCK();
+  if (!last) return;
+  if (_mainSegment >= _segments.size()) setMainSegmentId(0); // main segment was deleted
+  unsigned long t = millis();
+  for (segment &seg : _segments) seg.alignTransition(_transactionStart, t);
+  DEBUG_PRINT(F("Transaction committed in ")); DEBUG_PRINT(t - _transactionStart); DEBUG_PRINTLN(F("ms"));
+  trigger(); // render all segments in the next frame
+}
+
 void WS2812FX::restartRuntime() {
   for (segment &seg : _segments) seg.markForReset();
 }
@@ -1727,12 +1882,13 @@ void WS2812FX::loadCustomPalettes() {
   byte tcp[72]; //support gradient palettes with up to 18 entries
   CRGBPalette16 targetPalette;
   customPalettes.clear(); // start fresh
+  _catalogVersion++;
   for (int index = 0; index<10; index++) {
     char fileName[32];
     sprintf_P(fileName, PSTR("/palette%d.json"), index);
 
     StaticJsonDocument<1536> pDoc; // barely enough to fit 72 numbers
-    if (WLED_FS.exists(fileName)) {
+    if (fileExists(fileName)) {
       DEBUG_PRINT(F("Reading palette from "));
       DEBUG_PRINTLN(fileName);
 
@@ -1780,7 +1936,7 @@ bool WS2812FX::deserializeMap(uint8_t n) {
   strcpy_P(fileName, PSTR("/ledmap"));
   if (n) sprintf(fileName +7, "%d", n);
   strcat_P(fileName, PSTR(".json"));
-  bool isFile = WLED_FS.exists(fileName);
+  bool isFile = fileExists(fileName);
 
   if (!isFile) {
     // erase custom mapping if selecting nonexistent ledmap.json (n==0)
@@ -1792,10 +1948,10 @@ bool WS2812FX::deserializeMap(uint8_t n) {
     return false;
   }
 
-  if (!requestJSONBufferLock(7)) return false;
+  JsonLease lease(7);
+  if (!lease) return false;
 
-  if (!readObjectFromFile(fileName, nullptr, &doc)) {
-    releaseJSONBufferLock();
+  if (!readObjectFromFile(fileName, nullptr, lease.get())) {
     return false; //if file does not exist just exit
   }
 
@@ -1809,7 +1965,7 @@ bool WS2812FX::deserializeMap(uint8_t n) {
     customMappingTable = nullptr;
   }
 
-  JsonArray map = doc[F("map")];
+  JsonArray map = (*lease)[F("map")];
   if (!map.isNull() && map.size()) {  // not an empty map
     customMappingSize  = map.size();
     customMappingTable = new uint16_t[customMappingSize];
@@ -1818,7 +1974,6 @@ bool WS2812FX::deserializeMap(uint8_t n) {
     }
   }
 
-  releaseJSONBufferLock();
   return true;
 }
 
@@ -0,0 +1,157 @@
+#include "wled.h"
+
+/*
+ * Binary control API (see binapi.h for the packet format)
+ * Maps onto the same Segment setters as deserializeSegment()
+ */
+
+static void applyBinSegment(uint8_t id, const uint8_t *data, uint8_t len)
+{
+  if (id >= strip.getMaxSegments()) return;
+
+  BinReader rd(data, len);
+  uint8_t type, vlen;
+  const uint8_t *v;
+
+  // bounds first, a new segment is only created if bounds are given
+  bool newSeg = id >= strip.getSegmentsNum();
+  Segment& cur = strip.getSegment(id);
+  uint16_t start = cur.start, stop = cur.stop, startY = cur.startY, stopY = cur.stopY, of = UINT16_MAX;
+  uint8_t grp = cur.grouping, spc = cur.spacing;
+  if (newSeg) { grp = 1; spc = 0; startY = 0; stopY = 1; }
+  bool bounds = false;
+  while (rd.next(type, v, vlen)) {
+    switch (type) {
+      case BIN_S_BOUNDS:
+        start = binU16(v); stop = binU16(v+2);
+        if (vlen >= 8) { startY = binU16(v+4); stopY = binU16(v+6); }
+        bounds = true;
+        break;
+      case BIN_S_GROUPING: grp = v[0]; spc = v[1]; bounds = true; break;
+      case BIN_S_OFFSET:   of = binU16(v);         bounds = true; break;
+    }
+  }
+  if (newSeg) {
+    if (!bounds || stop <= start) return; // ignore empty/inactive segments
+    strip.setSegment(id, start, stop, grp, spc, of, startY, stopY);
+    id = strip.getSegmentsNum()-1; // segments are added at the end of list
+  } else if (bounds) {
+    strip.setSegment(id, start, stop, grp, spc, of, startY, stopY);
+  }
+  Segment& seg = strip.getSegment(id);
+  if (newSeg) seg.refreshLightCapabilities();
+
+  rd = BinReader(data, len);
+  while (rd.next(type, v, vlen)) {
+    switch (type) {
+      case BIN_S_ON:
+        seg.setOption(SEG_OPTION_ON, v[0] == 2 ? !seg.on : v[0]); // use transition
+        break;
+      case BIN_S_BRI:
+        if (v[0] > 0) seg.setOpacity(v[0]);
+        seg.setOption(SEG_OPTION_ON, v[0]); // use transition
+        break;
+      case BIN_S_COLOR:
+        if (v[0] >= NUM_COLORS) break;
+        if (seg.getLightCapabilities() & 3) seg.setColor(v[0], RGBW32(v[1], v[2], v[3], vlen > 4 ? v[4] : 0));
+        break;
+      case BIN_S_CCT:
+        seg.setCCT(binU16(v));
+        break;
+      case BIN_S_FX:
+        if (currentPlaylist >= 0) unloadPlaylist();
+        if (v[0] != seg.mode) seg.setMode(v[0], vlen > 1 && v[1]);
+        break;
+      case BIN_S_SPEED:
+        if (seg.speed != v[0]) { seg.speed = v[0]; stateChanged = true; }
+        break;
+      case BIN_S_INTENSITY:
+        if (seg.intensity != v[0]) { seg.intensity = v[0]; stateChanged = true; }
+        break;
+      case BIN_S_PALETTE:
+        if (seg.getLightCapabilities() & 1) seg.setPalette(v[0]); // ignore palette for White and On/Off segments
+        break;
+      case BIN_S_CUSTOM:
+        seg.custom1 = v[0];
+        seg.custom2 = v[1];
+        seg.custom3 = constrain(v[2], 0, 31);
+        stateChanged = true;
+        break;
+      case BIN_S_OPTIONS: {
+        uint8_t m = v[0], o = v[1];
+        if (m & 0x01) seg.selected  = o & 0x01;
+        if (m & 0x02) seg.reverse   = o & 0x02;
+        if (m & 0x04) seg.mirror    = o & 0x04;
+        if (m & 0x08) seg.freeze    = o & 0x08;
+        if (m & 0x10) seg.check1    = o & 0x10;
+        if (m & 0x20) seg.check2    = o & 0x20;
+        if (m & 0x40) seg.check3    = o & 0x40;
+        if (m & 0x7E) stateChanged = true; // selection alone does not need a broadcast
+        break;
+      }
+    }
+  }
+}
+
+// applies a binary control packet, returns BINAPI_OK or an error code
+uint8_t handleBinaryControl(const uint8_t *data, size_t len, byte callMode)
+{
+  uint8_t err = binValidate(data, len);
+  if (err != BINAPI_OK) {
+    DEBUG_PRINT(F("Binary API error: ")); DEBUG_PRINTLN(err);
+    return err;
+  }
+  if (data[2] & BINAPI_F_NO_NOTIFY) callMode = CALL_MODE_NO_NOTIFY;
+
+  BinReader rd(data + BINAPI_HEADER_LEN, len - BINAPI_HEADER_LEN);
+  uint8_t type, vlen;
+  const uint8_t *v;
+  bool onBefore = bri;
+  bool segTransaction = false;
+  while (rd.next(type, v, vlen)) {
+    switch (type) {
+      case BIN_ON:
+        if (v[0] == 2 || !v[0] != !bri) toggleOnOff();
+        break;
+      case BIN_BRI:
+        bri = v[0];
+        break;
+      case BIN_TRANSITION:
+        transitionDelay = binU16(v) * 100;
+        if (fadeTransition) strip.setTransition(transitionDelay);
+        break;
+      case BIN_TT:
+        jsonTransitionOnce = true;
+        if (fadeTransition) strip.setTransition(binU16(v) * 100);
+        break;
+      case BIN_MAINSEG:
+        if (!realtimeMode) strip.setMainSegmentId(v[0]);
+        break;
+      case BIN_PRESET:
+        if (v[0] == 0 || v[0] > 250) break;
+        if (segTransaction) strip.commitTransaction();
+        presetCycCurr = v[0];
+        unloadPlaylist();              // applying a preset unloads the playlist
+        applyPreset(v[0], callMode);   // async load from file system
+        return BINAPI_OK;
+      case BIN_SEG:
+        if (!segTransaction) strip.beginTransaction(); // render all segment changes in the same frame
+        segTransaction = true;
+        applyBinSegment(v[0], v + 1, vlen - 1);
+        break;
+    }
+  }
+  if (segTransaction) strip.commitTransaction();
+
+  if (bri && !onBefore) { // unfreeze all segments when turning on
+    for (size_t s=0; s < strip.getSegmentsNum(); s++) {
+      strip.getSegment(s).freeze = false;
+    }
+    if (realtimeMode && !realtimeOverride && useMainSegmentOnly) { // keep live segment frozen if live
+      strip.getMainSegment().freeze = true;
+    }
+  }
+
+  stateUpdated(callMode);
+  return BINAPI_OK;
+}
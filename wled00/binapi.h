@@ -0,0 +1,110 @@
+#ifndef WLED_BINAPI_H
+#define WLED_BINAPI_H
+
+/*
+ * Compact binary control API (WebSocket binary frames, UDP notifier port)
+ * Packet: magic, version, flags, followed by TLV records: type (1 byte), length (1 byte), value
+ * Multi byte values are little endian, records are applied in order, unknown record types are skipped.
+ * A segment record (BIN_SEG) holds the segment ID followed by nested segment (BIN_S_*) records.
+ * Reader and validation are free of Arduino calls so they can be run on the host.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define BINAPI_MAGIC       0xBC
+#define BINAPI_VERSION     1    // incompatible changes only, new record types do not need a new version
+#define BINAPI_HEADER_LEN  3
+
+// packet flags
+#define BINAPI_F_NO_NOTIFY 0x01 // do not send UDP notification for this command
+#define BINAPI_F_STATE     0x02 // WS: reply with full JSON state instead of binary acknowledge
+
+// result codes (binary acknowledge: magic, version, result)
+#define BINAPI_OK          0
+#define BINAPI_ERR_FORMAT  1    // bad header or truncated record
+#define BINAPI_ERR_VERSION 2
+#define BINAPI_ERR_BUSY    3    // state is being changed by another task, retry
+
+// global records
+#define BIN_ON             0x01 // u8: 0 off, 1 on, 2 toggle
+#define BIN_BRI            0x02 // u8
+#define BIN_TRANSITION     0x03 // u16, 100ms units (as "transition")
+#define BIN_TT             0x04 // u16, 100ms units, this command only (as "tt")
+#define BIN_PRESET         0x05 // u8, 1-250 (as "ps"), remaining records are ignored
+#define BIN_MAINSEG        0x06 // u8
+#define BIN_SEG            0x10 // u8 segment ID, nested segment records
+// segment records
+#define BIN_S_BOUNDS       0x20 // u16 start, u16 stop [, u16 startY, u16 stopY]
+#define BIN_S_GROUPING     0x21 // u8 grouping, u8 spacing
+#define BIN_S_OFFSET       0x22 // u16
+#define BIN_S_ON           0x23 // u8: 0 off, 1 on, 2 toggle
+#define BIN_S_BRI          0x24 // u8 opacity
+#define BIN_S_COLOR        0x25 // u8 slot, u8 r, g, b [, w]
+#define BIN_S_CCT          0x26 // u16, 0-255 or kelvin
+#define BIN_S_FX           0x27 // u8 effect [, u8 load effect defaults]
+#define BIN_S_SPEED        0x28 // u8
+#define BIN_S_INTENSITY    0x29 // u8
+#define BIN_S_PALETTE      0x2A // u8
+#define BIN_S_CUSTOM       0x2B // u8 c1, c2, c3
+#define BIN_S_OPTIONS      0x2C // u8 mask, u8 value; bits: 0 selected, 1 reverse, 2 mirror, 3 freeze, 4-6 check1-3
+
+class BinReader {
+  const uint8_t *_p;
+  const uint8_t *_end;
+
+  public:
+    BinReader(const uint8_t *data, size_t len) : _p(data), _end(data + len) {}
+
+    // returns false at the end or if the next record is truncated
+    bool next(uint8_t &type, const uint8_t* &val, uint8_t &len) {
+      if (_end - _p < 2) return false;
+      if (_end - _p - 2 < _p[1]) return false;
+      type = _p[0];
+      len  = _p[1];
+      val  = _p + 2;
+      _p  += 2 + len;
+      return true;
+    }
+    inline bool atEnd() const { return _p == _end; }
+};
+
+inline uint16_t binU16(const uint8_t *v) { return v[0] | (v[1] << 8); }
+
+// minimum value length of known record types (0 for unknown types, which are skipped)
+inline uint8_t binMinLen(uint8_t type) {
+  switch (type) {
+    case BIN_TRANSITION: case BIN_TT: case BIN_S_OFFSET: case BIN_S_CCT:
+    case BIN_S_GROUPING: case BIN_S_OPTIONS:
+      return 2;
+    case BIN_S_CUSTOM:
+      return 3;
+    case BIN_S_BOUNDS: case BIN_S_COLOR:
+      return 4;
+    case BIN_ON: case BIN_BRI: case BIN_PRESET: case BIN_MAINSEG: case BIN_SEG:
+    case BIN_S_ON: case BIN_S_BRI: case BIN_S_FX: case BIN_S_SPEED: case BIN_S_INTENSITY: case BIN_S_PALETTE:
+      return 1;
+  }
+  return 0;
+}
+
+// checks the whole packet before anything is applied
+inline uint8_t binValidate(const uint8_t *data, size_t len) {
+  if (len < BINAPI_HEADER_LEN || data[0] != BINAPI_MAGIC) return BINAPI_ERR_FORMAT;
+  if (data[1] != BINAPI_VERSION) return BINAPI_ERR_VERSION;
+  BinReader rd(data + BINAPI_HEADER_LEN, len - BINAPI_HEADER_LEN);
+  uint8_t type, vlen;
+  const uint8_t *v;
+  while (rd.next(type, v, vlen)) {
+    if (vlen < binMinLen(type)) return BINAPI_ERR_FORMAT;
+    if (type != BIN_SEG) continue;
+    BinReader srd(v + 1, vlen - 1);
+    uint8_t stype, svlen;
+    const uint8_t *sv;
+    while (srd.next(stype, sv, svlen)) if (svlen < binMinLen(stype)) return BINAPI_ERR_FORMAT;
+    if (!srd.atEnd()) return BINAPI_ERR_FORMAT;
+  }
+  return rd.atEnd() ? BINAPI_OK : BINAPI_ERR_FORMAT;
+}
+
+#endif
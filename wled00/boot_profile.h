@@ -0,0 +1,39 @@
+#ifndef WLED_BOOT_PROFILE_H
+#define WLED_BOOT_PROFILE_H
+
+/*
+ * Boot phase timestamps (/json/info "boot"): ms since power-up at the end of each phase, 0 if not reached yet.
+ * Each phase is recorded once, so reconnects and bus re-initialization do not move it.
+ * Free of Arduino calls (times are passed in) so the boot sequence can be replayed on the host.
+ */
+
+#include <stdint.h>
+
+#define BOOT_FS          0  // file system mounted
+#define BOOT_CFG         1  // config read
+#define BOOT_STRIP       2  // busses and strip initialized
+#define BOOT_FRAME       3  // first frame (boot preset) shown
+#define BOOT_USERMODS    4  // usermods set up
+#define BOOT_SETUP       5  // web server initialized, end of setup()
+#define BOOT_DEFERRED    6  // deferred initialization done in first loop (ledmap names)
+#define BOOT_NETWORK     7  // network connected
+#define BOOT_PHASES      8
+
+class BootProfile {
+  uint32_t _t[BOOT_PHASES] = {0};
+
+  public:
+    // returns true if this is the first time the phase ended
+    bool mark(uint8_t phase, uint32_t now) {
+      if (phase >= BOOT_PHASES || _t[phase]) return false;
+      _t[phase] = now ? now : 1; // 0 means not reached
+      return true;
+    }
+
+    bool reached(uint8_t phase) const { return phase < BOOT_PHASES && _t[phase]; }
+    uint32_t operator[](uint8_t phase) const { return phase < BOOT_PHASES ? _t[phase] : 0; }
+
+    void addTo(JsonArray arr) const { for (uint8_t i = 0; i < BOOT_PHASES; i++) arr.add(_t[i]); }
+};
+
+#endif
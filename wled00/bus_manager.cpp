@@ -464,9 +464,35 @@ uint8_t BusOnOff::getPins(uint8_t* pinArray) {
 }
 
 
+// network bus send queues are shared between render loop and sender task
+#ifdef ARDUINO_ARCH_ESP32
+static portMUX_TYPE netQueueMux = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t netSendTask = nullptr;
+#define NETQ_LOCK()   portENTER_CRITICAL(&netQueueMux)
+#define NETQ_UNLOCK() portEXIT_CRITICAL(&netQueueMux)
+
+static void netSendTaskFn(void *) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(5)); // woken by BusNetwork::show(), timeout serves paced frames
+    BusNetwork::sendQueued();
+  }
+}
+#else
+#define NETQ_LOCK()
+#define NETQ_UNLOCK()
+#endif
+
+BusNetwork* BusNetwork::_netBusses[WLED_MAX_BUSSES+WLED_MIN_VIRTUAL_BUSSES] = {nullptr};
+
 BusNetwork::BusNetwork(BusConfig &bc)
 : Bus(bc.type, bc.start, bc.autoWhite, bc.count)
-, _broadcastLock(false)
+, _maxFps(bc.frequency)
+, _lastSent(0)
+, _dropped(0)
+, _queue(nullptr)
+, _qHead(0)
+, _qCount(0)
+, _sending(false)
 {
   switch (bc.type) {
     case TYPE_NET_ARTNET_RGB:
@@ -485,6 +511,19 @@ BusNetwork::BusNetwork(BusConfig &bc)
   _UDPchannels = _rgbw ? 4 : 3;
   _client = IPAddress(bc.pins[0],bc.pins[1],bc.pins[2],bc.pins[3]);
   _valid = (allocData(_len * _UDPchannels) != nullptr);
+  if (!_valid) return;
+  _queue = (uint8_t *)malloc(WLED_NET_QUEUE_LEN * _len * _UDPchannels);
+  if (!_queue) {
+    _valid = false;
+    freeData();
+    return;
+  }
+  NETQ_LOCK();
+  for (size_t i = 0; i < WLED_MAX_BUSSES+WLED_MIN_VIRTUAL_BUSSES; i++) if (!_netBusses[i]) { _netBusses[i] = this; break; }
+  NETQ_UNLOCK();
+  #ifdef ARDUINO_ARCH_ESP32
+  if (!netSendTask) xTaskCreatePinnedToCore(netSendTaskFn, "netBusSend", 4096, nullptr, 1, &netSendTask, 0);
+  #endif
 }
 
 void BusNetwork::setPixelColor(uint16_t pix, uint32_t c) {
@@ -504,11 +543,56 @@ uint32_t BusNetwork::getPixelColor(uint16_t pix) {
   return RGBW32(_data[offset], _data[offset+1], _data[offset+2], (_rgbw ? _data[offset+3] : 0));
 }
 
+// enqueue finished frame, actual sending is done by sendQueued()
 void BusNetwork::show() {
-  if (!_valid || !canShow()) return;
-  _broadcastLock = true;
-  realtimeBroadcast(_UDPtype, _client, _len, _data, _bri, _rgbw);
-  _broadcastLock = false;
+  if (!_valid) return;
+  size_t frameLen = _len * _UDPchannels;
+  NETQ_LOCK();
+  if (_qCount >= WLED_NET_QUEUE_LEN) {
+    _dropped++;
+    #if WLED_NET_DROP_POLICY == 0
+    if (_qCount <= (_sending ? 1 : 0)) { NETQ_UNLOCK(); return; } // only frame is being sent
+    _qHead = (_qHead + WLED_NET_QUEUE_LEN - 1) % WLED_NET_QUEUE_LEN; // unqueue newest frame, it gets replaced
+    _qCount--;
+    #else
+    NETQ_UNLOCK();
+    return;
+    #endif
+  }
+  uint8_t slot = _qHead; // not queued, so sender stage does not touch it
+  NETQ_UNLOCK();
+  memcpy(_queue + slot*frameLen, _data, frameLen);
+  _qBri[slot] = _bri;
+  NETQ_LOCK();
+  _qHead = (_qHead + 1) % WLED_NET_QUEUE_LEN;
+  _qCount++;
+  NETQ_UNLOCK();
+  #ifdef ARDUINO_ARCH_ESP32
+  if (netSendTask) xTaskNotifyGive(netSendTask);
+  #endif
+}
+
+void BusNetwork::sendQueued() {
+  unsigned long now = millis();
+  for (size_t i = 0; i < WLED_MAX_BUSSES+WLED_MIN_VIRTUAL_BUSSES; i++) {
+    NETQ_LOCK();
+    BusNetwork *b = _netBusses[i];
+    // pace each destination; bus cannot be deleted while _sending is set (see cleanup())
+    if (!b || !b->_qCount || b->_sending || (b->_maxFps && now - b->_lastSent < 1000U/b->_maxFps)) {
+      NETQ_UNLOCK();
+      continue;
+    }
+    while (b->_qCount > 1) { b->_qCount--; b->_dropped++; } // only the newest frame is worth sending
+    uint8_t slot = (b->_qHead + WLED_NET_QUEUE_LEN - 1) % WLED_NET_QUEUE_LEN;
+    b->_sending = true;
+    NETQ_UNLOCK();
+    realtimeBroadcast(b->_UDPtype, b->_client, b->_len, b->_queue + slot * b->_len * b->_UDPchannels, b->_qBri[slot], b->_rgbw);
+    b->_lastSent = now;
+    NETQ_LOCK();
+    b->_qCount--;
+    b->_sending = false;
+    NETQ_UNLOCK();
+  }
 }
 
 uint8_t BusNetwork::getPins(uint8_t* pinArray) {
@@ -519,9 +603,16 @@ uint8_t BusNetwork::getPins(uint8_t* pinArray) {
 }
 
 void BusNetwork::cleanup() {
+  NETQ_LOCK();
+  for (size_t i = 0; i < WLED_MAX_BUSSES+WLED_MIN_VIRTUAL_BUSSES; i++) if (_netBusses[i] == this) _netBusses[i] = nullptr;
+  NETQ_UNLOCK();
+  while (_sending) yield(); // sender stage is still transmitting our frame
   _type = I_NONE;
   _valid = false;
   freeData();
+  if (_queue) free(_queue);
+  _queue = nullptr;
+  _qCount = 0;
 }
 
 
@@ -565,7 +656,7 @@ int BusManager::add(BusConfig &bc) {
 void BusManager::removeAll() {
   DEBUG_PRINTLN(F("Removing all."));
   //prevents crashes due to deleting busses while in use.
-  while (!canAllShow()) yield();
+  while (!canAllShow()) yield(); // queued network frames are dropped by BusNetwork::cleanup()
   for (uint8_t i = 0; i < numBusses; i++) delete busses[i];
   numBusses = 0;
 }
@@ -278,6 +278,13 @@ class BusOnOff : public Bus {
 };
 
 
+#ifndef WLED_NET_QUEUE_LEN
+  #define WLED_NET_QUEUE_LEN 2    // frames queued per network bus (including the one being sent)
+#endif
+#ifndef WLED_NET_DROP_POLICY
+  #define WLED_NET_DROP_POLICY 0  // when send queue is full: 0 replace newest queued frame, 1 drop new frame
+#endif
+
 class BusNetwork : public Bus {
   public:
     BusNetwork(BusConfig &bc);
@@ -285,19 +292,34 @@ class BusNetwork : public Bus {
 
     bool hasRGB()   { return true; }
     bool hasWhite() { return _rgbw; }
-    bool canShow()  { return !_broadcastLock; } // this should be a return value from UDP routine if it is still sending data out
+    bool canShow()  { return !_sending; } // a full queue is normal (paced destination), show() replaces or drops frames
     void setPixelColor(uint16_t pix, uint32_t c);
     uint32_t getPixelColor(uint16_t pix);
     uint8_t  getPins(uint8_t* pinArray);
+    uint16_t getFrequency() { return _maxFps; }
     void show();
     void cleanup();
 
+    inline uint32_t getDroppedFrames() const { return _dropped; }
+
+    // sender stage, transmits queued frames of all network busses (own task on ESP32, called from loop on ESP8266)
+    static void sendQueued();
+
   private:
     IPAddress _client;
     uint8_t   _UDPtype;
     uint8_t   _UDPchannels;
     bool      _rgbw;
-    bool      _broadcastLock;
+    uint16_t  _maxFps;    // max. frames per second sent to the destination, 0 = unlimited (stored as bus frequency)
+    unsigned long _lastSent;
+    uint32_t  _dropped;
+    uint8_t  *_queue;     // WLED_NET_QUEUE_LEN frame buffers of _len*_UDPchannels bytes
+    uint8_t   _qBri[WLED_NET_QUEUE_LEN];
+    volatile uint8_t _qHead;   // next free slot
+    volatile uint8_t _qCount;  // queued frames, oldest is at _qHead-_qCount
+    volatile bool    _sending; // oldest frame is being transmitted by sender stage
+
+    static BusNetwork* _netBusses[WLED_MAX_BUSSES+WLED_MIN_VIRTUAL_BUSSES]; // registry for sender stage
 };
 
 
@@ -0,0 +1,67 @@
+#ifndef WLED_CATALOG_CACHE_H
+#define WLED_CATALOG_CACHE_H
+
+/*
+ * Effect & palette catalogs (/json/eff, /json/fxda, /json/palx): strong ETag and cache of serialized responses (json.cpp)
+ * Free of Arduino calls so revalidation and cache invalidation can be tested on the host.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CATALOG_ETAG_LEN 24 // "<build>-<salt>-<catalog version>" incl. quotes and terminator
+
+typedef struct {
+  char    *data;    // serialized JSON
+  size_t   len;
+  uint16_t version; // strip.getCatalogVersion() at the time data was serialized
+  int16_t  page;    // palette page, 0 for effect catalogs
+  uint8_t  path;    // JSON_PATH_*
+  uint8_t  users;   // responses currently sending data
+} CatalogEntry;
+
+// returns the entry of the current catalog version or nullptr, in which case freeEntry is an empty entry (if any)
+// stale entries are freed unless a response is still sending them
+static CatalogEntry* findCatalogEntry(CatalogEntry *cache, size_t n, uint16_t version, uint8_t path, int16_t page, CatalogEntry *&freeEntry)
+{
+  freeEntry = nullptr;
+  for (size_t i = 0; i < n; i++) {
+    CatalogEntry &e = cache[i];
+    if (e.data && e.version != version && !e.users) {
+      free(e.data);
+      e.data = nullptr;
+    }
+    if (e.data && e.version == version && e.path == path && e.page == page) return &e;
+    if (!e.data && !freeEntry) freeEntry = &e;
+  }
+  return nullptr;
+}
+
+static inline void formatCatalogETag(char *etag, uint32_t build, uint16_t salt, uint16_t version)
+{
+  snprintf(etag, CATALOG_ETAG_LEN, "\"%lu-%04x-%04x\"", (unsigned long)build, salt, version);
+}
+
+// If-None-Match value is "*", a single tag or a comma separated list; weak comparison (W/ ignored), RFC 7232 3.2
+static bool catalogETagMatches(const char *ifNoneMatch, const char *etag)
+{
+  if (!ifNoneMatch) return false;
+  size_t etagLen = strlen(etag);
+  const char *p = ifNoneMatch;
+  while (*p) {
+    while (*p == ' ' || *p == ',') p++;
+    if (*p == '*') return true;
+    if (p[0] == 'W' && p[1] == '/') p += 2;
+    const char *end = strchr(p, ',');
+    size_t len = end ? size_t(end - p) : strlen(p);
+    while (len && p[len-1] == ' ') len--;
+    if (len == etagLen && !strncmp(p, etag, len)) return true;
+    if (!end) break;
+    p = end;
+  }
+  return false;
+}
+
+#endif
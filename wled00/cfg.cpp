@@ -1,5 +1,6 @@
 #include "wled.h"
 #include "wled_ethernet.h"
+#include "cfg_filter.h"
 
 /*
  * Serializes and parses the cfg.json and wsec.json settings files, stored in internal FS.
@@ -9,12 +10,83 @@
 //simple macro for ArduinoJSON's or syntax
 #define CJSON(a,b) a = b | a
 
+// cfg.json is written to /cfg.tmp and renamed over the old file once complete, so a reset never leaves it truncated.
+// Saves requested from loop() are delayed until settings stop changing and written one section per loop to keep the frame rate.
+// Each section is built in its own small document and streamed to the file, the shared JSON buffer is not needed.
+#define CFG_SAVE_DEBOUNCE   1000  // ms without further changes before saving
+#define CFG_SAVE_MAX_DELAY 10000  // ms, save at the latest after this while changes keep coming
+#define CFG_SECTION_SIZE    1024  // initial capacity of a section document, doubled while the section does not fit
+
+#ifdef WLED_USE_MSGPACK_FS
+  #define CFG_FILE  "/cfg.mpk"   // read as /cfg.json by readObjectFromFile()
+  #define WSEC_FILE "/wsec.mpk"
+  #define measureCfg   measureMsgPack
+  #define serializeCfg serializeMsgPack
+#else
+  #define CFG_FILE  "/cfg.json"
+  #define WSEC_FILE "/wsec.json"
+  #define measureCfg   measureJson
+  #define serializeCfg serializeJson
+#endif
+
+static bool     cfgWriting = false;    // cfg.tmp is being written
+static uint8_t  cfgWriteNext = 0;      // next section to write
+static uint16_t cfgWriteMembers = 0;   // top-level members written
+static uint32_t cfgWriteMillis = 0;    // time spent serializing and writing
+static File     cfgWriteFile;
+
+static void writeConfigSlice(bool finish);
+
+static void abortConfigWrite() {
+  cfgWriteFile.close();
+  cfgWriting = false;
+  WLED_FS.remove("/cfg.tmp");
+}
+
+static void finishConfigWrite() {
+  unsigned long start = millis();
+  cfgWriteFile.close();
+  cfgWriting = false;
+  if (!replaceFile("/cfg.tmp", CFG_FILE)) {
+    DEBUG_PRINTLN(F("Replacing cfg.json failed!"));
+    return;
+  }
+  #ifdef WLED_USE_MSGPACK_FS
+  if (WLED_FS.exists("/cfg.json")) WLED_FS.remove("/cfg.json"); // imported JSON is superseded
+  #endif
+  cfgWriteMillis += millis() - start;
+  cfgWriteCount++;
+  cfgWriteTime = cfgWriteMillis;
+  DEBUG_PRINTF("cfg.json written in %u ms.\n", cfgWriteMillis);
+}
+
+//called from loop(): coalesces doSerializeConfig requests and continues a sliced write
+void handleSerializeConfig() {
+  static uint16_t lastVersion = 0;
+  static unsigned long lastChange = 0, firstRequest = 0;
+
+  if (doSerializeConfig) {
+    unsigned long now = millis();
+    if (!firstRequest) firstRequest = lastChange = now;
+    if (cfgVersion != lastVersion) { // settings changed again, wait for more
+      lastVersion = cfgVersion;
+      lastChange = now;
+    }
+    if (doReboot || now - lastChange >= CFG_SAVE_DEBOUNCE || now - firstRequest >= CFG_SAVE_MAX_DELAY) {
+      firstRequest = 0;
+      serializeConfig(!doReboot);
+    }
+  }
+  if (cfgWriting) writeConfigSlice(doReboot);
+}
+
 void getStringFromJson(char* dest, const char* src, size_t len) {
   if (src != nullptr) strlcpy(dest, src, len);
 }
 
 bool deserializeConfig(JsonObject doc, bool fromFS) {
   bool needsSave = false;
+  cfgVersion++;
   //int rev_major = doc["rev"][0]; // 1
   //int rev_minor = doc["rev"][1]; // 0
 
@@ -392,6 +464,7 @@ bool deserializeConfig(JsonObject doc, bool fromFS) {
   CJSON(receiveGroups, if_sync_recv["grp"]);
   CJSON(receiveSegmentOptions, if_sync_recv["seg"]);
   CJSON(receiveSegmentBounds, if_sync_recv["sb"]);
+  CJSON(udpTimeSync, if_sync_recv[F("ts")]);
   //! following line might be a problem if called after boot
   receiveNotifications = (receiveNotificationBrightness || receiveNotificationColor || receiveNotificationEffects || receiveSegmentOptions);
 
@@ -406,6 +479,7 @@ bool deserializeConfig(JsonObject doc, bool fromFS) {
   CJSON(syncGroups, if_sync_send["grp"]);
   if (if_sync_send[F("twice")]) udpNumRetries = 1; // import setting from 0.13 and earlier
   CJSON(udpNumRetries, if_sync_send["ret"]);
+  CJSON(udpSyncDelta, if_sync_send[F("delta")]);
 
   JsonObject if_nodes = interfaces["nodes"];
   CJSON(nodeListEnabled, if_nodes[F("list")]);
@@ -589,6 +663,9 @@ bool deserializeConfig(JsonObject doc, bool fromFS) {
 }
 
 void deserializeConfigFromFS() {
+  restoreFile("/wsec.tmp", WSEC_FILE); // reset while replacing the file
+  restoreFile("/cfg.tmp", CFG_FILE);
+
   bool success = deserializeConfigSec();
   if (!success) { //if file does not exist, try reading from EEPROM
     #ifdef WLED_ADD_EEPROM_SUPPORT
@@ -601,7 +678,9 @@ void deserializeConfigFromFS() {
 
   DEBUG_PRINTLN(F("Reading settings from /cfg.json..."));
 
-  success = readObjectFromFile("/cfg.json", nullptr, &doc);
+  StaticJsonDocument<CFG_FILTER_SIZE> filter; // read once, version info and unknown sections are skipped
+  cfgReadFilter(filter);
+  success = readObjectFromFile("/cfg.json", nullptr, &doc, &filter);
   if (!success) { // if file does not exist, optionally try reading from EEPROM and then save defaults to FS
     releaseJSONBufferLock();
     #ifdef WLED_ADD_EEPROM_SUPPORT
@@ -622,19 +701,15 @@ void deserializeConfigFromFS() {
 
   // NOTE: This routine deserializes *and* applies the configuration
   //       Therefore, must also initialize ethernet from this function
+  DEBUG_PRINT(F("Settings use ")); DEBUG_PRINTLN(doc.memoryUsage());
   bool needsSave = deserializeConfig(doc.as<JsonObject>(), true);
   releaseJSONBufferLock();
 
   if (needsSave) serializeConfig(); // usermods required new parameters
 }
 
-void serializeConfig() {
-  serializeConfigSec();
-
-  DEBUG_PRINTLN(F("Writing settings to /cfg.json..."));
-
-  if (!requestJSONBufferLock(2)) return;
-
+// cfg.json sections, each adds its top-level members to the given object (see writeConfigSection())
+static void serializeConfigNetwork(JsonObject doc) {
   JsonArray rev = doc.createNestedArray("rev");
   rev.add(1); //major settings revision
   rev.add(0); //minor settings revision
@@ -707,7 +782,9 @@ void serializeConfig() {
     }
   }
   #endif
+}
 
+static void serializeConfigHardware(JsonObject doc) {
   JsonObject hw = doc.createNestedObject("hw");
 
   JsonObject hw_led = hw.createNestedObject("led");
@@ -817,7 +894,9 @@ void serializeConfig() {
 
   //JsonObject hw_status = hw.createNestedObject("status");
   //hw_status["pin"] = -1;
+}
 
+static void serializeConfigLight(JsonObject doc) {
   JsonObject light = doc.createNestedObject(F("light"));
   light[F("scale-bri")] = briMultiplier;
   light[F("pal-mode")] = strip.paletteBlend;
@@ -845,7 +924,9 @@ void serializeConfig() {
   def["ps"] = bootPreset;
   def["on"] = turnOnAtBoot;
   def["bri"] = briS;
+}
 
+static void serializeConfigInterfaces(JsonObject doc) {
   JsonObject interfaces = doc.createNestedObject("if");
 
   JsonObject if_sync = interfaces.createNestedObject("sync");
@@ -859,6 +940,7 @@ void serializeConfig() {
   if_sync_recv["grp"] = receiveGroups;
   if_sync_recv["seg"] = receiveSegmentOptions;
   if_sync_recv["sb"]  = receiveSegmentBounds;
+  if_sync_recv[F("ts")] = udpTimeSync;
 
   JsonObject if_sync_send = if_sync.createNestedObject("send");
   if_sync_send[F("dir")] = notifyDirect;
@@ -868,6 +950,7 @@ void serializeConfig() {
   if_sync_send["macro"] = notifyMacro;
   if_sync_send["grp"] = syncGroups;
   if_sync_send["ret"] = udpNumRetries;
+  if_sync_send[F("delta")] = udpSyncDelta;
 
   JsonObject if_nodes = interfaces.createNestedObject("nodes");
   if_nodes[F("list")] = nodeListEnabled;
@@ -950,7 +1033,9 @@ void serializeConfig() {
   if_ntp[F("ampm")] = useAMPM;
   if_ntp[F("ln")] = longitude;
   if_ntp[F("lt")] = latitude;
+}
 
+static void serializeConfigTimers(JsonObject doc) {
   JsonObject ol = doc.createNestedObject("ol");
   ol[F("clock")] = overlayCurrent;
   ol[F("cntdwn")] = countdownMode;
@@ -1009,16 +1094,103 @@ void serializeConfig() {
 
   dmx[F("e131proxy")] = e131ProxyUniverse;
   #endif
+}
 
+static void serializeConfigUsermods(JsonObject doc) {
   JsonObject usermods_settings = doc.createNestedObject("um");
   usermods.addToConfig(usermods_settings);
+}
 
-  File f = WLED_FS.open("/cfg.json", "w");
-  if (f) serializeJson(doc, f);
-  f.close();
+typedef void (*CfgSection)(JsonObject);
+static const CfgSection cfgSections[] = {
+  serializeConfigNetwork, serializeConfigHardware, serializeConfigLight, serializeConfigInterfaces, serializeConfigTimers, serializeConfigUsermods
+};
+#define CFG_SECTIONS (sizeof(cfgSections)/sizeof(CfgSection))
+
+//writes the top-level members of a section to cfg.tmp (without the enclosing object)
+static bool writeConfigMembers(JsonObject sec) {
+  for (JsonPair kv : sec) {
+    const char *key = kv.key().c_str();
+    size_t len = strlen(key);
+    #ifdef WLED_USE_MSGPACK_FS
+    if (len > 255) return false;
+    if (len < 32) cfgWriteFile.write(uint8_t(0xA0 | len)); // fixstr
+    else { cfgWriteFile.write(uint8_t(0xD9)); cfgWriteFile.write(uint8_t(len)); } // str8
+    #else
+    if (cfgWriteMembers) cfgWriteFile.write(',');
+    cfgWriteFile.write('"');
+    #endif
+    if (cfgWriteFile.write((const uint8_t*)key, len) != len) return false;
+    #ifndef WLED_USE_MSGPACK_FS
+    cfgWriteFile.write((const uint8_t*)"\":", 2);
+    #endif
+    if (serializeCfg(kv.value(), cfgWriteFile) != measureCfg(kv.value())) return false;
+    cfgWriteMembers++;
+  }
+  return true;
+}
+
+//builds a section in a document just large enough for it and writes it
+//the shared JSON buffer is only used if there is not enough heap for the section
+static bool writeConfigSection(uint8_t i) {
+  for (size_t cap = CFG_SECTION_SIZE; cap < JSON_BUFFER_SIZE; cap *= 2) {
+    DynamicJsonDocument sec(cap);
+    if (!sec.capacity()) break; // out of memory
+    cfgSections[i](sec.to<JsonObject>());
+    if (!sec.overflowed()) return writeConfigMembers(sec.as<JsonObject>());
+  }
+  if (!requestJSONBufferLock(2)) return false;
+  cfgSections[i](doc.to<JsonObject>());
+  bool written = !doc.overflowed() && writeConfigMembers(doc.as<JsonObject>());
   releaseJSONBufferLock();
+  return written;
+}
+
+//writes the next section of cfg.json (or all if finish is set)
+static void writeConfigSlice(bool finish) {
+  unsigned long start = millis();
+  do {
+    if (!writeConfigSection(cfgWriteNext++)) {
+      DEBUG_PRINTLN(F("Writing cfg.json failed!"));
+      abortConfigWrite();
+      return;
+    }
+  } while (finish && cfgWriteNext < CFG_SECTIONS);
+  cfgWriteMillis += millis() - start;
+  if (cfgWriteNext < CFG_SECTIONS) return;
+  #ifdef WLED_USE_MSGPACK_FS
+  uint8_t n[2] = {uint8_t(cfgWriteMembers >> 8), uint8_t(cfgWriteMembers)};
+  cfgWriteFile.seek(1); // member count of the map16 header
+  cfgWriteFile.write(n, 2);
+  #else
+  cfgWriteFile.write('}');
+  #endif
+  finishConfigWrite();
+}
+
+//sliced: write one section per loop, see handleSerializeConfig()
+void serializeConfig(bool sliced) {
+  unsigned long start = millis();
+  if (cfgWriting) abortConfigWrite(); // superseded by current settings
+
+  serializeConfigSec();
+
+  DEBUG_PRINTLN(F("Writing settings to /cfg.json..."));
 
   doSerializeConfig = false;
+  cfgWriteFile = WLED_FS.open("/cfg.tmp", "w");
+  if (!cfgWriteFile) return;
+  #ifdef WLED_USE_MSGPACK_FS
+  const uint8_t hdr[3] = {0xDE, 0, 0}; // map16, member count is written when complete
+  cfgWriteFile.write(hdr, 3);
+  #else
+  cfgWriteFile.write('{');
+  #endif
+  cfgWriting = true;
+  cfgWriteNext = 0;
+  cfgWriteMembers = 0;
+  cfgWriteMillis = millis() - start;
+  if (!sliced) writeConfigSlice(true);
 }
 
 //settings in /wsec.json, not accessible via webserver, for passwords and tokens
@@ -1096,8 +1268,18 @@ void serializeConfigSec() {
   ota[F("lock-wifi")] = wifiLock;
   ota[F("aota")] = aOtaEnabled;
 
-  File f = WLED_FS.open("/wsec.json", "w");
-  if (f) serializeJson(doc, f);
+  File f = WLED_FS.open("/wsec.tmp", "w");
+  bool written = f && serializeCfg(doc, f); // f evaluates false once closed, check before
   f.close();
   releaseJSONBufferLock();
+  if (!written) {
+    DEBUG_PRINTLN(F("Failed to write wsec!"));
+    WLED_FS.remove("/wsec.tmp"); // keep the current file
+    return;
+  }
+  if (replaceFile("/wsec.tmp", WSEC_FILE)) {
+    #ifdef WLED_USE_MSGPACK_FS
+    if (WLED_FS.exists("/wsec.json")) WLED_FS.remove("/wsec.json"); // imported JSON is superseded
+    #endif
+  }
 }
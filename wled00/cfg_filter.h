@@ -0,0 +1,21 @@
+#ifndef WLED_CFG_FILTER_H
+#define WLED_CFG_FILTER_H
+
+/*
+ * Filter for reading cfg.json in one pass (see deserializeConfigFromFS())
+ * Only the sections deserializeConfig() reads are kept, each as a whole; version info and unknown members
+ * (i.e. left by older releases) take no space in the JSON buffer. Sections added to serializeConfig() must be listed here.
+ * ArduinoJson 6.18 cannot exclude single members below a "*" wildcard, so sections are not filtered further.
+ * Needs ArduinoJson only (include it first), so the filter can be checked against sample configurations on the host.
+ */
+
+#define CFG_FILTER_SIZE JSON_OBJECT_SIZE(16)
+
+inline void cfgReadFilter(JsonDocument& filter) {
+  static const char* const sections[] = {
+    "id", "nw", "ap", "wifi", "eth", "hw", "light", "def", "if", "remote", "ol", "timers", "ota", "dmx", "um"
+  };
+  for (const char* s : sections) filter[s] = true; // string literals are not copied
+}
+
+#endif
@@ -449,6 +449,22 @@
   #define JSON_BUFFER_SIZE 24576
 #endif
 
+// Number of JSON documents in pool (first one is the global buffer, others are allocated at boot)
+// by default additional documents are only allocated in PSRAM, if it is found at runtime
+#ifndef WLED_JSON_POOL_SIZE
+  #if defined(ARDUINO_ARCH_ESP32) && defined(BOARD_HAS_PSRAM) && defined(WLED_USE_PSRAM)
+    #define WLED_JSON_POOL_SIZE 2
+    #define WLED_JSON_POOL_PSRAM_ONLY
+  #else
+    #define WLED_JSON_POOL_SIZE 1
+  #endif
+#endif
+
+// JSON document lease priorities & default wait time (ms)
+#define JSON_PRIO_NET  0 // network callbacks, not served while a loop consumer waits
+#define JSON_PRIO_LOOP 1 // main loop consumers (presets, config, ledmaps)
+#define JSON_LOCK_TIMEOUT 1000
+
 //#define MIN_HEAP_SIZE (8k for AsyncWebServer)
 #define MIN_HEAP_SIZE 8192
 
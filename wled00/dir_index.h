@@ -0,0 +1,75 @@
+#ifndef WLED_DIR_INDEX_H
+#define WLED_DIR_INDEX_H
+
+/*
+ * Directory index (file.cpp): hashes of all file names in the root directory, built with a single directory scan.
+ * exists() on LittleFS walks the directory for every call, which adds up for the ledmap/palette probes and static file requests.
+ * Files in subdirectories are not indexed. A hash collision only causes a failing open(), so no names are stored.
+ * Must be invalidated whenever a file is created, renamed or removed (upload, /edit, replaceFile(), removeFile()).
+ * It is only rebuilt from loop(), lookups from the async web server task fall back to exists() while it is invalid.
+ * Free of Arduino calls so scans, lookups and invalidation can be tested on the host.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#define DIR_INDEX_FOUND    1
+#define DIR_INDEX_MISSING  0
+#define DIR_INDEX_UNKNOWN -1 // check with exists()
+
+template<uint8_t SIZE> class DirIndex {
+  uint32_t _hash[SIZE];
+  uint8_t  _len = 0;
+  volatile bool    _valid = false; // may be invalidated from the async web server task
+  volatile uint8_t _gen = 0;       // incremented by each invalidation
+  bool     _full = false;          // more files than SIZE, misses need to be checked
+
+  public:
+    static uint32_t hash(const char* name) {
+      uint32_t h = 2166136261UL; // FNV-1a
+      if (*name != '/') h = (h ^ '/') * 16777619UL; // ESP32 core 2.x returns names without leading slash
+      while (*name) h = (h ^ (uint8_t)*name++) * 16777619UL;
+      return h;
+    }
+
+    void invalidate() {
+      _valid = false;
+      _gen++;
+    }
+
+    bool valid() const { return _valid; }
+    uint8_t size() const { return _len; }
+
+    //rebuild: beginScan(), add() for each file in the root directory, endScan() with the returned generation
+    uint8_t beginScan() {
+      _len = 0;
+      _full = false;
+      return _gen;
+    }
+
+    void add(const char* name) {
+      if (_len < SIZE) _hash[_len++] = hash(name);
+      else _full = true;
+    }
+
+    //returns false if invalidated during the scan (build again)
+    bool endScan(uint8_t gen) {
+      _valid = (gen == _gen);
+      return _valid;
+    }
+
+    //DIR_INDEX_FOUND, DIR_INDEX_MISSING or DIR_INDEX_UNKNOWN
+    int8_t lookup(const char* file) const {
+      if (file[0] != '/' || strchr(file + 1, '/')) return DIR_INDEX_UNKNOWN; // not in root directory
+      uint8_t gen = _gen;
+      if (!_valid) return DIR_INDEX_UNKNOWN;
+      uint32_t h = hash(file);
+      bool found = false;
+      for (uint8_t i = 0; !found && i < _len; i++) found = (_hash[i] == h);
+      if (gen != _gen) return DIR_INDEX_UNKNOWN; // invalidated (and possibly rebuilt) while searching
+      if (found) return DIR_INDEX_FOUND;
+      return _full ? DIR_INDEX_UNKNOWN : DIR_INDEX_MISSING;
+    }
+};
+
+#endif
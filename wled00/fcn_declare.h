@@ -13,6 +13,9 @@ void handleAlexa();
 void onAlexaChange(EspalexaDevice* dev);
 #endif
 
+//binapi.cpp
+uint8_t handleBinaryControl(const uint8_t *data, size_t len, byte callMode = CALL_MODE_DIRECT_CHANGE);
+
 //button.cpp
 void shortPressAction(uint8_t b=0);
 void longPressAction(uint8_t b=0);
@@ -25,7 +28,8 @@ void handleIO();
 bool deserializeConfig(JsonObject doc, bool fromFS = false);
 void deserializeConfigFromFS();
 bool deserializeConfigSec();
-void serializeConfig();
+void handleSerializeConfig();
+void serializeConfig(bool sliced = false);
 void serializeConfigSec();
 
 template<typename DestType>
@@ -89,10 +93,25 @@ void sendArtnetPollReply(ArtPollReply* reply, IPAddress ipAddress, uint16_t port
 
 //file.cpp
 bool handleFileRead(AsyncWebServerRequest*, String path);
-bool writeObjectToFileUsingId(const char* file, uint16_t id, JsonDocument* content);
+bool writeObjectToFileUsingId(const char* file, uint16_t id, JsonDocument* content, bool journal = false);
 bool writeObjectToFile(const char* file, const char* key, JsonDocument* content);
 bool readObjectFromFileUsingId(const char* file, uint16_t id, JsonDocument* dest);
-bool readObjectFromFile(const char* file, const char* key, JsonDocument* dest);
+bool readObjectFromFile(const char* file, const char* key, JsonDocument* dest, const JsonDocument* filter = nullptr);
+void initPresetIndex();
+void invalidatePresetIndex();
+void handlePresetsCompaction();
+void initPresetJournal();
+void handlePresetsJournal();
+void syncPresetJournal();
+void requestPresetJournalDiscard();
+bool getMsgPackPath(const char* file, char* mpk);
+void migrateToMsgPack();
+bool fileExists(const char* file);
+void removeFile(const char* file);
+void invalidateDirIndex();
+void handleDirIndex();
+bool replaceFile(const char* tmp, const char* file);
+void restoreFile(const char* tmp, const char* file);
 void updateFSInfo();
 void closeFile();
 
@@ -213,10 +232,13 @@ void handlePresets();
 bool applyPreset(byte index, byte callMode = CALL_MODE_DIRECT_CHANGE);
 void applyPresetWithFallback(uint8_t presetID, uint8_t callMode, uint8_t effectID = 0, uint8_t paletteID = 0);
 inline bool applyTemporaryPreset() {return applyPreset(255);};
+void applyPresetToUsermods(byte index);
 void savePreset(byte index, const char* pname = nullptr, JsonObject saveobj = JsonObject());
 inline void saveTemporaryPreset() {savePreset(255);};
 void deletePreset(byte index);
 bool getPresetName(byte index, String& name);
+bool prefetchPreset(byte index);
+void invalidatePresetCache();
 
 //remote.cpp
 void handleRemote();
@@ -345,7 +367,13 @@ void sappend(char stype, const char* key, int val);
 void sappends(char stype, const char* key, char* val);
 void prepareHostname(char* hostname);
 bool isAsterisksOnly(const char* str, byte maxLen);
-bool requestJSONBufferLock(uint8_t module=255);
+void initJsonPool();
+int8_t acquireJsonDocument(uint8_t module, uint8_t prio = JSON_PRIO_LOOP, uint16_t timeout = JSON_LOCK_TIMEOUT, bool primary = false);
+void releaseJsonDocument(int8_t slot);
+JsonDocument* getJsonDocument(int8_t slot);
+uint8_t getJsonPoolSize();
+uint8_t getJsonPoolFree();
+bool requestJSONBufferLock(uint8_t module=255, uint8_t prio = JSON_PRIO_LOOP, uint16_t timeout = JSON_LOCK_TIMEOUT);
 void releaseJSONBufferLock();
 uint8_t extractModeName(uint8_t mode, const char *src, char *dest, uint8_t maxLen);
 uint8_t extractModeSlider(uint8_t mode, uint8_t slider, char *dest, uint8_t maxLen, uint8_t *var = nullptr);
@@ -372,6 +400,22 @@ class JSONBufferGuard {
     inline void release() { if (holding_lock) releaseJSONBufferLock(); holding_lock = false; }
 };
 
+// RAII lease of any free pooled JSON document (not necessarily the global "doc")
+class JsonLease {
+  int8_t slot;
+  public:
+    inline JsonLease(uint8_t module=255, uint8_t prio=JSON_PRIO_LOOP, uint16_t timeout=JSON_LOCK_TIMEOUT) : slot(acquireJsonDocument(module, prio, timeout)) {};
+    inline ~JsonLease() { release(); };
+    inline JsonLease(const JsonLease&) = delete; // Noncopyable
+    inline JsonLease& operator=(const JsonLease&) = delete;
+    inline JsonLease(JsonLease&& r) : slot(r.slot) { r.slot = -1; };  // but movable
+    inline JsonDocument* get() const { return getJsonDocument(slot); }
+    inline JsonDocument* operator->() const { return get(); }
+    inline JsonDocument& operator*() const { return *get(); }
+    explicit inline operator bool() const { return slot >= 0; };
+    inline void release() { releaseJsonDocument(slot); slot = -1; }
+};
+
 #ifdef WLED_ADD_EEPROM_SUPPORT
 //wled_eeprom.cpp
 void applyMacro(byte index);
@@ -1,4 +1,7 @@
 #include "wled.h"
+#include "presets_journal.h"
+#include "dir_index.h"
+#include "presets_index.h"
 
 /*
  * Utility for SPIFFS filesystem
@@ -176,6 +179,258 @@ static void writeSpace(size_t l)
   if (knownLargestSpace < l) knownLargestSpace = l;
 }
 
+/*
+ * In-RAM index of /presets.json: preset ID -> offset and length of its object
+ * Built with a single pass over the file and kept up to date by writeObjectToFileUsingId().
+ * Objects never move in the file (replaced in place, deleted by overwriting with spaces), so entries
+ * remain valid until the file is replaced (upload, /edit) which is caught by the file size check
+ * and by verifying the key in front of the indexed object before reading it.
+ * Runs of spaces left by replaced/deleted objects are tracked in a free extent list, so new objects can be
+ * inserted without scanning the file. Once enough space is wasted the file is rewritten by
+ * handlePresetsCompaction() in small steps and replaced with a rename.
+ */
+#define PRESETS_COMPACT_INTERVAL  30000 // ms between checks for wasted space
+#define PRESETS_COMPACT_CHUNK      1024 // bytes copied per loop
+
+static std::vector<presetidx_t> presetIndex; // only existing presets, in file order
+static std::vector<freeext_t>   freeExtents; // runs of spaces between root-level objects
+static bool   presetIndexValid = false;
+static bool   presetIndexComplete = false;  // all root-level objects are indexed (required for compaction)
+static bool   indexedWrite = false;         // current write is to /presets.json with a valid index
+static size_t presetIndexFileSize = 0;
+static uint32_t writtenObjPos = 0, writtenObjLen = 0; // object written by the last writeObjectToFile() (length 0 if deleted)
+
+static File cSrc, cDst;                     // compaction source and destination
+static PresetsCompactor compactor;
+static bool     compacting = false;
+static volatile bool compactionAborted = false;
+static bool     compactionRequested = false;
+static unsigned long lastCompactionCheck = 0;
+
+static inline bool isPresetsFile(const char* file) {
+  return !strcmp_P(file, PSTR("/presets.json"));
+}
+
+static inline presetidx_t* findPresetIndex(uint8_t id) { return findPresetIndex(presetIndex, id); }
+
+void invalidatePresetIndex() {
+  presetIndexValid = false;
+  compactionAborted = true;
+}
+
+//indexes all root-level objects with numeric keys in a single pass over the file
+static bool buildPresetIndex(File &file) {
+  #ifdef WLED_DEBUG_FS
+    DEBUGFS_PRINTLN(F("Build preset index"));
+    uint32_t s = millis();
+  #endif
+  presetIndex.clear();
+  freeExtents.clear();
+  presetIndexValid = false;
+  presetIndexComplete = true;
+  compactionAborted = true;
+  if (!file) return false;
+
+  byte buf[FS_BUFSIZE];
+  PresetIndexScanner scanner(presetIndex, freeExtents);
+  file.seek(0);
+  while (size_t bufsize = file.read(buf, FS_BUFSIZE)) scanner.feed(buf, bufsize);
+  presetIndexComplete = scanner.complete;
+  presetIndexFileSize = file.size();
+  presetIndexValid = true;
+  DEBUGFS_PRINTF("Indexed %d presets, %d free extents, took %d ms\n", presetIndex.size(), freeExtents.size(), millis() - s);
+  return true;
+}
+
+void initPresetIndex() {
+  if (doCloseFile) closeFile();
+  File file = WLED_FS.open("/presets.json", "r");
+  if (file) buildPresetIndex(file);
+  else { presetIndex.clear(); presetIndexValid = false; }
+  file.close();
+}
+
+//keeps the index in sync after an object has been written to /presets.json (f is still open)
+static void updatePresetIndex(uint16_t id, bool success) {
+  if (!presetIndexValid) return;
+  if (!success || id == 0 || id > 255 || writtenObjLen >= UINT16_MAX) { invalidatePresetIndex(); return; }
+  presetidx_t *e = findPresetIndex(id);
+  if (!writtenObjLen) {
+    if (e) presetIndex.erase(presetIndex.begin() + (e - presetIndex.data()));
+  } else if (e) {
+    e->pos = writtenObjPos;
+    e->len = writtenObjLen;
+  } else {
+    presetidx_t n;
+    n.pos = writtenObjPos; n.len = writtenObjLen; n.id = id;
+    presetIndex.push_back(n);
+  }
+  presetIndexFileSize = f.size();
+}
+
+//reads an object from /presets.json at its indexed position
+//returns 1 if read, 0 if the preset does not exist and -1 if the index can't be used
+static int8_t readIndexedObject(uint16_t id, const char* key, JsonDocument* dest) {
+  if (id == 0 || id > 255) return -1;
+  f = WLED_FS.open("/presets.json", "r");
+  if (!f) return -1;
+  if (!presetIndexValid || f.size() != presetIndexFileSize) buildPresetIndex(f);
+
+  presetidx_t *e = findPresetIndex(id);
+  if (!e) {
+    f.close();
+    dest->clear();
+    DEBUGFS_PRINTLN(F("Obj not indexed."));
+    return presetIndexValid ? 0 : -1;
+  }
+
+  //verify that the key (and optional whitespace) is directly in front of the object
+  size_t keyLen = strlen(key);
+  char buf[24];
+  size_t n = (e->pos < sizeof(buf)-1) ? e->pos : sizeof(buf)-1; // bytes read in front of the object
+  bool match = f.seek(e->pos - n) && f.read((uint8_t*)buf, n+1) == n+1 && buf[n] == '{';
+  while (match && n > 0 && isspace(buf[n-1])) n--;
+  if (!match || n < keyLen || strncmp(buf + n - keyLen, key, keyLen)) {
+    DEBUGFS_PRINTLN(F("Index mismatch!"));
+    f.close();
+    invalidatePresetIndex();
+    return -1;
+  }
+  f.seek(e->pos);
+  deserializeJson(*dest, f);
+  f.close();
+  return 1;
+}
+
+#define DIR_INDEX_SIZE 64
+
+static DirIndex<DIR_INDEX_SIZE> dirIndex;
+
+void invalidateDirIndex() {
+  dirIndex.invalidate();
+}
+
+//rebuilds the directory index if it was invalidated, call from loop()
+void handleDirIndex() {
+  if (dirIndex.valid()) return;
+  #ifdef WLED_DEBUG_FS
+  uint32_t s = millis();
+  #endif
+  uint8_t gen = dirIndex.beginScan();
+  #ifdef ARDUINO_ARCH_ESP32
+  File root = WLED_FS.open("/");
+  for (File file = root.openNextFile(); file; file = root.openNextFile()) {
+    if (!file.isDirectory()) dirIndex.add(file.name());
+  }
+  #else
+  Dir dir = WLED_FS.openDir("/");
+  while (dir.next()) {
+    if (!dir.isDirectory()) dirIndex.add(dir.fileName().c_str());
+  }
+  #endif
+  dirIndex.endScan(gen); // invalidated during the scan, build again
+  DEBUGFS_PRINTF("Dir index %d files, took %d ms\n", dirIndex.size(), millis() - s);
+}
+
+//exists() check using the directory index
+static bool existsIndexed(const char* file) {
+  int8_t res = dirIndex.lookup(file);
+  if (res == DIR_INDEX_UNKNOWN) return WLED_FS.exists(file);
+  return res == DIR_INDEX_FOUND;
+}
+
+//replaces file with a completely written tmp file
+//LittleFS renames over an existing file atomically, other file systems need the original removed first (see restoreFile())
+bool replaceFile(const char* tmp, const char* file) {
+  bool success = WLED_FS.rename(tmp, file);
+  if (!success) {
+    WLED_FS.remove(file);
+    success = WLED_FS.rename(tmp, file);
+  }
+  invalidateDirIndex();
+  return success;
+}
+
+//finishes or discards a replaceFile() interrupted by a reset, call at boot before file is used
+void restoreFile(const char* tmp, const char* file) {
+  if (!WLED_FS.exists(tmp)) return;
+  if (WLED_FS.exists(file)) {
+    WLED_FS.remove(tmp); // incomplete copy, original is intact
+  } else {
+    DEBUG_PRINT(F("Restoring ")); DEBUG_PRINTLN(file);
+    WLED_FS.rename(tmp, file); // reset between removing the original and renaming
+  }
+  invalidateDirIndex();
+}
+
+static void endPresetsCompaction(bool success) {
+  cSrc.close();
+  cDst.close();
+  if (!success) {
+    WLED_FS.remove("/presets.tmp");
+    invalidateDirIndex();
+  }
+  compactor.index.clear();
+  compacting = false;
+}
+
+//rewrites /presets.json without gaps, copying at most PRESETS_COMPACT_CHUNK bytes per call
+void handlePresetsCompaction() {
+  if (!compacting) {
+    if (!compactionRequested && millis() - lastCompactionCheck < PRESETS_COMPACT_INTERVAL) return;
+    lastCompactionCheck = millis();
+    if (doCloseFile || !presetIndexValid || !presetIndexComplete) return;
+
+    uint32_t waste = presetsCompactionWaste(presetIndex, presetIndexFileSize, compactionRequested);
+    if (!waste) return;
+    compactionRequested = false;
+    updateFSInfo();
+    if (presetsLiveSize(presetIndex) + 4096 > fsBytesTotal - fsBytesUsed) return;
+
+    DEBUG_PRINT(F("Compacting presets, waste ")); DEBUG_PRINTLN(waste);
+    cSrc = WLED_FS.open("/presets.json", "r");
+    cDst = WLED_FS.open("/presets.tmp", "w");
+    invalidateDirIndex();
+    if (!cSrc || !cDst || cSrc.size() != presetIndexFileSize || !compactor.begin(cDst, presetIndex.size())) { endPresetsCompaction(false); return; }
+    compactionAborted = false;
+    compacting = true;
+    return;
+  }
+
+  if (compactionAborted) { // presets.json has been modified
+    DEBUG_PRINTLN(F("Compaction aborted."));
+    endPresetsCompaction(false);
+    return;
+  }
+
+  byte buf[FS_BUFSIZE];
+  int8_t res = compactor.step(presetIndex, cSrc, cDst, PRESETS_COMPACT_CHUNK, buf, FS_BUFSIZE);
+  if (res < 0) {
+    DEBUG_PRINTLN(F("Compaction failed."));
+    endPresetsCompaction(false);
+    return;
+  }
+  if (!res) return;
+
+  size_t newSize = cDst.position();
+  cDst.close();
+  if (compactionAborted || cSrc.size() != presetIndexFileSize) { endPresetsCompaction(false); return; }
+  cSrc.close();
+  if (!replaceFile("/presets.tmp", "/presets.json")) { // keep the copy for restoreFile()
+    compactor.index.clear();
+    compacting = false;
+    invalidatePresetIndex();
+    return;
+  }
+  DEBUG_PRINT(F("Presets compacted to ")); DEBUG_PRINTLN(newSize);
+  presetIndex.swap(compactor.index);
+  freeExtents.clear();
+  presetIndexFileSize = newSize;
+  knownLargestSpace = MAX_SPACE;
+  endPresetsCompaction(true);
+  updateFSInfo();
+}
+
 bool appendObjectToFile(const char* key, JsonDocument* content, uint32_t s, uint32_t contentLen = 0)
 {
   #ifdef WLED_DEBUG_FS
@@ -199,10 +454,16 @@ bool appendObjectToFile(const char* key, JsonDocument* content, uint32_t s, uint
   //if there is enough empty space in file, insert there instead of appending
   if (!contentLen) contentLen = measureJson(*content);
   DEBUGFS_PRINTF("CLen %d\n", contentLen);
-  if (bufferedFindSpace(contentLen + strlen(key) + 1)) {
-    if (f.position() > 2) f.write(','); //add comma if not first object
+  uint32_t need = contentLen + strlen(key) + 1;
+  if (indexedWrite ? findFreeExtent(freeExtents, need, pos) && f.seek(pos) : bufferedFindSpace(need)) {
+    pos = f.position();
+    if (pos > 2) f.write(','); //add comma if not first object
     f.print(key);
+    writtenObjPos = f.position();
+    writtenObjLen = contentLen;
     serializeJson(*content, f);
+    if (indexedWrite) useFreeExtent(freeExtents, pos, f.position() - pos);
+    pos = 0;
     DEBUGFS_PRINTF("Inserted, took %d ms (total %d)", millis() - s1, millis() - s);
     doCloseFile = true;
     return true;
@@ -215,6 +476,7 @@ bool appendObjectToFile(const char* key, JsonDocument* content, uint32_t s, uint
 
   if (f.size() + 9000 > (fsBytesTotal - fsBytesUsed)) { //make sure there is enough space to at least copy the file once
     errorFlag = ERR_FS_QUOTA;
+    if (indexedWrite) compactionRequested = true; // reclaim space wasted by deleted presets
     doCloseFile = true;
     return false;
   }
@@ -245,6 +507,8 @@ bool appendObjectToFile(const char* key, JsonDocument* content, uint32_t s, uint
   }
 
   f.print(key);
+  writtenObjPos = f.position();
+  writtenObjLen = contentLen;
 
   //Append object
   serializeJson(*content, f);
@@ -255,11 +519,206 @@ bool appendObjectToFile(const char* key, JsonDocument* content, uint32_t s, uint
   return true;
 }
 
-bool writeObjectToFileUsingId(const char* file, uint16_t id, JsonDocument* content)
+/*
+ * Write-ahead journal for /presets.json
+ * State saves (doSaveState(), e.g. by the auto save usermod) are appended to /presets.jnl instead of being written
+ * into presets.json in place. The journal is merged into presets.json during idle time, once it grows too large,
+ * before presets.json is served or edited and at boot (replay after reset or power loss).
+ * While the journal is not empty all other preset changes are appended as well, so the order of changes is kept.
+ * Record format: see presets_journal.h
+ * A record cut off by power loss fails the length or checksum test, it and anything following it is ignored.
+ */
+#define PRESETS_JOURNAL        "/presets.jnl"
+#define PRESETS_JOURNAL_MAX     4096  // bytes, merge when exceeded
+#define PRESETS_JOURNAL_IDLE  300000  // ms without journal writes before merging
+#define PRESETS_JOURNAL_RETRY  10000  // ms between failed merge attempts
+
+static std::vector<presetidx_t> journalIndex; // latest record of each preset in the journal (pos of record header)
+static size_t journalSize = 0;                // bytes of valid records
+static unsigned long lastJournalWrite = 0, lastJournalMerge = 0;
+static bool journalMerging = false;
+static bool journalMergeRequested = false;
+static bool journalMergeFailed = false;
+static volatile bool journalFlushRequested = false;   // set by web requests, merged in loop()
+static volatile bool journalDiscardRequested = false; // presets.json was replaced by an upload
+
+static presetidx_t* findJournalIndex(uint8_t id) {
+  for (auto &e : journalIndex) if (e.id == id) return &e;
+  return nullptr;
+}
+
+static void setJournalIndex(uint8_t id, uint32_t pos, uint16_t len) {
+  presetidx_t *e = findJournalIndex(id);
+  if (e) { e->pos = pos; e->len = len; }
+  else journalIndex.push_back({pos, len, id});
+}
+
+static bool appendPresetJournal(uint8_t id, JsonDocument* content) {
+  size_t len = content->isNull() ? 0 : measureMsgPack(*content);
+  if (id == 0 || id > 250 || len > UINT16_MAX) return false;
+  uint8_t *buf = (uint8_t*) malloc(len + JOURNAL_HDR_LEN);
+  if (!buf) return false;
+  if (len) serializeMsgPack(*content, buf + JOURNAL_HDR_LEN, len);
+  journalEncode(buf, id, len);
+
+  File jf = WLED_FS.open(PRESETS_JOURNAL, "a");
+  if (!journalSize) invalidateDirIndex();
+  bool success = jf && jf.size() == journalSize && jf.write(buf, len + JOURNAL_HDR_LEN) == len + JOURNAL_HDR_LEN;
+  jf.close();
+  free(buf);
+  if (!success) {
+    DEBUGFS_PRINTLN(F("Journal write failed!"));
+    return false;
+  }
+  setJournalIndex(id, journalSize, len);
+  journalSize += len + JOURNAL_HDR_LEN;
+  lastJournalWrite = millis();
+  DEBUGFS_PRINTF("Journaled preset %d (%u bytes)\n", id, len);
+  return true;
+}
+
+//reads a preset from the journal, returns -1 if the journal has no record of it
+static int8_t readJournaledObject(uint8_t id, JsonDocument* dest) {
+  if (!journalSize) return -1;
+  presetidx_t *e = findJournalIndex(id);
+  if (!e) return -1;
+  if (!e->len) { // deleted
+    dest->clear();
+    return 0;
+  }
+  File jf = WLED_FS.open(PRESETS_JOURNAL, "r");
+  if (!jf || !jf.seek(e->pos + JOURNAL_HDR_LEN)) return -1; // merged in the meantime
+  bool success = deserializeMsgPack(*dest, jf) == DeserializationError::Ok;
+  jf.close();
+  return success ? 1 : -1;
+}
+
+//builds the journal index, stops at the first incomplete or corrupt record
+static void loadPresetJournal() {
+  journalIndex.clear();
+  journalSize = 0;
+  File jf = WLED_FS.open(PRESETS_JOURNAL, "r");
+  if (!jf) return;
+  size_t fileSize = jf.size();
+  size_t pos = journalScan<FS_BUFSIZE>(jf, setJournalIndex);
+  jf.close();
+  journalSize = pos;
+  if (pos < fileSize) DEBUG_PRINTF("Presets journal: ignoring %u bytes after incomplete record.\n", fileSize - pos);
+}
+
+//writes the latest record of each preset into presets.json, buf is used for decoding
+static bool mergePresetJournal(JsonDocument* buf) {
+  lastJournalMerge = millis();
+  journalMergeRequested = false;
+  journalMergeFailed = true;
+  File jf = WLED_FS.open(PRESETS_JOURNAL, "r");
+  if (!jf) {
+    journalFlushRequested = false;
+    return false;
+  }
+  DEBUG_PRINT(F("Merging presets journal, ")); DEBUG_PRINTLN(journalSize);
+  journalMerging = true;
+  bool success = true;
+  for (auto &e : journalIndex) {
+    buf->clear();
+    if (e.len && (!jf.seek(e.pos + JOURNAL_HDR_LEN) || deserializeMsgPack(*buf, jf) != DeserializationError::Ok)) {
+      DEBUG_PRINT(F("Skipping journaled preset ")); DEBUG_PRINTLN(e.id);
+      continue;
+    }
+    success = writeObjectToFileUsingId("/presets.json", e.id, buf);
+    if (doCloseFile) closeFile();
+    if (!success) break;
+  }
+  journalMerging = false;
+  jf.close();
+  buf->clear();
+  journalFlushRequested = false; // after writing, web requests wait for it
+  if (!success) return false; // keep journal, merging again is harmless
+  WLED_FS.remove(PRESETS_JOURNAL);
+  invalidateDirIndex();
+  journalIndex.clear();
+  journalSize = 0;
+  journalMergeFailed = false;
+  presetsModifiedTime = max(toki.second(), (uint32_t)presetsModifiedTime + 1); // content changed, UI reloads presets.json
+  updateFSInfo();
+  return true;
+}
+
+//merges the journal into presets.json if it is not empty
+static bool flushPresetJournal(uint16_t timeout = JSON_LOCK_TIMEOUT) {
+  if (!journalSize) return true;
+  if (!requestJSONBufferLock(23, JSON_PRIO_LOOP, timeout)) return false;
+  bool success = mergePresetJournal(fileDoc);
+  releaseJSONBufferLock();
+  return success;
+}
+
+//drops the journal, presets.json has been replaced (upload)
+static void discardPresetJournal() {
+  journalDiscardRequested = false;
+  if (!journalSize) return;
+  WLED_FS.remove(PRESETS_JOURNAL);
+  invalidateDirIndex();
+  journalIndex.clear();
+  journalSize = 0;
+}
+
+//replays a journal left by reset or power loss, call at boot
+void initPresetJournal() {
+  if (!existsIndexed(PRESETS_JOURNAL)) return;
+  loadPresetJournal();
+  if (journalSize) {
+    flushPresetJournal();
+    return;
+  }
+  WLED_FS.remove(PRESETS_JOURNAL); // nothing valid in it
+  invalidateDirIndex();
+}
+
+//call from web requests before presets.json is served or edited, requests a merge in loop()
+//ESP32 waits for it, ESP8266 serves presets.json as it is (the merge bumps presetsModifiedTime so the UI reloads it)
+void syncPresetJournal() {
+  if (!journalSize || journalDiscardRequested) return;
+  if (journalMergeFailed && millis() - lastJournalMerge < PRESETS_JOURNAL_RETRY) return; // serve presets.json as it is
+  journalFlushRequested = true;
+  #ifdef ARDUINO_ARCH_ESP32
+  unsigned long start = millis();
+  while (journalFlushRequested && millis() - start < JSON_LOCK_TIMEOUT) delay(1);
+  #endif
+}
+
+//presets.json is being replaced by an upload, the journal is dropped in loop()
+void requestPresetJournalDiscard() {
+  journalDiscardRequested = true;
+}
+
+//merges the journal once idle or large or requested, call from loop()
+void handlePresetsJournal() {
+  if (journalDiscardRequested) discardPresetJournal();
+  if (!journalSize) return;
+  if (!journalFlushRequested) {
+    if (millis() - lastJournalMerge < PRESETS_JOURNAL_RETRY) return;
+    if (!journalMergeRequested && journalSize < PRESETS_JOURNAL_MAX && millis() - lastJournalWrite < PRESETS_JOURNAL_IDLE) return;
+  }
+  flushPresetJournal(0);
+}
+
+//journal: append to the presets journal instead of writing presets.json in place (frequent state saves)
+bool writeObjectToFileUsingId(const char* file, uint16_t id, JsonDocument* content, bool journal)
 {
+  if (isPresetsFile(file) && !journalMerging && (journal || journalSize)) {
+    if (appendPresetJournal(id, content)) return true;
+    if (journalSize) { // must not bypass journaled changes, merge and retry
+      journalMergeRequested = true;
+      return false;
+    }
+  }
   char objKey[10];
   sprintf(objKey, "\"%d\":", id);
-  return writeObjectToFile(file, objKey, content);
+  writtenObjLen = 0;
+  bool success = writeObjectToFile(file, objKey, content);
+  if (isPresetsFile(file)) updatePresetIndex(id, success);
+  return success;
 }
 
 bool writeObjectToFile(const char* file, const char* key, JsonDocument* content)
@@ -273,12 +732,22 @@ bool writeObjectToFile(const char* file, const char* key, JsonDocument* content)
 
   size_t pos = 0;
   f = WLED_FS.open(file, "r+");
-  if (!f && !WLED_FS.exists(file)) f = WLED_FS.open(file, "w+");
+  if (!f && !WLED_FS.exists(file)) {
+    f = WLED_FS.open(file, "w+");
+    invalidateDirIndex();
+  }
   if (!f) {
     DEBUGFS_PRINTLN(F("Failed to open!"));
     return false;
   }
 
+  indexedWrite = false;
+  if (isPresetsFile(file)) {
+    compactionAborted = true; // compaction copies the old file, restart it later
+    if (!presetIndexValid || f.size() != presetIndexFileSize) buildPresetIndex(f);
+    indexedWrite = presetIndexValid;
+  }
+
   if (!bufferedFind(key)) //key does not exist in file
   {
     return appendObjectToFile(key, content, s);
@@ -291,6 +760,7 @@ bool writeObjectToFile(const char* file, const char* key, JsonDocument* content)
   size_t pos2 = f.position();
 
   uint32_t oldLen = pos2 - pos;
+  uint32_t end = pos2;
   DEBUGFS_PRINTF("Old obj len %d\n", oldLen);
 
   //Three cases:
@@ -307,16 +777,23 @@ bool writeObjectToFile(const char* file, const char* key, JsonDocument* content)
     f.seek(pos);
     serializeJson(*content, f);
     writeSpace(pos2 - f.position());
-  } else if (contentLen && bufferedFindSpace(contentLen - oldLen, false)) { //enough leading spaces to replace
+    writtenObjPos = pos;
+    writtenObjLen = contentLen;
+    if (indexedWrite) addFreeExtent(freeExtents, pos + contentLen, oldLen - contentLen);
+  } else if (contentLen && (indexedWrite ? findFreeExtent(freeExtents, contentLen - oldLen, end, true) : bufferedFindSpace(contentLen - oldLen, false))) { //enough leading spaces to replace
     DEBUGFS_PRINTLN(F("replace (trailing)"));
     f.seek(pos);
     serializeJson(*content, f);
+    writtenObjPos = pos;
+    writtenObjLen = contentLen;
+    if (indexedWrite) useFreeExtent(freeExtents, pos2, contentLen - oldLen);
   } else {
     DEBUGFS_PRINTLN(F("delete"));
     pos -= strlen(key);
     if (pos > 3) pos--; //also delete leading comma if not first object
     f.seek(pos);
     writeSpace(pos2 - pos);
+    if (indexedWrite) addFreeExtent(freeExtents, pos, pos2 - pos);
     if (contentLen) return appendObjectToFile(key, content, s, contentLen);
   }
 
@@ -329,17 +806,36 @@ bool readObjectFromFileUsingId(const char* file, uint16_t id, JsonDocument* dest
 {
   char objKey[10];
   sprintf(objKey, "\"%d\":", id);
+  if (isPresetsFile(file)) {
+    if (doCloseFile) closeFile();
+    int8_t found = readJournaledObject(id, dest);
+    if (found < 0) found = readIndexedObject(id, objKey, dest);
+    if (found >= 0) return found;
+  }
   return readObjectFromFile(file, objKey, dest);
 }
 
 //if the key is a nullptr, deserialize entire object
-bool readObjectFromFile(const char* file, const char* key, JsonDocument* dest)
+//if a filter is given only matching members are deserialized (ArduinoJson filter document)
+bool readObjectFromFile(const char* file, const char* key, JsonDocument* dest, const JsonDocument* filter)
 {
   if (doCloseFile) closeFile();
   #ifdef WLED_DEBUG_FS
     DEBUGFS_PRINTF("Read from %s with key %s >>>\n", file, (key==nullptr)?"nullptr":key);
     uint32_t s = millis();
   #endif
+  #ifdef WLED_USE_MSGPACK_FS
+  char mpk[33];
+  if (key == nullptr && !existsIndexed(file) && getMsgPackPath(file, mpk)) { // stored as MessagePack
+    f = WLED_FS.open(mpk, "r");
+    if (!f) return false;
+    if (filter) deserializeMsgPack(*dest, f, DeserializationOption::Filter(*filter));
+    else        deserializeMsgPack(*dest, f);
+    f.close();
+    DEBUGFS_PRINTF("Read MessagePack, took %d ms\n", millis() - s);
+    return true;
+  }
+  #endif
   f = WLED_FS.open(file, "r");
   if (!f) return false;
 
@@ -351,13 +847,100 @@ bool readObjectFromFile(const char* file, const char* key, JsonDocument* dest)
     return false;
   }
 
-  deserializeJson(*dest, f);
+  if (filter) deserializeJson(*dest, f, DeserializationOption::Filter(*filter));
+  else        deserializeJson(*dest, f);
 
   f.close();
   DEBUGFS_PRINTF("Read, took %d ms\n", millis() - s);
   return true;
 }
 
+/*
+ * Optional MessagePack storage (WLED_USE_MSGPACK_FS) for files that are always read as a whole:
+ * cfg.json, wsec.json, palette*.json, ledmap*.json and 2d-gaps.json are stored as *.mpk instead.
+ * A *.json file takes precedence (uploaded via /edit or /upload) and is converted on next boot,
+ * a request for the *.json file is answered with the *.mpk content converted to JSON.
+ * presets.json and ir.json remain JSON as they are read and written by key.
+ */
+#ifdef WLED_USE_MSGPACK_FS
+bool getMsgPackPath(const char* file, char* mpk) {
+  size_t len = strlen(file);
+  if (len < 6 || len > 32 || strcmp_P(file + len - 5, PSTR(".json"))) return false;
+  if (strcmp_P(file, PSTR("/cfg.json")) && strcmp_P(file, PSTR("/wsec.json")) && strcmp_P(file, PSTR("/2d-gaps.json")) &&
+      strncmp_P(file, PSTR("/palette"), 8) && strncmp_P(file, PSTR("/ledmap"), 7)) return false;
+  strcpy(mpk, file);
+  strcpy_P(mpk + len - 5, PSTR(".mpk"));
+  return true;
+}
+
+static bool convertToMsgPack(const char* file, const char* mpk) {
+  JsonLease lease(22);
+  if (!lease) return false;
+  File src = WLED_FS.open(file, "r");
+  if (!src) return false;
+  DeserializationError error = deserializeJson(*lease, src);
+  src.close();
+  if (error) return false; // keep file as is (invalid or too large)
+  File dst = WLED_FS.open("/msgpack.tmp", "w");
+  if (!dst) return false;
+  bool success = serializeMsgPack(*lease, dst) == measureMsgPack(*lease);
+  dst.close();
+  if (!success || !replaceFile("/msgpack.tmp", mpk)) {
+    WLED_FS.remove("/msgpack.tmp");
+    return false;
+  }
+  WLED_FS.remove(file);
+  return true;
+}
+
+//converts (uploaded) JSON files to MessagePack, called at boot
+void migrateToMsgPack() {
+  if (WLED_FS.exists("/msgpack.tmp")) WLED_FS.remove("/msgpack.tmp"); // conversion interrupted by reset, JSON file is intact
+  std::vector<String> files; // don't modify directory while iterating
+  char mpk[33];
+  #ifdef ARDUINO_ARCH_ESP32
+  File root = WLED_FS.open("/");
+  for (File file = root.openNextFile(); file; file = root.openNextFile()) {
+    String name = file.name();
+    if (name.charAt(0) != '/') name = '/' + name;
+    if (getMsgPackPath(name.c_str(), mpk)) files.push_back(name);
+  }
+  #else
+  Dir dir = WLED_FS.openDir("/");
+  while (dir.next()) {
+    String name = '/' + dir.fileName();
+    if (getMsgPackPath(name.c_str(), mpk)) files.push_back(name);
+  }
+  #endif
+  for (auto &name : files) {
+    getMsgPackPath(name.c_str(), mpk);
+    bool ok = convertToMsgPack(name.c_str(), mpk);
+    DEBUG_PRINT(F("Converting ")); DEBUG_PRINT(name); DEBUG_PRINTLN(ok ? F(" to MessagePack.") : F(" failed!"));
+  }
+  invalidateDirIndex();
+}
+#endif
+
+//true if file exists (also as MessagePack)
+bool fileExists(const char* file) {
+  if (existsIndexed(file)) return true;
+  #ifdef WLED_USE_MSGPACK_FS
+  char mpk[33];
+  if (getMsgPackPath(file, mpk)) return existsIndexed(mpk);
+  #endif
+  return false;
+}
+
+//removes file (and its MessagePack copy)
+void removeFile(const char* file) {
+  if (existsIndexed(file)) WLED_FS.remove(file);
+  #ifdef WLED_USE_MSGPACK_FS
+  char mpk[33];
+  if (getMsgPackPath(file, mpk) && existsIndexed(mpk)) WLED_FS.remove(mpk);
+  #endif
+  invalidateDirIndex();
+}
+
 void updateFSInfo() {
   #ifdef ARDUINO_ARCH_ESP32
     #if WLED_FS == LITTLEFS || ESP_IDF_VERSION_MAJOR >= 4
@@ -404,9 +987,28 @@ bool handleFileRead(AsyncWebServerRequest* request, String path){
     request->send(WLED_FS, pathWithGz, contentType);
     return true;
   }*/
-  if(WLED_FS.exists(path)) {
+  if (isPresetsFile(path.c_str())) syncPresetJournal();
+  if(existsIndexed(path.c_str())) {
     request->send(WLED_FS, path, contentType);
     return true;
   }
+  #ifdef WLED_USE_MSGPACK_FS
+  char mpk[33];
+  if (getMsgPackPath(path.c_str(), mpk) && existsIndexed(mpk)) { // export as JSON
+    JsonLease lease(22, JSON_PRIO_NET);
+    if (!lease) {
+      request->send(503, "application/json", F("{\"error\":3}"));
+      return true;
+    }
+    File mf = WLED_FS.open(mpk, "r"); // own handle, global f belongs to loop()
+    if (!mf) return false;
+    deserializeMsgPack(*lease, mf);
+    mf.close();
+    AsyncResponseStream *response = request->beginResponseStream(contentType);
+    serializeJson(*lease, *response);
+    request->send(response);
+    return true;
+  }
+  #endif
   return false;
 }
@@ -1,4 +1,5 @@
 #include "wled.h"
+#include "catalog_cache.h"
 
 #include "palettes.h"
 
@@ -393,6 +394,8 @@ bool deserializeState(JsonObject root, byte callMode, byte presetId)
 
   int it = 0;
   JsonVariant segVar = root["seg"];
+  bool segTransaction = !segVar.isNull();
+  if (segTransaction) strip.beginTransaction(); // render all segment changes in the same frame
   if (segVar.is<JsonObject>())
   {
     int id = segVar["id"] | -1;
@@ -412,12 +415,14 @@ bool deserializeState(JsonObject root, byte callMode, byte presetId)
     } else {
       deserializeSegment(segVar, id, presetId); //apply only the segment with the specified ID
     }
+    strip.commitTransaction();
   } else {
     size_t deleted = 0;
     JsonArray segs = segVar.as<JsonArray>();
     for (JsonObject elem : segs) {
       if (deserializeSegment(elem, it++, presetId) && !elem["stop"].isNull() && elem["stop"]==0) deleted++;
     }
+    if (segTransaction) strip.commitTransaction();
     if (strip.getSegmentsNum() > 3 && deleted >= strip.getSegmentsNum()/2U) strip.purgeSegments(); // batch deleting more than half segments
   }
 
@@ -469,7 +474,7 @@ bool deserializeState(JsonObject root, byte callMode, byte presetId)
     if (strip.customPalettes.size()) {
       char fileName[32];
       sprintf_P(fileName, PSTR("/palette%d.json"), strip.customPalettes.size()-1);
-      if (WLED_FS.exists(fileName)) WLED_FS.remove(fileName);
+      removeFile(fileName);
       strip.loadCustomPalettes();
     }
   }
@@ -662,6 +667,13 @@ void serializeInfo(JsonObject root)
 
   root[F("name")] = serverDescription;
   root[F("udpport")] = udpPort;
+  if (timeSyncPeer[0]) {
+    JsonObject tsync = root.createNestedObject(F("tsync"));
+    tsync[F("peer")] = timeSyncPeer.toString();
+    tsync[F("rtt")]  = peerClock.getRTT();                     // ms, best round trip of the sample window
+    tsync[F("err")]  = peerClock.phaseError(strip.timebase);   // ms, effect phase error (positive: ahead of peer)
+    tsync["n"]       = peerClock.getSamples();
+  }
   root["live"] = (bool)realtimeMode;
   root[F("liveseg")] = useMainSegmentOnly ? strip.getMainSegmentId() : -1;  // if using main segment only for live
 
@@ -716,6 +728,8 @@ void serializeInfo(JsonObject root)
   fs_info["u"] = fsBytesUsed / 1000;
   fs_info["t"] = fsBytesTotal / 1000;
   fs_info[F("pmt")] = presetsModifiedTime;
+  fs_info[F("cw")] = cfgWriteCount;
+  fs_info[F("cwt")] = cfgWriteTime;
 
   root[F("ndc")] = nodeListEnabled ? (int)Nodes.size() : -1;
 
@@ -752,6 +766,15 @@ void serializeInfo(JsonObject root)
   #endif
   root[F("uptime")] = millis()/1000 + rolloverMillis*4294967;
 
+  JsonArray boot = root.createNestedArray(F("boot")); // ms since power-up at the end of each boot phase (BOOT_*)
+  bootTime.addTo(boot);
+
+  JsonObject jpool = root.createNestedObject(F("jpool"));
+  jpool["n"]       = getJsonPoolSize();
+  jpool[F("free")] = getJsonPoolFree();
+  jpool[F("wait")] = jsonLockWaitMax; // ms, longest wait for a document
+  jpool[F("fail")] = jsonLockFails;
+
   char time[32];
   getTimeString(time);
   root[F("time")] = time;
@@ -1020,30 +1043,164 @@ void serializeModeNames(JsonArray arr)
   }
 }
 
-// Global buffer locking response helper class (to make sure lock is released when AsyncJsonResponse is destroyed)
+// Pooled buffer locking response helper class (to make sure lease is released when AsyncJsonResponse is destroyed)
 class LockedJsonResponse: public AsyncJsonResponse {
-  bool _holding_lock;
+  int8_t _slot;
   public:
-  // WARNING: constructor assumes requestJSONBufferLock() was successfully acquired externally/prior to constructing the instance
+  // WARNING: constructor assumes acquireJsonDocument() was successfully called externally/prior to constructing the instance
   // Not a good practice with C++. Unfortunately AsyncJsonResponse only has 2 constructors - for dynamic buffer or existing buffer,
   // with existing buffer it clears its content during construction
-  // if the lock was not acquired (using JSONBufferGuard class) previous implementation still cleared existing buffer
-  inline LockedJsonResponse(JsonDocument* doc, bool isArray) : AsyncJsonResponse(doc, isArray), _holding_lock(true) {};
+  inline LockedJsonResponse(int8_t slot, bool isArray) : AsyncJsonResponse(getJsonDocument(slot), isArray), _slot(slot) {};
 
   virtual size_t _fillBuffer(uint8_t *buf, size_t maxLen) { 
     size_t result = AsyncJsonResponse::_fillBuffer(buf, maxLen);
-    // Release lock as soon as we're done filling content
-    if (((result + _sentLength) >= (_contentLength)) && _holding_lock) {
-      releaseJSONBufferLock();
-      _holding_lock = false;
+    // Release lease as soon as we're done filling content
+    if (((result + _sentLength) >= (_contentLength)) && _slot >= 0) {
+      releaseJsonDocument(_slot);
+      _slot = -1;
     }
     return result;
   }
 
-  // destructor will remove JSON buffer lock when response is destroyed in AsyncWebServer
-  virtual ~LockedJsonResponse() { if (_holding_lock) releaseJSONBufferLock(); };
+  // destructor will release the document when response is destroyed in AsyncWebServer
+  virtual ~LockedJsonResponse() { releaseJsonDocument(_slot); };
 };
 
+// fills JSON response for requested path (state, info, effects, ...)
+static void fillJsonResponse(JsonVariant lDoc, byte subJson, AsyncWebServerRequest* request)
+{
+  switch (subJson)
+  {
+    case JSON_PATH_STATE:
+      serializeState(lDoc); break;
+    case JSON_PATH_INFO:
+      serializeInfo(lDoc); break;
+    case JSON_PATH_NODES:
+      serializeNodes(lDoc); break;
+    case JSON_PATH_PALETTES:
+      serializePalettes(lDoc, request->hasParam(F("page")) ? request->getParam(F("page"))->value().toInt() : 0); break;
+    case JSON_PATH_EFFECTS:
+      serializeModeNames(lDoc); break;
+    case JSON_PATH_FXDATA:
+      serializeModeData(lDoc); break;
+    case JSON_PATH_NETWORKS:
+      serializeNetworks(lDoc); break;
+    default: //all
+      JsonObject state = lDoc.createNestedObject("state");
+      serializeState(state);
+      JsonObject info = lDoc.createNestedObject("info");
+      serializeInfo(info);
+      if (subJson != JSON_PATH_STATE_INFO)
+      {
+        JsonArray effects = lDoc.createNestedArray(F("effects"));
+        serializeModeNames(effects); // remove WLED-SR extensions from effect names
+        lDoc[F("palettes")] = serialized((const __FlashStringHelper*)JSON_palette_names);
+      }
+      //lDoc["m"] = lDoc.memoryUsage(); // JSON buffer usage, for remote debugging
+  }
+  DEBUG_PRINTF("JSON buffer size: %u for request: %d\n", lDoc.memoryUsage(), subJson);
+}
+
+// Static catalogs (effect names & data, palette pages) only change when effects are added or custom palettes reloaded.
+// They are served with a strong ETag (304 if unchanged) and on ESP32 also kept serialized in RAM (PSRAM if available).
+#if !defined(ESP8266) && !defined(WLED_DISABLE_CATALOG_CACHE)
+  #define WLED_CATALOG_CACHE
+  #define CATALOG_CACHE_ENTRIES 16 // effects, effect data and palette pages
+
+static CatalogEntry catalogCache[CATALOG_CACHE_ENTRIES] = {{nullptr, 0, 0, 0, 0, 0}};
+
+// sends cached catalog, entry is kept alive until the response is destroyed
+class CatalogResponse: public AsyncAbstractResponse {
+  CatalogEntry *_entry;
+  public:
+  CatalogResponse(CatalogEntry *entry) : _entry(entry) {
+    _code = 200;
+    _contentType = JSON_MIMETYPE;
+    _contentLength = entry->len;
+    _entry->users++;
+  }
+  virtual ~CatalogResponse() { _entry->users--; }
+  bool _sourceValid() const { return true; }
+  virtual size_t _fillBuffer(uint8_t *data, size_t len) {
+    size_t left = _entry->len - _sentLength;
+    if (len > left) len = left;
+    memcpy(data, _entry->data + _sentLength, len);
+    return len;
+  }
+};
+
+static CatalogEntry* getCatalogEntry(AsyncWebServerRequest* request, byte subJson, int page)
+{
+  uint16_t version = strip.getCatalogVersion();
+  CatalogEntry *entry;
+  CatalogEntry *cached = findCatalogEntry(catalogCache, CATALOG_CACHE_ENTRIES, version, subJson, page, entry);
+  if (cached) return cached;
+  if (!entry) return nullptr; // all entries in use
+
+  JsonLease lease(17, JSON_PRIO_NET);
+  if (!lease) return nullptr;
+  JsonVariant lDoc = (subJson == JSON_PATH_PALETTES) ? JsonVariant(lease->to<JsonObject>()) : JsonVariant(lease->to<JsonArray>());
+  fillJsonResponse(lDoc, subJson, request);
+  size_t len = measureJson(*lease);
+  #if defined(BOARD_HAS_PSRAM) && defined(WLED_USE_PSRAM)
+  if (psramFound()) entry->data = (char*) ps_malloc(len+1);
+  else
+  #endif
+  entry->data = (char*) malloc(len+1);
+  if (!entry->data) return nullptr;
+  serializeJson(*lease, entry->data, len+1);
+  entry->len     = len;
+  entry->version = version;
+  entry->page    = page;
+  entry->path    = subJson;
+  entry->users   = 0;
+  DEBUG_PRINTF("Catalog %d/%d cached (%u bytes).\n", (int)subJson, page, len);
+  return entry;
+}
+#endif
+
+static uint16_t catalogSalt = 0; // differs on each boot, custom palettes may have changed while powered off
+
+static void getCatalogETag(char *etag) // etag must fit CATALOG_ETAG_LEN characters
+{
+  if (!catalogSalt) catalogSalt = random(1, 0xFFFF);
+  formatCatalogETag(etag, VERSION, catalogSalt, strip.getCatalogVersion());
+}
+
+static void setCatalogCacheHeaders(AsyncWebServerResponse *response)
+{
+  char etag[CATALOG_ETAG_LEN];
+  getCatalogETag(etag);
+  response->addHeader(F("Cache-Control"), F("no-cache")); // always revalidate using If-None-Match
+  response->addHeader(F("ETag"), etag);
+}
+
+// returns true if request was answered (304 or cached catalog)
+static bool serveCatalog(AsyncWebServerRequest* request, byte subJson)
+{
+  char etag[CATALOG_ETAG_LEN];
+  getCatalogETag(etag);
+  AsyncWebHeader* header = request->getHeader("If-None-Match");
+  if (header && catalogETagMatches(header->value().c_str(), etag)) {
+    AsyncWebServerResponse *response = request->beginResponse(304);
+    setCatalogCacheHeaders(response);
+    request->send(response);
+    return true;
+  }
+  #ifdef WLED_CATALOG_CACHE
+  int page = (subJson == JSON_PATH_PALETTES && request->hasParam(F("page"))) ? request->getParam(F("page"))->value().toInt() : 0;
+  if (page < 0 || page > 255) return false;
+  CatalogEntry *entry = getCatalogEntry(request, subJson, page);
+  if (!entry) return false; // serve uncached
+  CatalogResponse *response = new CatalogResponse(entry);
+  setCatalogCacheHeaders(response);
+  request->send(response);
+  return true;
+  #else
+  return false;
+  #endif
+}
+
 void serveJson(AsyncWebServerRequest* request)
 {
   byte subJson = 0;
@@ -1074,54 +1231,29 @@ void serveJson(AsyncWebServerRequest* request)
     return;
   }
 
-  if (!requestJSONBufferLock(17)) {
+  bool isArray = subJson==JSON_PATH_FXDATA || subJson==JSON_PATH_EFFECTS;
+  bool isCatalog = isArray || subJson==JSON_PATH_PALETTES;
+  if (isCatalog && serveCatalog(request, subJson)) return;
+
+  int8_t slot = acquireJsonDocument(17, JSON_PRIO_NET);
+  if (slot < 0) {
     request->send(503, "application/json", F("{\"error\":3}"));
     return;
   }
-  // releaseJSONBufferLock() will be called when "response" is destroyed (from AsyncWebServer)
+  // releaseJsonDocument() will be called when "response" is destroyed (from AsyncWebServer)
   // make sure you delete "response" if no "request->send(response);" is made
-  LockedJsonResponse *response = new LockedJsonResponse(&doc, subJson==JSON_PATH_FXDATA || subJson==JSON_PATH_EFFECTS); // will clear and convert JsonDocument into JsonArray if necessary
-
-  JsonVariant lDoc = response->getRoot();
-
-  switch (subJson)
-  {
-    case JSON_PATH_STATE:
-      serializeState(lDoc); break;
-    case JSON_PATH_INFO:
-      serializeInfo(lDoc); break;
-    case JSON_PATH_NODES:
-      serializeNodes(lDoc); break;
-    case JSON_PATH_PALETTES:
-      serializePalettes(lDoc, request->hasParam(F("page")) ? request->getParam(F("page"))->value().toInt() : 0); break;
-    case JSON_PATH_EFFECTS:
-      serializeModeNames(lDoc); break;
-    case JSON_PATH_FXDATA:
-      serializeModeData(lDoc); break;
-    case JSON_PATH_NETWORKS:
-      serializeNetworks(lDoc); break;
-    default: //all
-      JsonObject state = lDoc.createNestedObject("state");
-      serializeState(state);
-      JsonObject info = lDoc.createNestedObject("info");
-      serializeInfo(info);
-      if (subJson != JSON_PATH_STATE_INFO)
-      {
-        JsonArray effects = lDoc.createNestedArray(F("effects"));
-        serializeModeNames(effects); // remove WLED-SR extensions from effect names
-        lDoc[F("palettes")] = serialized((const __FlashStringHelper*)JSON_palette_names);
-      }
-      //lDoc["m"] = lDoc.memoryUsage(); // JSON buffer usage, for remote debugging
-  }
+  LockedJsonResponse *response = new LockedJsonResponse(slot, isArray); // will clear and convert JsonDocument into JsonArray if necessary
 
-  DEBUG_PRINTF("JSON buffer size: %u for request: %d\n", lDoc.memoryUsage(), subJson);
+  fillJsonResponse(response->getRoot(), subJson, request);
 
+  // serialized in chunks from the pooled document as the client accepts them, released after the last one
   #ifdef WLED_DEBUG
   size_t len =
   #endif
   response->setLength();
   DEBUG_PRINT(F("JSON content length: ")); DEBUG_PRINTLN(len);
 
+  if (isCatalog) setCatalogCacheHeaders(response);
   request->send(response);
 }
 
@@ -0,0 +1,50 @@
+#ifndef WLED_JSON_POOL_H
+#define WLED_JSON_POOL_H
+
+/*
+ * Ownership of the JSON document pool (util.cpp): which module holds which document and who is served.
+ * Slot 0 is the global "doc", it is only handed out on request (primary) or if nothing else is free.
+ * While a loop consumer waits, network callbacks are not served so they cannot starve it.
+ * Not thread safe by itself (util.cpp calls it within JSONPOOL_LOCK()), free of Arduino calls for host tests.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+template<size_t N> class JsonPoolOwners {
+  static_assert(N > 0 && N <= 8, "JSON pool size must be 1..8");
+  volatile uint8_t _owner[N] = {0};    // module holding the document, 0 = free
+  volatile uint8_t _loopWaiters = 0;   // loop consumers waiting
+  uint8_t          _present = 0x01;    // allocated documents (bit per slot), global "doc" always exists
+
+  public:
+    inline void setPresent(size_t slot, bool p) { if (slot < N) _present = p ? _present | (1 << slot) : _present & ~(1 << slot); }
+    inline bool isPresent(size_t slot) const    { return slot < N && (_present >> slot) & 0x01; }
+    inline uint8_t owner(size_t slot) const     { return slot < N ? _owner[slot] : 0; }
+
+    // returns claimed slot or -1
+    int8_t claim(uint8_t module, bool loopPrio, bool primary) {
+      if (!loopPrio && _loopWaiters) return -1;
+      int8_t slot = -1;
+      if (primary) {
+        if (!_owner[0]) slot = 0;
+      } else {
+        // prefer additional documents, the global one is needed by state consumers
+        for (int i = N-1; i >= 0; i--) if (isPresent(i) && !_owner[i]) { slot = i; break; }
+      }
+      if (slot >= 0) _owner[slot] = module;
+      return slot;
+    }
+    inline void release(size_t slot) { if (slot < N) _owner[slot] = 0; }
+
+    inline void waitBegin() { _loopWaiters++; }
+    inline void waitEnd()   { if (_loopWaiters) _loopWaiters--; }
+
+    uint8_t count(bool freeOnly) const {
+      uint8_t n = 0;
+      for (size_t i = 0; i < N; i++) if (isPresent(i) && !(freeOnly && _owner[i])) n++;
+      return n;
+    }
+};
+
+#endif
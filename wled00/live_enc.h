@@ -0,0 +1,118 @@
+#ifndef WLED_LIVE_ENC_H
+#define WLED_LIVE_ENC_H
+
+/*
+ * Binary live view (ws.cpp) version 3 frames: sampling and payload encodings
+ * Free of Arduino calls so frames can be encoded and decoded on the host.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define LIVE_ENC_RGB888 0
+#define LIVE_ENC_RGB565 1
+#define LIVE_ENC_RLE565 2
+#define LIVE_ENC_PALRLE 3
+#define LIVE_ENC_LEGACY 4
+#define LIVE_HDR_SIZE   8
+
+static inline uint16_t toRGB565(uint8_t r, uint8_t g, uint8_t b)
+{
+  return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+}
+
+// sampled frame size, full resolution up to maxPixels (every step-th pixel, or step*step block in 2D)
+static void liveSampling(bool matrix, uint16_t width, uint16_t height, size_t length, size_t maxPixels, uint16_t &step, uint16_t &w, uint16_t &h)
+{
+  if (matrix) {
+    step = 1;
+    while (size_t(width/step) * (height/step) > maxPixels) step <<= 1;
+    w = width/step;
+    h = height/step;
+    return;
+  }
+  step = length ? (length-1)/maxPixels + 1 : 1;
+  w = (length + step - 1) / step;
+  h = 1;
+}
+
+// strip pixel of the i-th sampled pixel
+static inline size_t livePixelIndex(size_t i, uint16_t w, uint16_t h, uint16_t step, uint16_t width)
+{
+  return (h > 1) ? (i / w) * step * width + (i % w) * step : i * step;
+}
+
+// up to 256 colors with open addressing lookup
+class LivePalette {
+  int16_t  _hash[512]; // index into colors, -1 = empty
+  public:
+    uint16_t colors[256];
+    uint16_t count = 0;
+
+    LivePalette() { reset(); }
+    void reset() { count = 0; memset(_hash, 0xFF, sizeof(_hash)); }
+
+    // returns palette index of color, adds it if not present (-1 if palette is full)
+    int16_t index(uint16_t c) {
+      uint16_t h = ((c * 40503U) >> 7) & 511;
+      while (_hash[h] >= 0) {
+        if (colors[_hash[h]] == c) return _hash[h];
+        h = (h + 1) & 511;
+      }
+      if (count >= 256) return -1;
+      colors[count] = c;
+      _hash[h] = count;
+      return count++;
+    }
+
+    // builds the palette of px, false if there are more than 256 colors
+    bool build(const uint16_t *px, size_t n) {
+      reset();
+      for (size_t i = 0; i < n; i++) if (index(px[i]) < 0) return false;
+      return true;
+    }
+};
+
+// RGB565/RLE/palette payload of px (palette must be built for LIVE_ENC_PALRLE), dst == nullptr only returns the size
+//   RGB565: [LE16]..., RLE565: [count,LE16]..., PALRLE: [ncolors (0=256)],[LE16 colors]...,[count,index]...
+static size_t encodeLive565(uint8_t *dst, const uint16_t *px, size_t n, uint8_t enc, LivePalette *pal)
+{
+  if (enc == LIVE_ENC_RGB565) {
+    if (dst) for (size_t i = 0; i < n; i++) { dst[2*i] = px[i] & 0xFF; dst[2*i+1] = px[i] >> 8; }
+    return 2*n;
+  }
+  size_t len = 0;
+  if (enc == LIVE_ENC_PALRLE) {
+    if (dst) {
+      dst[0] = pal->count & 0xFF; // 0 means 256
+      for (size_t i = 0; i < pal->count; i++) { dst[1+2*i] = pal->colors[i] & 0xFF; dst[2+2*i] = pal->colors[i] >> 8; }
+    }
+    len = 1 + 2*pal->count;
+  }
+  for (size_t i = 0; i < n; ) {
+    size_t run = 1;
+    while (i+run < n && run < 255 && px[i+run] == px[i]) run++;
+    if (dst) {
+      dst[len] = run;
+      if (enc == LIVE_ENC_PALRLE) dst[len+1] = pal->index(px[i]);
+      else { dst[len+1] = px[i] & 0xFF; dst[len+2] = px[i] >> 8; }
+    }
+    len += (enc == LIVE_ENC_PALRLE) ? 2 : 3;
+    i += run;
+  }
+  return len;
+}
+
+// 'L',3,enc,step,width(LE16),height(LE16)
+static inline void writeLiveHeader(uint8_t *dst, uint8_t enc, uint16_t step, uint16_t w, uint16_t h)
+{
+  dst[0] = 'L';
+  dst[1] = 3; //version
+  dst[2] = enc;
+  dst[3] = step > 255 ? 255 : step;
+  dst[4] = w & 0xFF; dst[5] = w >> 8;
+  dst[6] = h & 0xFF; dst[7] = h >> 8;
+}
+
+#endif
@@ -103,7 +103,7 @@ void onMqttMessage(char* topic, char* payload, AsyncMqttClientMessageProperties
     colorFromDecOrHexString(col, payloadStr);
     colorUpdated(CALL_MODE_DIRECT_CHANGE);
   } else if (strcmp_P(topic, PSTR("/api")) == 0) {
-    if (!requestJSONBufferLock(15)) {
+    if (!requestJSONBufferLock(15, JSON_PRIO_NET)) {
       delete[] payloadStr;
       payloadStr = nullptr;
       return;
@@ -18,6 +18,10 @@ PlaylistEntry *playlistEntries = nullptr;
 byte           playlistLen;               //number of playlist entries
 int8_t         playlistIndex = -1;
 uint16_t       playlistEntryDur = 0;      //duration of the current entry in tenths of seconds
+bool           playlistShuffled = false;  //already shuffled for the next iteration (by lookahead)
+bool           playlistPrefetched = false;//next entry is loaded into preset cache
+
+#define PLAYLIST_PREFETCH_TIME 1000       //ms before the next entry is due
 
 //values we need to keep about the parent playlist while inside sub-playlist
 //int8_t         parentPlaylistIndex = -1;
@@ -49,6 +53,7 @@ void unloadPlaylist() {
   }
   currentPlaylist = playlistIndex = -1;
   playlistLen = playlistEntryDur = playlistOptions = 0;
+  playlistShuffled = playlistPrefetched = false;
   DEBUG_PRINTLN(F("Playlist unloaded."));
 }
 
@@ -120,34 +125,54 @@ int16_t loadPlaylist(JsonObject playlistObj, byte presetId) {
 }
 
 
+//preset of the entry following the current one
+static byte getNextPlaylistPreset() {
+  if (playlistIndex+1 < playlistLen) return playlistEntries[playlistIndex+1].preset;
+  if (playlistRepeat == 1) return playlistEndPreset;
+  if ((playlistOptions & PL_OPTION_SHUFFLE) && !playlistShuffled) {
+    shufflePlaylist(); // shuffle now to know the first entry of the next iteration
+    playlistShuffled = true;
+  }
+  return playlistEntries[0].preset;
+}
+
 void handlePlaylist() {
   static unsigned long presetCycledTime = 0;
   // if fileDoc is not null JSON buffer is in use so just quit
   if (currentPlaylist < 0 || playlistEntries == nullptr || fileDoc != nullptr) return;
 
-  if (millis() - presetCycledTime > (100*playlistEntryDur)) {
-    presetCycledTime = millis();
-    if (bri == 0 || nightlightActive) return;
-
-    ++playlistIndex %= playlistLen; // -1 at 1st run (limit to playlistLen)
-
-    // playlist roll-over
-    if (!playlistIndex) {
-      if (playlistRepeat == 1) { //stop if all repetitions are done
-        unloadPlaylist();
-        if (playlistEndPreset) applyPreset(playlistEndPreset);
-        return;
-      }
-      if (playlistRepeat > 1) playlistRepeat--; // decrease repeat count on each index reset if not an endless playlist
-      // playlistRepeat == 0: endless loop
-      if (playlistOptions & PL_OPTION_SHUFFLE) shufflePlaylist(); // shuffle playlist and start over
-    }
+  unsigned long elapsed = millis() - presetCycledTime;
+  if (elapsed <= (100*playlistEntryDur)) {
+    // load next entry into preset cache during idle time so it can be applied without reading the file at the deadline
+    unsigned long lookahead = min(50UL*playlistEntryDur, (unsigned long)PLAYLIST_PREFETCH_TIME);
+    if (!playlistPrefetched && bri && !nightlightActive && 100UL*playlistEntryDur - elapsed < lookahead)
+      playlistPrefetched = prefetchPreset(getNextPlaylistPreset());
+    return;
+  }
+
+  presetCycledTime = millis();
+  if (bri == 0 || nightlightActive) return;
+
+  ++playlistIndex %= playlistLen; // -1 at 1st run (limit to playlistLen)
 
-    jsonTransitionOnce = true;
-    strip.setTransition(fadeTransition ? playlistEntries[playlistIndex].tr * 100 : 0);
-    playlistEntryDur = playlistEntries[playlistIndex].dur;
-    applyPreset(playlistEntries[playlistIndex].preset);
+  // playlist roll-over
+  if (!playlistIndex) {
+    if (playlistRepeat == 1) { //stop if all repetitions are done
+      unloadPlaylist();
+      if (playlistEndPreset) applyPreset(playlistEndPreset);
+      return;
+    }
+    if (playlistRepeat > 1) playlistRepeat--; // decrease repeat count on each index reset if not an endless playlist
+    // playlistRepeat == 0: endless loop
+    if ((playlistOptions & PL_OPTION_SHUFFLE) && !playlistShuffled) shufflePlaylist(); // shuffle playlist and start over
+    playlistShuffled = false;
   }
+
+  jsonTransitionOnce = true;
+  strip.setTransition(fadeTransition ? playlistEntries[playlistIndex].tr * 100 : 0);
+  playlistEntryDur = playlistEntries[playlistIndex].dur;
+  playlistPrefetched = false;
+  applyPreset(playlistEntries[playlistIndex].preset);
 }
 
 
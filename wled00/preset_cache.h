@@ -0,0 +1,96 @@
+#ifndef WLED_PRESET_CACHE_H
+#define WLED_PRESET_CACHE_H
+
+/*
+ * LRU cache of recently applied presets (presets.cpp), kept as MessagePack (compact and fast to deserialize)
+ * so that playlists and preset cycling do not need to read and parse presets.json again.
+ * Bounded by number of entries and total bytes. Only used from loop(), invalidate() may be called from any task.
+ * Free of Arduino calls so eviction and invalidation can be tested on the host.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef PRESET_CACHE_ALLOC
+  #define PRESET_CACHE_ALLOC(len) malloc(len)
+#endif
+
+template<size_t ENTRIES, size_t BYTES> class PresetCache {
+  struct Entry {
+    uint8_t *data;    // MessagePack
+    uint16_t len;
+    uint16_t used;    // LRU tick
+    uint8_t  id;
+  } _entries[ENTRIES] = {{nullptr, 0, 0, 0}};
+  size_t   _bytes = 0;
+  uint16_t _tick = 0;
+  volatile bool _invalid = false;
+  uint8_t  _tooLarge[32] = {0}; // bit set: preset exceeds BYTES/2, not worth prefetching
+
+  void freeEntry(Entry &e) {
+    free(e.data);
+    _bytes -= e.len;
+    e.data = nullptr;
+    e.len  = 0;
+  }
+
+  public:
+    ~PresetCache() { for (auto &e : _entries) if (e.data) freeEntry(e); }
+
+    //drops all entries on the next lookup (presets.json was changed)
+    void invalidate() { _invalid = true; }
+
+    bool contains(uint8_t id) {
+      if (_invalid) {
+        _invalid = false;
+        for (auto &e : _entries) if (e.data) freeEntry(e);
+        memset(_tooLarge, 0, sizeof(_tooLarge)); // presets may have changed size
+      }
+      for (auto &e : _entries) if (e.data && e.id == id) return true;
+      return false;
+    }
+
+    bool tooLarge(uint8_t id) const { return _tooLarge[id >> 3] & (1 << (id & 7)); }
+    size_t bytes() const { return _bytes; }
+
+    bool read(uint8_t id, JsonDocument &dest) {
+      if (!contains(id)) return false;
+      for (auto &e : _entries) {
+        if (!e.data || e.id != id) continue;
+        e.used = ++_tick;
+        return deserializeMsgPack(dest, (const uint8_t*)e.data, e.len) == DeserializationError::Ok; // const input: strings are copied
+      }
+      return false;
+    }
+
+    //returns false if the preset is too large or memory is low
+    bool store(uint8_t id, const JsonDocument &src) {
+      size_t len = measureMsgPack(src);
+      if (len > BYTES/2) _tooLarge[id >> 3] |= 1 << (id & 7);
+      if (len == 0 || len > BYTES/2) return false; // too large to be worth caching
+      if (contains(id)) for (auto &e : _entries) if (e.data && e.id == id) freeEntry(e);
+      Entry *entry = nullptr;
+      while (!entry || _bytes + len > BYTES) {
+        Entry *lru = nullptr;
+        entry = nullptr;
+        for (auto &e : _entries) {
+          if (!e.data) { if (!entry) entry = &e; continue; }
+          if (!lru || (uint16_t)(_tick - e.used) > (uint16_t)(_tick - lru->used)) lru = &e;
+        }
+        if (entry && _bytes + len <= BYTES) break;
+        if (!lru) return false;
+        freeEntry(*lru); // evict least recently used
+      }
+      entry->data = (uint8_t*) PRESET_CACHE_ALLOC(len);
+      if (!entry->data) return false;
+      serializeMsgPack(src, entry->data, len);
+      entry->len  = len;
+      entry->id   = id;
+      entry->used = ++_tick;
+      _bytes += len;
+      return true;
+    }
+};
+
+#endif
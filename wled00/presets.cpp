@@ -15,11 +15,128 @@ static volatile int8_t saveLedmap = -1;
 static char quickLoad[9];
 static char saveName[33];
 static bool includeBri = true, segBounds = true, selectedOnly = false, playlistSave = false;;
+static bool quickSave = false; // plain state save (usermods, PS=), these can be frequent and are journaled
 
 static const char *getFileName(bool persist = true) {
   return persist ? "/presets.json" : "/tmp.json";
 }
 
+#ifndef WLED_DISABLE_PRESET_CACHE
+  #define WLED_PRESET_CACHE
+  #ifdef ESP8266
+    #define PRESET_CACHE_ENTRIES 4
+    #define PRESET_CACHE_BYTES   2048
+  #else
+    #define PRESET_CACHE_ENTRIES 16
+    #define PRESET_CACHE_BYTES   16384
+  #endif
+  #if defined(BOARD_HAS_PSRAM) && defined(WLED_USE_PSRAM)
+    #define PRESET_CACHE_ALLOC(len) (psramFound() ? ps_malloc(len) : malloc(len))
+  #endif
+  #include "preset_cache.h"
+
+static PresetCache<PRESET_CACHE_ENTRIES, PRESET_CACHE_BYTES> presetCache;
+
+static bool readCachedPreset(uint8_t id, JsonDocument *dest) {
+  return presetCache.read(id, *dest);
+}
+
+static void cachePreset(uint8_t id, const JsonDocument *src) {
+  if (presetCache.store(id, *src)) DEBUG_PRINTF("Preset %d cached (%u bytes total).\n", (int)id, presetCache.bytes());
+}
+#endif
+
+// reads a preset into the cache ahead of applying it (playlist lookahead)
+// presets too large for the cache are skipped once they were read (they would be read again when applied)
+// returns false if that is not possible right now and should be retried
+bool prefetchPreset(byte index)
+{
+  #ifdef WLED_PRESET_CACHE
+  if (index == 0 || index > 250 || presetCache.contains(index)) return true; // also drops the size flags after an invalidation
+  if (presetCache.tooLarge(index)) return true;
+  if (presetToApply || presetToSave || !getJsonPoolFree()) return false; // busy, don't count as JSON lock failure
+  JsonLease lease(9, JSON_PRIO_LOOP, 0);
+  if (!lease) return false;
+  if (readObjectFromFileUsingId(getFileName(), index, lease.get()) && !lease->isNull()) cachePreset(index, lease.get());
+  #endif
+  return true;
+}
+
+// drops cached presets after presets.json was changed (freed on next preset load)
+void invalidatePresetCache() {
+  #ifdef WLED_PRESET_CACHE
+  presetCache.invalidate();
+  #endif
+}
+
+// API call presets ("o") and deletions are requested by web requests (async task on ESP32), but writing them
+// changes the preset index and journal used by loop(). They are queued as MessagePack and written from loop().
+#define PRESET_WRITE_QUEUE 4
+
+typedef struct {
+  uint8_t *data;    // MessagePack, nullptr to delete the preset
+  uint16_t len;
+  uint8_t  id;
+} PresetWrite;
+
+static PresetWrite presetWrites[PRESET_WRITE_QUEUE];
+static uint8_t presetWriteHead = 0;
+static volatile uint8_t presetWriteCount = 0;
+
+#ifdef ARDUINO_ARCH_ESP32
+static portMUX_TYPE presetWriteMux = portMUX_INITIALIZER_UNLOCKED;
+#define PWQ_LOCK()   portENTER_CRITICAL(&presetWriteMux)
+#define PWQ_UNLOCK() portEXIT_CRITICAL(&presetWriteMux)
+#else
+#define PWQ_LOCK()
+#define PWQ_UNLOCK()
+#endif
+
+static void queuePresetWrite(uint8_t id, const JsonDocument *content) {
+  size_t len = content ? measureMsgPack(*content) : 0;
+  uint8_t *data = nullptr;
+  if (len) {
+    if (len > UINT16_MAX || !(data = (uint8_t*)malloc(len))) {
+      errorFlag = ERR_NOBUF;
+      return;
+    }
+    serializeMsgPack(*content, data, len);
+  }
+  PWQ_LOCK();
+  bool full = presetWriteCount >= PRESET_WRITE_QUEUE;
+  if (!full) {
+    presetWrites[(presetWriteHead + presetWriteCount) % PRESET_WRITE_QUEUE] = {data, (uint16_t)len, id};
+    presetWriteCount++;
+  }
+  PWQ_UNLOCK();
+  if (full) {
+    free(data);
+    errorFlag = ERR_NOBUF;
+    DEBUG_PRINTLN(F("Preset write queue full!"));
+  }
+}
+
+static void writeQueuedPresets() {
+  if (!presetWriteCount || !requestJSONBufferLock(9)) return; // will set fileDoc
+  initPresetsFile(); // just in case if someone deleted presets.json using /edit
+  while (presetWriteCount) {
+    PWQ_LOCK();
+    PresetWrite w = presetWrites[presetWriteHead];
+    presetWriteHead = (presetWriteHead + 1) % PRESET_WRITE_QUEUE;
+    presetWriteCount--;
+    PWQ_UNLOCK();
+    fileDoc->clear(); // empty document deletes the preset
+    if (w.data) deserializeMsgPack(*fileDoc, (const uint8_t*)w.data, w.len); // const input: strings are copied
+    free(w.data);
+    DEBUG_PRINT(F("Writing queued preset ")); DEBUG_PRINTLN(w.id);
+    writeObjectToFileUsingId(getFileName(), w.id, fileDoc);
+  }
+  invalidatePresetCache();
+  presetsModifiedTime = toki.second(); //unix time
+  releaseJSONBufferLock();
+  updateFSInfo();
+}
+
 static void doSaveState() {
   bool persist = (presetToSave < 251);
   const char *filename = getFileName(persist);
@@ -65,8 +182,9 @@ static void doSaveState() {
     }
   } else
   #endif
-  writeObjectToFileUsingId(filename, presetToSave, fileDoc);
+  writeObjectToFileUsingId(filename, presetToSave, fileDoc, persist && quickSave); // journaled, merged into presets.json later
 
+  if (persist) invalidatePresetCache();
   if (persist) presetsModifiedTime = toki.second(); //unix time
   releaseJSONBufferLock();
   updateFSInfo();
@@ -77,27 +195,28 @@ static void doSaveState() {
   saveName[0]  = '\0';
   quickLoad[0] = '\0';
   playlistSave = false;
+  quickSave    = false;
 }
 
 bool getPresetName(byte index, String& name)
 {
-  if (!requestJSONBufferLock(9)) return false;
+  JsonLease lease(9);
+  if (!lease) return false;
   bool presetExists = false;
-  if (readObjectFromFileUsingId(getFileName(), index, &doc))
+  if (readObjectFromFileUsingId(getFileName(), index, lease.get()))
   {
-    JsonObject fdo = doc.as<JsonObject>();
+    JsonObject fdo = lease->as<JsonObject>();
     if (fdo["n"]) {
       name = (const char*)(fdo["n"]);
       presetExists = true;
     }
   }
-  releaseJSONBufferLock();
   return presetExists;
 }
 
 void initPresetsFile()
 {
-  if (WLED_FS.exists(getFileName())) return;
+  if (fileExists(getFileName())) return;
 
   StaticJsonDocument<64> doc;
   JsonObject sObj = doc.to<JsonObject>();
@@ -109,6 +228,7 @@ void initPresetsFile()
   }
   serializeJson(doc, f);
   f.close();
+  invalidateDirIndex();
 }
 
 bool applyPreset(byte index, byte callMode)
@@ -131,6 +251,8 @@ void applyPresetWithFallback(uint8_t index, uint8_t callMode, uint8_t effectID,
 
 void handlePresets()
 {
+  writeQueuedPresets();
+
   if (presetToSave) {
     doSaveState();
     return;
@@ -160,8 +282,16 @@ void handlePresets()
     errorFlag = ERR_NONE;
   } else
   #endif
+  #ifdef WLED_PRESET_CACHE
+  if (tmpPreset < 251 && readCachedPreset(tmpPreset, fileDoc)) {
+    errorFlag = ERR_NONE;
+  } else
+  #endif
   {
   errorFlag = readObjectFromFileUsingId(filename, tmpPreset, fileDoc) ? ERR_NONE : ERR_FS_PLOAD;
+  #ifdef WLED_PRESET_CACHE
+  if (!errorFlag && tmpPreset < 251 && !fileDoc->isNull()) cachePreset(tmpPreset, fileDoc);
+  #endif
   }
   fdo = fileDoc->as<JsonObject>();
 
@@ -196,6 +326,21 @@ void handlePresets()
   updateInterfaces(tmpMode);
 }
 
+//usermods are set up after the boot preset is shown, hands them its JSON state again
+void applyPresetToUsermods(byte index)
+{
+  if (index == 0 || index > 250 || !requestJSONBufferLock(9)) return;
+  bool found =
+  #ifdef WLED_PRESET_CACHE
+    readCachedPreset(index, fileDoc) ||
+  #endif
+    readObjectFromFileUsingId(getFileName(), index, fileDoc);
+  JsonObject fdo = fileDoc->as<JsonObject>();
+  if (found && fdo["win"].isNull()) usermods.readFromJsonState(fdo);
+  releaseJSONBufferLock();
+  if (found) usermods.onStateChange(CALL_MODE_INIT);
+}
+
 //called from handleSet(PS=) [network callback (fileDoc==nullptr), IR (irrational), deserializeState, UDP] and deserializeState() [network callback (filedoc!=nullptr)]
 void savePreset(byte index, const char* pname, JsonObject sObj)
 {
@@ -210,6 +355,7 @@ void savePreset(byte index, const char* pname, JsonObject sObj)
 
   presetToSave = index;
   playlistSave = false;
+  quickSave    = sObj.size() == 0; // no save options, i.e. not saved from the UI (auto save usermod, PS=)
   if (sObj[F("ql")].is<const char*>()) strlcpy(quickLoad, sObj[F("ql")].as<const char*>(), 9); // client limits QL to 2 chars, buffer for 8 bytes to allow unicode
 
   if (sObj.size()==0 || sObj["o"].isNull()) { // no "o" means not a playlist or custom API call, saving of state is async (not immediately)
@@ -220,7 +366,7 @@ void savePreset(byte index, const char* pname, JsonObject sObj)
   } else {
     // this is a playlist or API call
     if (sObj[F("playlist")].isNull()) {
-      // we will save API call immediately (often causes presets.json corruption)
+      // API call is saved as it was sent, written in loop()
       presetToSave = 0;
       if (index > 250 || !fileDoc) return; // cannot save API calls to temporary preset (255)
       sObj.remove("o");
@@ -229,10 +375,7 @@ void savePreset(byte index, const char* pname, JsonObject sObj)
       sObj.remove(F("error"));
       sObj.remove(F("psave"));
       if (sObj["n"].isNull()) sObj["n"] = saveName;
-      initPresetsFile(); // just in case if someone deleted presets.json using /edit
-      writeObjectToFileUsingId(getFileName(index<255), index, fileDoc);
-      presetsModifiedTime = toki.second(); //unix time
-      updateFSInfo();
+      queuePresetWrite(index, fileDoc);
     } else {
       // store playlist
       // WARNING: playlist will be loaded in json.cpp after this call and will have repeat counter increased by 1
@@ -243,8 +386,5 @@ void savePreset(byte index, const char* pname, JsonObject sObj)
 }
 
 void deletePreset(byte index) {
-  StaticJsonDocument<24> empty;
-  writeObjectToFileUsingId(getFileName(), index, &empty);
-  presetsModifiedTime = toki.second(); //unix time
-  updateFSInfo();
+  queuePresetWrite(index, nullptr); // deleted in loop()
 }
\ No newline at end of file
@@ -0,0 +1,199 @@
+#ifndef WLED_PRESETS_INDEX_H
+#define WLED_PRESETS_INDEX_H
+
+/*
+ * In-RAM index of /presets.json (file.cpp): preset ID -> offset and length of its object,
+ * and the runs of spaces between root-level objects (free extents) new objects can be written to.
+ * Free of Arduino calls so index and free space bookkeeping can be tested on the host.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <vector>
+
+typedef struct PresetIndexEntry {
+  uint32_t pos;   // offset of the object's '{'
+  uint16_t len;   // object length including braces
+  uint8_t  id;
+} presetidx_t;
+
+typedef struct FreeExtent {
+  uint32_t pos;
+  uint32_t len;
+} freeext_t;
+
+#define MAX_FREE_EXTENTS 32
+#define MIN_FREE_EXTENT   8   // smaller gaps can't hold a preset
+
+#define PRESETS_COMPACT_MIN_WASTE  2048 // bytes, compact if at least this and a quarter of the file is wasted
+
+static presetidx_t* findPresetIndex(std::vector<presetidx_t> &index, uint8_t id) {
+  for (auto &e : index) if (e.id == id) return &e;
+  return nullptr;
+}
+
+static void addFreeExtent(std::vector<freeext_t> &extents, uint32_t pos, uint32_t len) {
+  for (auto it = extents.begin(); it != extents.end(); ) { // merge with adjacent extents
+    if (it->pos + it->len == pos || pos + len == it->pos) {
+      if (it->pos < pos) pos = it->pos;
+      len += it->len;
+      it = extents.erase(it);
+    } else it++;
+  }
+  if (len < MIN_FREE_EXTENT) return;
+  if (extents.size() >= MAX_FREE_EXTENTS) { // drop the smallest
+    auto smallest = extents.begin();
+    for (auto it = extents.begin(); it != extents.end(); it++) if (it->len < smallest->len) smallest = it;
+    if (smallest->len >= len) return;
+    extents.erase(smallest);
+  }
+  extents.push_back({pos, len});
+}
+
+//marks [pos, pos+len) as used
+static void useFreeExtent(std::vector<freeext_t> &extents, uint32_t pos, uint32_t len) {
+  for (auto it = extents.begin(); it != extents.end(); it++) {
+    if (pos < it->pos || pos + len > it->pos + it->len) continue;
+    uint32_t end = it->pos + it->len;
+    uint32_t start = it->pos;
+    extents.erase(it);
+    if (pos - start >= MIN_FREE_EXTENT) extents.push_back({start, pos - start});
+    if (end - (pos + len) >= MIN_FREE_EXTENT) extents.push_back({pos + len, end - (pos + len)});
+    return;
+  }
+}
+
+//finds an extent with at least len spaces (if exact, it must start at pos)
+static bool findFreeExtent(const std::vector<freeext_t> &extents, uint32_t len, uint32_t &pos, bool exact = false) {
+  for (auto &e : extents) {
+    if (e.len < len || (exact && e.pos != pos)) continue;
+    pos = e.pos;
+    return true;
+  }
+  return false;
+}
+
+//size of a file holding only the indexed presets, as written by PresetsCompactor (upper bound, 3 digit keys)
+static uint32_t presetsLiveSize(const std::vector<presetidx_t> &index) {
+  uint32_t live = 8; // {"0":{}}
+  for (auto &e : index) live += e.len + 7; // ,"255":
+  return live;
+}
+
+//bytes wasted by spaces, 0 if compaction isn't worth it (requested compacts with less than a quarter wasted)
+static uint32_t presetsCompactionWaste(const std::vector<presetidx_t> &index, uint32_t fileSize, bool requested) {
+  uint32_t live = presetsLiveSize(index);
+  uint32_t waste = fileSize > live ? fileSize - live : 0;
+  if (waste < PRESETS_COMPACT_MIN_WASTE || (!requested && waste < fileSize/4)) return 0;
+  return waste;
+}
+
+//copies the indexed objects of /presets.json to a new file without gaps, a limited number of bytes per step()
+//Src needs seek() and read(), Dst write() and position() (fs::File)
+class PresetsCompactor {
+  size_t   _entry = 0;   // index entry being copied
+  uint16_t _copied = 0;  // bytes of current entry copied
+
+  public:
+    std::vector<presetidx_t> index; // offsets in the compacted file
+
+    template<class Dst> bool begin(Dst &dst, size_t entries) {
+      index.clear();
+      index.reserve(entries);
+      _entry = 0;
+      _copied = 0;
+      return dst.write((const uint8_t*)"{\"0\":{}", 7) == 7;
+    }
+
+    //returns 1 when all entries are copied and the file is closed with '}', 0 if more to copy, -1 on error
+    template<class Src, class Dst> int8_t step(const std::vector<presetidx_t> &src, Src &in, Dst &out, size_t budget, uint8_t *buf, size_t bufSize) {
+      while (budget && _entry < src.size()) {
+        const presetidx_t &e = src[_entry];
+        if (!_copied) {
+          char key[10];
+          int l = snprintf(key, sizeof(key), ",\"%d\":", e.id);
+          if (out.write((const uint8_t*)key, l) != (size_t)l) return -1;
+          index.push_back({(uint32_t)out.position(), e.len, e.id});
+          in.seek(e.pos);
+        }
+        size_t n = e.len - _copied;
+        if (n > bufSize) n = bufSize;
+        if (n > budget) n = budget;
+        if (in.read(buf, n) != n || (!_copied && buf[0] != '{') || out.write(buf, n) != n) return -1;
+        _copied += n;
+        budget -= n;
+        if (_copied >= e.len) { _entry++; _copied = 0; }
+      }
+      if (_entry < src.size()) return 0;
+      return out.write((uint8_t)'}') == 1 ? 1 : -1;
+    }
+};
+
+//indexes all root-level objects with numeric keys in a single pass, fed with consecutive chunks of the file
+class PresetIndexScanner {
+  std::vector<presetidx_t> &_index;
+  std::vector<freeext_t>   &_extents;
+  uint32_t _pos = 0;
+  uint16_t _depth = 0;
+  bool     _inString = false, _escaped = false;
+  int16_t  _key = -1;         // root-level key being parsed, -1 if not numeric
+  presetidx_t _cur;
+  bool     _inObj = false;
+  uint32_t _spaceStart = 0, _spaceLen = 0;
+  bool     _afterKey = false; // between ':' and the value, whitespace there is not free space
+
+  public:
+    bool complete = true;     // all root-level objects are indexed (required for compaction)
+
+    PresetIndexScanner(std::vector<presetidx_t> &index, std::vector<freeext_t> &extents) : _index(index), _extents(extents) {
+      _index.clear();
+      _extents.clear();
+    }
+
+    void feed(const uint8_t *buf, size_t len) {
+      for (size_t i = 0; i < len; i++, _pos++) {
+        char c = buf[i];
+        if (_inString) {
+          if (_escaped) _escaped = false;
+          else if (c == '\\') _escaped = true;
+          else if (c == '"') _inString = false;
+          else if (_depth == 1 && _key >= 0) _key = (c >= '0' && c <= '9' && _key < 256) ? _key*10 + c - '0' : -1;
+          continue;
+        }
+        if (c == ' ' && _depth == 1) {
+          if (!_afterKey && !_spaceLen++) _spaceStart = _pos;
+          continue;
+        }
+        if (_spaceLen) addFreeExtent(_extents, _spaceStart, _spaceLen);
+        _spaceLen = 0;
+        if (c > ' ') _afterKey = (c == ':' && _depth == 1);
+        switch (c) {
+          case '"':
+            _inString = true;
+            if (_depth == 1) _key = 0;
+            break;
+          case '{':
+            if (_depth == 1 && _key > 0 && _key < 256 && !findPresetIndex(_index, _key)) {
+              _cur.pos = _pos; _cur.id = _key; _inObj = true;
+            } else if (_depth == 1 && _key != 0) complete = false; // not a preset or duplicate, keep file as is
+            _depth++;
+            break;
+          case '}':
+            if (_depth) _depth--;
+            if (_depth == 1 && _inObj) {
+              _inObj = false;
+              _key = -1;
+              if (_pos - _cur.pos >= UINT16_MAX) { complete = false; break; } // not indexed, found by key search
+              _cur.len = _pos - _cur.pos + 1;
+              _index.push_back(_cur);
+            }
+            break;
+          default:
+            if (_depth == 1 && c != ':' && c != ',' && c > ' ') complete = false; // non-object value
+        }
+      }
+    }
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef WLED_PRESETS_JOURNAL_H
+#define WLED_PRESETS_JOURNAL_H
+
+/*
+ * Record format of the presets journal (/presets.jnl, see file.cpp)
+ * Record: preset ID, payload length (u16 LE), checksum, payload (MessagePack, empty if the preset was deleted)
+ * Encoding and scanning are free of Arduino calls so power loss can be simulated on the host.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define JOURNAL_HDR_LEN 4
+#define JOURNAL_SEED    0x5A
+
+static inline uint8_t journalChecksum(uint8_t sum, const uint8_t* data, size_t len) {
+  while (len--) sum = ((sum << 1) | (sum >> 7)) ^ *data++;
+  return sum;
+}
+
+//fills the record header in front of len payload bytes, returns false if the record is not valid
+static inline bool journalEncode(uint8_t* rec, uint8_t id, size_t len) {
+  if (id == 0 || id > 250 || len > UINT16_MAX) return false;
+  rec[0] = id;
+  rec[1] = len & 0xFF;
+  rec[2] = len >> 8;
+  rec[3] = journalChecksum(journalChecksum(JOURNAL_SEED, rec, 3), rec + JOURNAL_HDR_LEN, len);
+  return true;
+}
+
+//reads records from src (File like: size(), read(buf, len)), calls found(id, pos, len) for each one in order
+//stops at the first incomplete or corrupt record, returns the number of bytes of valid records
+template<size_t BUFSIZE, class Source, class Callback>
+size_t journalScan(Source& src, Callback found) {
+  size_t fileSize = src.size();
+  size_t pos = 0;
+  uint8_t hdr[JOURNAL_HDR_LEN];
+  uint8_t buf[BUFSIZE];
+  while (pos + JOURNAL_HDR_LEN <= fileSize && src.read(hdr, JOURNAL_HDR_LEN) == JOURNAL_HDR_LEN) {
+    uint16_t len = hdr[1] | (hdr[2] << 8);
+    if (hdr[0] == 0 || hdr[0] > 250 || pos + JOURNAL_HDR_LEN + len > fileSize) break;
+    uint8_t sum = journalChecksum(JOURNAL_SEED, hdr, 3);
+    size_t left = len;
+    while (left) {
+      size_t block = left < BUFSIZE ? left : BUFSIZE;
+      if (src.read(buf, block) != block) break;
+      sum = journalChecksum(sum, buf, block);
+      left -= block;
+    }
+    if (left || sum != hdr[3]) break;
+    found(hdr[0], pos, len);
+    pos += JOURNAL_HDR_LEN + len;
+  }
+  return pos;
+}
+
+#endif
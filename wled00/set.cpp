@@ -1,4 +1,5 @@
 #include "wled.h"
+#include "win_query.h"
 
 /*
  * Receives client input
@@ -107,6 +108,7 @@ void handleSettingsSet(AsyncWebServerRequest *request, byte subPage)
       char aw[4] = "AW"; aw[2] = 48+s; aw[3] = 0; //auto white mode
       char wo[4] = "WO"; wo[2] = 48+s; wo[3] = 0; //channel swap
       char sp[4] = "SP"; sp[2] = 48+s; sp[3] = 0; //bus clock speed (DotStar & PWM)
+      char nf[4] = "NF"; nf[2] = 48+s; nf[3] = 0; //max. fps (network)
       if (!request->hasArg(lp)) {
         DEBUG_PRINT(F("No data for "));
         DEBUG_PRINTLN(s);
@@ -146,6 +148,8 @@ void handleSettingsSet(AsyncWebServerRequest *request, byte subPage)
           case 3 : freqHz = 10000; break;
           case 4 : freqHz = 20000; break;
         }
+      } else if (type >= TYPE_NET_DDP_RGB && type < 96) {
+        freqHz = constrain(request->arg(nf).toInt(), 0, 255); // max. fps sent to the destination, 0 = unlimited
       } else {
         freqHz = 0;
       }
@@ -542,7 +546,7 @@ void handleSettingsSet(AsyncWebServerRequest *request, byte subPage)
   //USERMODS
   if (subPage == SUBPAGE_UM)
   {
-    if (!requestJSONBufferLock(5)) return;
+    if (!requestJSONBufferLock(5, JSON_PRIO_NET)) return;
 
     // global I2C & SPI pins
     int8_t hw_sda_pin  = !request->arg(F("SDA")).length() ? -1 : (int)request->arg(F("SDA")).toInt();
@@ -716,6 +720,7 @@ void handleSettingsSet(AsyncWebServerRequest *request, byte subPage)
   #endif
 
   lastEditTime = millis();
+  cfgVersion++;
   // do not save if factory reset or LED settings (which are saved after LED re-init)
   doSerializeConfig = subPage != SUBPAGE_LEDS && !(subPage == SUBPAGE_SEC && doReboot);
   if (subPage == SUBPAGE_UM) doReboot = request->hasArg(F("RBT")); // prevent race condition on dual core system (set reboot here, after doSerializeConfig has been set)
@@ -725,28 +730,37 @@ void handleSettingsSet(AsyncWebServerRequest *request, byte subPage)
 }
 
 
-//HTTP API request parser
+//HTTP API request parser (see win_query.h)
+// in/decrementing support (~ syntax) for a WinQuery value
+static bool updateVal(const WinQuery& q, uint32_t key, byte* val, byte minv=0, byte maxv=255)
+{
+  const char *v = q.get(key);
+  if (!v) return false;
+  parseNumber(v, val, minv, maxv);
+  return true;
+}
+
 bool handleSet(AsyncWebServerRequest *request, const String& req, bool apply)
 {
   if (!(req.indexOf("win") >= 0)) return false;
 
-  int pos = 0;
   DEBUG_PRINT(F("API req: "));
   DEBUG_PRINTLN(req);
 
+  WinQuery q(req.c_str());
+  if (!q.valid()) DEBUG_PRINTLN(F("API req: out of memory!"));
+
   //segment select (sets main segment)
-  pos = req.indexOf(F("SM="));
-  if (pos > 0 && !realtimeMode) {
-    strip.setMainSegmentId(getNumVal(&req, pos));
+  if (q.has(WK("SM")) && !realtimeMode) {
+    strip.setMainSegmentId(q.getInt(WK("SM")));
   }
 
   byte selectedSeg = strip.getFirstSelectedSegId();
 
   bool singleSegment = false;
 
-  pos = req.indexOf(F("SS="));
-  if (pos > 0) {
-    byte t = getNumVal(&req, pos);
+  if (q.has(WK("SS"))) {
+    byte t = q.getInt(WK("SS"));
     if (t < strip.getSegmentsNum()) {
       selectedSeg = t;
       singleSegment = true;
@@ -754,9 +768,8 @@ bool handleSet(AsyncWebServerRequest *request, const String& req, bool apply)
   }
 
   Segment& selseg = strip.getSegment(selectedSeg);
-  pos = req.indexOf(F("SV=")); //segment selected
-  if (pos > 0) {
-    byte t = getNumVal(&req, pos);
+  if (q.has(WK("SV"))) { //segment selected
+    byte t = q.getInt(WK("SV"));
     if (t == 2) for (uint8_t i = 0; i < strip.getSegmentsNum(); i++) strip.getSegment(i).selected = false; // unselect other segments
     selseg.selected = t;
   }
@@ -782,93 +795,71 @@ bool handleSet(AsyncWebServerRequest *request, const String& req, bool apply)
   uint16_t stopY   = selseg.stopY;
   uint8_t  grpI    = selseg.grouping;
   uint16_t spcI    = selseg.spacing;
-  pos = req.indexOf(F("&S=")); //segment start
-  if (pos > 0) {
-    startI = getNumVal(&req, pos);
-  }
-  pos = req.indexOf(F("S2=")); //segment stop
-  if (pos > 0) {
-    stopI = getNumVal(&req, pos);
-  }
-  pos = req.indexOf(F("GP=")); //segment grouping
-  if (pos > 0) {
-    grpI = getNumVal(&req, pos);
+  if (q.has(WK("S")))  startI = q.getInt(WK("S"));  //segment start
+  if (q.has(WK("S2"))) stopI  = q.getInt(WK("S2")); //segment stop
+  if (q.has(WK("GP"))) { //segment grouping
+    grpI = q.getInt(WK("GP"));
     if (grpI == 0) grpI = 1;
   }
-  pos = req.indexOf(F("SP=")); //segment spacing
-  if (pos > 0) {
-    spcI = getNumVal(&req, pos);
-  }
+  if (q.has(WK("SP"))) spcI = q.getInt(WK("SP")); //segment spacing
   strip.setSegment(selectedSeg, startI, stopI, grpI, spcI, UINT16_MAX, startY, stopY);
 
-  pos = req.indexOf(F("RV=")); //Segment reverse
-  if (pos > 0) selseg.reverse = req.charAt(pos+3) != '0';
-
-  pos = req.indexOf(F("MI=")); //Segment mirror
-  if (pos > 0) selseg.mirror = req.charAt(pos+3) != '0';
+  if (q.has(WK("RV"))) selseg.reverse = q.getBool(WK("RV")); //Segment reverse
+  if (q.has(WK("MI"))) selseg.mirror  = q.getBool(WK("MI")); //Segment mirror
 
-  pos = req.indexOf(F("SB=")); //Segment brightness/opacity
-  if (pos > 0) {
-    byte segbri = getNumVal(&req, pos);
+  if (q.has(WK("SB"))) { //Segment brightness/opacity
+    byte segbri = q.getInt(WK("SB"));
     selseg.setOption(SEG_OPTION_ON, segbri); // use transition
     if (segbri) {
       selseg.setOpacity(segbri);
     }
   }
 
-  pos = req.indexOf(F("SW=")); //segment power
-  if (pos > 0) {
-    switch (getNumVal(&req, pos)) {
+  if (q.has(WK("SW"))) { //segment power
+    switch (q.getInt(WK("SW"))) {
       case 0:  selseg.setOption(SEG_OPTION_ON, false);      break; // use transition
       case 1:  selseg.setOption(SEG_OPTION_ON, true);       break; // use transition
       default: selseg.setOption(SEG_OPTION_ON, !selseg.on); break; // use transition
     }
   }
 
-  pos = req.indexOf(F("PS=")); //saves current in preset
-  if (pos > 0) savePreset(getNumVal(&req, pos));
-
-  pos = req.indexOf(F("P1=")); //sets first preset for cycle
-  if (pos > 0) presetCycMin = getNumVal(&req, pos);
-
-  pos = req.indexOf(F("P2=")); //sets last preset for cycle
-  if (pos > 0) presetCycMax = getNumVal(&req, pos);
+  if (q.has(WK("PS"))) savePreset(q.getInt(WK("PS"))); //saves current in preset
+  if (q.has(WK("P1"))) presetCycMin = q.getInt(WK("P1")); //sets first preset for cycle
+  if (q.has(WK("P2"))) presetCycMax = q.getInt(WK("P2")); //sets last preset for cycle
 
   //apply preset
-  if (updateVal(req.c_str(), "PL=", &presetCycCurr, presetCycMin, presetCycMax)) {
+  if (updateVal(q, WK("PL"), &presetCycCurr, presetCycMin, presetCycMax)) {
     unloadPlaylist();
     applyPreset(presetCycCurr);
   }
 
   //set brightness
-  updateVal(req.c_str(), "&A=", &bri);
+  updateVal(q, WK("A"), &bri);
 
   bool col0Changed = false, col1Changed = false;
   //set colors
-  col0Changed |= updateVal(req.c_str(), "&R=", &colIn[0]);
-  col0Changed |= updateVal(req.c_str(), "&G=", &colIn[1]);
-  col0Changed |= updateVal(req.c_str(), "&B=", &colIn[2]);
-  col0Changed |= updateVal(req.c_str(), "&W=", &colIn[3]);
+  col0Changed |= updateVal(q, WK("R"), &colIn[0]);
+  col0Changed |= updateVal(q, WK("G"), &colIn[1]);
+  col0Changed |= updateVal(q, WK("B"), &colIn[2]);
+  col0Changed |= updateVal(q, WK("W"), &colIn[3]);
 
-  col1Changed |= updateVal(req.c_str(), "R2=", &colInSec[0]);
-  col1Changed |= updateVal(req.c_str(), "G2=", &colInSec[1]);
-  col1Changed |= updateVal(req.c_str(), "B2=", &colInSec[2]);
-  col1Changed |= updateVal(req.c_str(), "W2=", &colInSec[3]);
+  col1Changed |= updateVal(q, WK("R2"), &colInSec[0]);
+  col1Changed |= updateVal(q, WK("G2"), &colInSec[1]);
+  col1Changed |= updateVal(q, WK("B2"), &colInSec[2]);
+  col1Changed |= updateVal(q, WK("W2"), &colInSec[3]);
 
   #ifdef WLED_ENABLE_LOXONE
   //lox parser
-  pos = req.indexOf(F("LX=")); // Lox primary color
-  if (pos > 0) {
-    int lxValue = getNumVal(&req, pos);
+  if (q.has(WK("LX"))) { // Lox primary color
+    int lxValue = q.getInt(WK("LX"));
     if (parseLx(lxValue, colIn)) {
       bri = 255;
       nightlightActive = false; //always disable nightlight when toggling
       col0Changed = true;
     }
   }
-  pos = req.indexOf(F("LY=")); // Lox secondary color
-  if (pos > 0) {
-    int lxValue = getNumVal(&req, pos);
+  if (q.has(WK("LY"))) { // Lox secondary color
+    int lxValue = q.getInt(WK("LY"));
     if(parseLx(lxValue, colInSec)) {
       bri = 255;
       nightlightActive = false; //always disable nightlight when toggling
@@ -878,58 +869,50 @@ bool handleSet(AsyncWebServerRequest *request, const String& req, bool apply)
   #endif
 
   //set hue
-  pos = req.indexOf(F("HU="));
-  if (pos > 0) {
-    uint16_t temphue = getNumVal(&req, pos);
+  if (q.has(WK("HU"))) {
+    uint16_t temphue = q.getInt(WK("HU"));
     byte tempsat = 255;
-    pos = req.indexOf(F("SA="));
-    if (pos > 0) {
-      tempsat = getNumVal(&req, pos);
+    if (q.has(WK("SA"))) {
+      tempsat = q.getInt(WK("SA"));
     }
-    byte sec = req.indexOf(F("H2"));
-    colorHStoRGB(temphue, tempsat, (sec>0) ? colInSec : colIn);
+    bool sec = true; // as with the previous parser, which also selected the secondary color without H2
+    colorHStoRGB(temphue, tempsat, sec ? colInSec : colIn);
     col0Changed |= (!sec); col1Changed |= sec;
   }
 
   //set white spectrum (kelvin)
-  pos = req.indexOf(F("&K="));
-  if (pos > 0) {
-    byte sec = req.indexOf(F("K2"));
-    colorKtoRGB(getNumVal(&req, pos), (sec>0) ? colInSec : colIn);
+  if (q.has(WK("K"))) {
+    bool sec = true; // as with the previous parser, which also selected the secondary color without K2
+    colorKtoRGB(q.getInt(WK("K")), sec ? colInSec : colIn);
     col0Changed |= (!sec); col1Changed |= sec;
   }
 
   //set color from HEX or 32bit DEC
   byte tmpCol[4];
-  pos = req.indexOf(F("CL="));
-  if (pos > 0) {
-    colorFromDecOrHexString(colIn, (char*)req.substring(pos + 3).c_str());
+  if (q.has(WK("CL"))) {
+    colorFromDecOrHexString(colIn, (char*)q.get(WK("CL")));
     col0Changed = true;
   }
-  pos = req.indexOf(F("C2="));
-  if (pos > 0) {
-    colorFromDecOrHexString(colInSec, (char*)req.substring(pos + 3).c_str());
+  if (q.has(WK("C2"))) {
+    colorFromDecOrHexString(colInSec, (char*)q.get(WK("C2")));
     col1Changed = true;
   }
-  pos = req.indexOf(F("C3="));
-  if (pos > 0) {
-    colorFromDecOrHexString(tmpCol, (char*)req.substring(pos + 3).c_str());
+  if (q.has(WK("C3"))) {
+    colorFromDecOrHexString(tmpCol, (char*)q.get(WK("C3")));
     uint32_t col2 = RGBW32(tmpCol[0], tmpCol[1], tmpCol[2], tmpCol[3]);
     selseg.setColor(2, col2); // defined above (SS= or main)
     if (!singleSegment) strip.setColor(2, col2); // will set color to all active & selected segments
   }
 
   //set to random hue SR=0->1st SR=1->2nd
-  pos = req.indexOf(F("SR"));
-  if (pos > 0) {
-    byte sec = getNumVal(&req, pos);
+  if (q.flag(WK("SR"))) {
+    byte sec = q.getInt(WK("SR"));
     setRandomColor(sec? colInSec : colIn);
     col0Changed |= (!sec); col1Changed |= sec;
   }
 
   //swap 2nd & 1st
-  pos = req.indexOf(F("SC"));
-  if (pos > 0) {
+  if (q.flag(WK("SC"))) {
     byte temp;
     for (uint8_t i=0; i<4; i++) {
       temp        = colIn[i];
@@ -955,27 +938,28 @@ bool handleSet(AsyncWebServerRequest *request, const String& req, bool apply)
   bool fxModeChanged = false, speedChanged = false, intensityChanged = false, paletteChanged = false;
   bool custom1Changed = false, custom2Changed = false, custom3Changed = false, check1Changed = false, check2Changed = false, check3Changed = false;
   // set effect parameters
-  if (updateVal(req.c_str(), "FX=", &effectIn, 0, strip.getModeCount()-1)) {
+  if (updateVal(q, WK("FX"), &effectIn, 0, strip.getModeCount()-1)) {
     if (request != nullptr) unloadPlaylist(); // unload playlist if changing FX using web request
     fxModeChanged = true;
   }
-  speedChanged     = updateVal(req.c_str(), "SX=", &speedIn);
-  intensityChanged = updateVal(req.c_str(), "IX=", &intensityIn);
-  paletteChanged   = updateVal(req.c_str(), "FP=", &paletteIn, 0, strip.getPaletteCount()-1);
-  custom1Changed   = updateVal(req.c_str(), "X1=", &custom1In);
-  custom2Changed   = updateVal(req.c_str(), "X2=", &custom2In);
-  custom3Changed   = updateVal(req.c_str(), "X3=", &custom3In);
-  check1Changed    = updateVal(req.c_str(), "M1=", &check1In);
-  check2Changed    = updateVal(req.c_str(), "M2=", &check2In);
-  check3Changed    = updateVal(req.c_str(), "M3=", &check3In);
+  speedChanged     = updateVal(q, WK("SX"), &speedIn);
+  intensityChanged = updateVal(q, WK("IX"), &intensityIn);
+  paletteChanged   = updateVal(q, WK("FP"), &paletteIn, 0, strip.getPaletteCount()-1);
+  custom1Changed   = updateVal(q, WK("X1"), &custom1In);
+  custom2Changed   = updateVal(q, WK("X2"), &custom2In);
+  custom3Changed   = updateVal(q, WK("X3"), &custom3In);
+  check1Changed    = updateVal(q, WK("M1"), &check1In);
+  check2Changed    = updateVal(q, WK("M2"), &check2In);
+  check3Changed    = updateVal(q, WK("M3"), &check3In);
 
   stateChanged |= (fxModeChanged || speedChanged || intensityChanged || paletteChanged || custom1Changed || custom2Changed || custom3Changed || check1Changed || check2Changed || check3Changed);
 
   // apply to main and all selected segments to prevent #1618.
+  bool fxDefaults = q.has(WK("FXD")); // apply defaults if FXD= is specified
   for (uint8_t i = 0; i < strip.getSegmentsNum(); i++) {
     Segment& seg = strip.getSegment(i);
     if (i != selectedSeg && (singleSegment || !seg.isActive() || !seg.isSelected())) continue; // skip non main segments if not applying to all
-    if (fxModeChanged)    seg.setMode(effectIn, req.indexOf(F("FXD="))>0);  // apply defaults if FXD= is specified
+    if (fxModeChanged)    seg.setMode(effectIn, fxDefaults);
     if (speedChanged)     seg.speed     = speedIn;
     if (intensityChanged) seg.intensity = intensityIn;
     if (paletteChanged)   seg.setPalette(paletteIn);
@@ -988,34 +972,28 @@ bool handleSet(AsyncWebServerRequest *request, const String& req, bool apply)
   }
 
   //set advanced overlay
-  pos = req.indexOf(F("OL="));
-  if (pos > 0) {
-    overlayCurrent = getNumVal(&req, pos);
+  if (q.has(WK("OL"))) {
+    overlayCurrent = q.getInt(WK("OL"));
   }
 
   //apply macro (deprecated, added for compatibility with pre-0.11 automations)
-  pos = req.indexOf(F("&M="));
-  if (pos > 0) {
-    applyPreset(getNumVal(&req, pos) + 16);
+  if (q.has(WK("M"))) {
+    applyPreset(q.getInt(WK("M")) + 16);
   }
 
   //toggle send UDP direct notifications
-  pos = req.indexOf(F("SN="));
-  if (pos > 0) notifyDirect = (req.charAt(pos+3) != '0');
+  if (q.has(WK("SN"))) notifyDirect = q.getBool(WK("SN"));
 
   //toggle receive UDP direct notifications
-  pos = req.indexOf(F("RN="));
-  if (pos > 0) receiveNotifications = (req.charAt(pos+3) != '0');
+  if (q.has(WK("RN"))) receiveNotifications = q.getBool(WK("RN"));
 
   //receive live data via UDP/Hyperion
-  pos = req.indexOf(F("RD="));
-  if (pos > 0) receiveDirect = (req.charAt(pos+3) != '0');
+  if (q.has(WK("RD"))) receiveDirect = q.getBool(WK("RD"));
 
   //main toggle on/off (parse before nightlight, #1214)
-  pos = req.indexOf(F("&T="));
-  if (pos > 0) {
+  if (q.has(WK("T"))) {
     nightlightActive = false; //always disable nightlight when toggling
-    switch (getNumVal(&req, pos))
+    switch (q.getInt(WK("T")))
     {
       case 0: if (bri != 0){briLast = bri; bri = 0;} break; //off, only if it was previously on
       case 1: if (bri == 0) bri = briLast; break; //on, only if it was previously off
@@ -1024,17 +1002,15 @@ bool handleSet(AsyncWebServerRequest *request, const String& req, bool apply)
   }
 
   //toggle nightlight mode
-  bool aNlDef = false;
-  if (req.indexOf(F("&ND")) > 0) aNlDef = true;
-  pos = req.indexOf(F("NL="));
-  if (pos > 0)
+  bool aNlDef = q.flag(WK("ND"));
+  if (q.has(WK("NL")))
   {
-    if (req.charAt(pos+3) == '0')
+    if (!q.getBool(WK("NL")))
     {
       nightlightActive = false;
     } else {
       nightlightActive = true;
-      if (!aNlDef) nightlightDelayMins = getNumVal(&req, pos);
+      if (!aNlDef) nightlightDelayMins = q.getInt(WK("NL"));
       else         nightlightDelayMins = nightlightDelayMinsDefault;
       nightlightStartTime = millis();
     }
@@ -1046,75 +1022,59 @@ bool handleSet(AsyncWebServerRequest *request, const String& req, bool apply)
   }
 
   //set nightlight target brightness
-  pos = req.indexOf(F("NT="));
-  if (pos > 0) {
-    nightlightTargetBri = getNumVal(&req, pos);
+  if (q.has(WK("NT"))) {
+    nightlightTargetBri = q.getInt(WK("NT"));
     nightlightActiveOld = false; //re-init
   }
 
   //toggle nightlight fade
-  pos = req.indexOf(F("NF="));
-  if (pos > 0)
+  if (q.has(WK("NF")))
   {
-    nightlightMode = getNumVal(&req, pos);
+    nightlightMode = q.getInt(WK("NF"));
 
     nightlightActiveOld = false; //re-init
   }
   if (nightlightMode > NL_MODE_SUN) nightlightMode = NL_MODE_SUN;
 
-  pos = req.indexOf(F("TT="));
-  if (pos > 0) transitionDelay = getNumVal(&req, pos);
+  if (q.has(WK("TT"))) transitionDelay = q.getInt(WK("TT"));
   if (fadeTransition) strip.setTransition(transitionDelay);
 
   //set time (unix timestamp)
-  pos = req.indexOf(F("ST="));
-  if (pos > 0) {
-    setTimeFromAPI(getNumVal(&req, pos));
+  if (q.has(WK("ST"))) {
+    setTimeFromAPI(q.getInt(WK("ST")));
   }
 
   //set countdown goal (unix timestamp)
-  pos = req.indexOf(F("CT="));
-  if (pos > 0) {
-    countdownTime = getNumVal(&req, pos);
+  if (q.has(WK("CT"))) {
+    countdownTime = q.getInt(WK("CT"));
     if (countdownTime - toki.second() > 0) countdownOverTriggered = false;
   }
 
-  pos = req.indexOf(F("LO="));
-  if (pos > 0) {
-    realtimeOverride = getNumVal(&req, pos);
+  if (q.has(WK("LO"))) {
+    realtimeOverride = q.getInt(WK("LO"));
     if (realtimeOverride > 2) realtimeOverride = REALTIME_OVERRIDE_ALWAYS;
     if (realtimeMode && useMainSegmentOnly) {
       strip.getMainSegment().freeze = !realtimeOverride;
     }
   }
 
-  pos = req.indexOf(F("RB"));
-  if (pos > 0) doReboot = true;
+  if (q.flag(WK("RB"))) doReboot = true;
 
   // clock mode, 0: normal, 1: countdown
-  pos = req.indexOf(F("NM="));
-  if (pos > 0) countdownMode = (req.charAt(pos+3) != '0');
+  if (q.has(WK("NM"))) countdownMode = q.getBool(WK("NM"));
 
-  pos = req.indexOf(F("U0=")); //user var 0
-  if (pos > 0) {
-    userVar0 = getNumVal(&req, pos);
-  }
-
-  pos = req.indexOf(F("U1=")); //user var 1
-  if (pos > 0) {
-    userVar1 = getNumVal(&req, pos);
-  }
+  if (q.has(WK("U0"))) userVar0 = q.getInt(WK("U0")); //user var 0
+  if (q.has(WK("U1"))) userVar1 = q.getInt(WK("U1")); //user var 1
   // you can add more if you need
 
   // global col[], effectCurrent, ... are updated in stateChanged()
   if (!apply) return true; // when called by JSON API, do not call colorUpdated() here
 
-  pos = req.indexOf(F("&NN")); //do not send UDP notifications this time
-  stateUpdated((pos > 0) ? CALL_MODE_NO_NOTIFY : CALL_MODE_DIRECT_CHANGE);
+  //do not send UDP notifications this time
+  stateUpdated(q.flag(WK("NN")) ? CALL_MODE_NO_NOTIFY : CALL_MODE_DIRECT_CHANGE);
 
   // internal call, does not send XML response
-  pos = req.indexOf(F("IN"));
-  if (pos < 1) XML_response(request);
+  if (!q.flag(WK("IN"))) XML_response(request);
 
   return true;
 }
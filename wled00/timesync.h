@@ -0,0 +1,75 @@
+#ifndef WLED_TIMESYNC_H
+#define WLED_TIMESYNC_H
+
+/*
+ * Effect clock (strip.timebase) synchronization between WLED nodes.
+ * NTP style exchange on the node port (udpPort2):
+ *   t1: request sent (own millis), t2: request received (peer millis),
+ *   t3: response sent (peer millis), t4: response received (own millis)
+ * The peer also reports its effect time (millis()+timebase) at t3.
+ * Estimator is free of Arduino calls (all times are passed in) so it can be run in a host simulation.
+ */
+
+#include <stdint.h>
+
+#ifndef TIMESYNC_SAMPLES
+  #define TIMESYNC_SAMPLES  8    // number of samples kept for filtering
+#endif
+#define TIMESYNC_MAX_RTT    250  // ms, samples with longer round trip are discarded
+#define TIMESYNC_STEP_MS    1000 // ms, phase errors larger than this are stepped instead of slewed
+#define TIMESYNC_SLEW_MS    1    // ms, max. correction applied by one slew() call
+
+class PeerClock {
+  typedef struct {
+    int32_t  target; // timebase which would make own effect time equal peer's
+    uint16_t rtt;    // round trip delay excluding peer processing time
+  } Sample;
+
+  Sample   _samples[TIMESYNC_SAMPLES];
+  uint8_t  _count = 0;
+  uint8_t  _next  = 0;
+  int32_t  _target = 0;
+  uint16_t _rtt = 0;
+
+  public:
+    void reset() { _count = 0; _next = 0; }
+
+    // returns true if the sample was accepted
+    bool addSample(uint32_t t1, uint32_t t2, uint32_t t3, uint32_t t4, uint32_t peerEffectTime) {
+      int32_t rtt = int32_t(t4 - t1) - int32_t(t3 - t2);
+      if (rtt < 0 || rtt > TIMESYNC_MAX_RTT) return false;
+      // peer effect time at t4 is the reported one plus the return path delay (assumed to be half the round trip)
+      int32_t target = int32_t(peerEffectTime + uint32_t(rtt/2) - t4);
+      // peer stepped its own timebase (new sync source, effect restart), previous samples are useless
+      if (_count && (target - _target > TIMESYNC_STEP_MS || _target - target > TIMESYNC_STEP_MS)) reset();
+      _samples[_next].target = target;
+      _samples[_next].rtt    = rtt;
+      _next = (_next + 1) % TIMESYNC_SAMPLES;
+      if (_count < TIMESYNC_SAMPLES) _count++;
+      // clock filter: the sample with the shortest round trip is least affected by queuing delays
+      uint8_t best = 0;
+      for (uint8_t i = 1; i < _count; i++) if (_samples[i].rtt < _samples[best].rtt) best = i;
+      _target = _samples[best].target;
+      _rtt    = _samples[best].rtt;
+      return true;
+    }
+
+    // move timebase towards the estimate by at most maxStep ms, large errors are stepped
+    uint32_t slew(uint32_t timebase, uint8_t maxStep = TIMESYNC_SLEW_MS) const {
+      if (!isValid()) return timebase;
+      int32_t err = int32_t(uint32_t(_target) - timebase);
+      if (err > TIMESYNC_STEP_MS || err < -TIMESYNC_STEP_MS) return uint32_t(_target);
+      if (err >  maxStep) err =  maxStep;
+      if (err < -maxStep) err = -maxStep;
+      return timebase + err;
+    }
+
+    // positive if own effects run ahead of the peer
+    int32_t  phaseError(uint32_t timebase) const { return isValid() ? int32_t(timebase - uint32_t(_target)) : 0; }
+    uint32_t getTarget()  const { return _target; }
+    uint16_t getRTT()     const { return _rtt; }
+    uint8_t  getSamples() const { return _count; }
+    bool     isValid()    const { return _count > 0; }
+};
+
+#endif
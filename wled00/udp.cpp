@@ -1,14 +1,90 @@
 #include "wled.h"
+#include "udp_delta.h"
 
 /*
  * UDP sync notifier / Realtime / Hyperion / TPM2.NET
  */
 
-#define UDP_SEG_SIZE 36
 #define SEG_OFFSET (41+(MAX_NUM_SEGMENTS*UDP_SEG_SIZE))
 #define WLEDPACKETSIZE (41+(MAX_NUM_SEGMENTS*UDP_SEG_SIZE)+0)
 #define UDP_IN_MAXSIZE 1472
 #define PRESUMED_NETWORK_DELAY 3 //how many ms could it take on avg to reach the receiver? This will be added to transmitted times
+#define TIMESYNC_INTERVAL 2000 //ms between effect clock sync requests to the sync source
+#define TIMESYNC_INTERVAL_FAST 250 //ms between requests while the sample filter is filling up
+#define TIMESYNC_MAX_MISSED 5 //unanswered requests after which the sync source is dropped (e.g. older WLED version)
+#define TIMESYNC_SLEW_INTERVAL 20 //ms between timebase corrections (1ms per 20ms is hardly visible)
+#ifndef UDP_DELTA_FULL_INTERVAL
+  #define UDP_DELTA_FULL_INTERVAL 10000 //ms after which a full notifier packet is sent instead of deltas (late joiners, lost packets)
+#endif
+
+// v13 delta notifications are relative to the segment records of the last full packet sent
+static byte         *udpSegCache      = nullptr;
+static uint64_t     *udpSegDirty      = nullptr; // bytes changed since the last full packet, per segment (sticky)
+static uint8_t       udpSegCacheCount = 0;
+static unsigned long udpFullSentTime  = 0;
+static bool          udpDeltaPending  = false; // deltas were sent since the last full packet
+
+// fill one UDP_SEG_SIZE segment record of the notifier packet
+static void packSegment(byte *rec, Segment &selseg, uint8_t id)
+{
+  rec[0]  = id;
+  rec[1]  = selseg.start >> 8;
+  rec[2]  = selseg.start & 0xFF;
+  rec[3]  = selseg.stop >> 8;
+  rec[4]  = selseg.stop & 0xFF;
+  rec[5]  = selseg.grouping;
+  rec[6]  = selseg.spacing;
+  rec[7]  = selseg.offset >> 8;
+  rec[8]  = selseg.offset & 0xFF;
+  rec[9]  = selseg.options & 0x8F; //only take into account selected, mirrored, on, reversed, reverse_y (for 2D); ignore freeze, reset, transitional
+  rec[10] = selseg.opacity;
+  rec[11] = selseg.mode;
+  rec[12] = selseg.speed;
+  rec[13] = selseg.intensity;
+  rec[14] = selseg.palette;
+  rec[15] = R(selseg.colors[0]);
+  rec[16] = G(selseg.colors[0]);
+  rec[17] = B(selseg.colors[0]);
+  rec[18] = W(selseg.colors[0]);
+  rec[19] = R(selseg.colors[1]);
+  rec[20] = G(selseg.colors[1]);
+  rec[21] = B(selseg.colors[1]);
+  rec[22] = W(selseg.colors[1]);
+  rec[23] = R(selseg.colors[2]);
+  rec[24] = G(selseg.colors[2]);
+  rec[25] = B(selseg.colors[2]);
+  rec[26] = W(selseg.colors[2]);
+  rec[27] = selseg.cct;
+  rec[28] = (selseg.options>>8) & 0xFF; //mirror_y, transpose, 2D mapping & sound
+  rec[29] = selseg.custom1;
+  rec[30] = selseg.custom2;
+  rec[31] = selseg.custom3 | (selseg.check1<<5) | (selseg.check2<<6) | (selseg.check3<<7);
+  rec[32] = selseg.startY >> 8;
+  rec[33] = selseg.startY & 0xFF;
+  rec[34] = selseg.stopY >> 8;
+  rec[35] = selseg.stopY & 0xFF;
+}
+
+// write segment records changed since the last full packet, returns 0 if a full packet would be shorter
+static size_t packSegmentDeltas(byte *udpOut)
+{
+  byte rec[UDP_SEG_SIZE];
+  size_t len = 42, s = 0, nsegs = strip.getSegmentsNum();
+  uint8_t numRecs = 0;
+  for (size_t i = 0; i < nsegs; i++) {
+    Segment &selseg = strip.getSegment(i);
+    if (!selseg.isActive()) continue;
+    packSegment(rec, selseg, s);
+    uint64_t mask = udpSegDirty[s] = udpDeltaMask(rec, udpSegCache + s*UDP_SEG_SIZE, udpSegDirty[s]);
+    s++;
+    if (!mask) continue;
+    if (len + udpDeltaSize(mask) >= 41 + udpSegCacheCount*UDP_SEG_SIZE) return 0;
+    len += udpPackDelta(udpOut + len, rec, mask);
+    numRecs++;
+  }
+  udpOut[41] = numRecs;
+  return len;
+}
 
 void notify(byte callMode, bool followUp)
 {
@@ -46,7 +122,8 @@ void notify(byte callMode, bool followUp)
   //6: supports timebase syncing, 29 byte packet 7: supports tertiary color 8: supports sys time sync, 36 byte packet
   //9: supports sync groups, 37 byte packet 10: supports CCT, 39 byte packet 11: per segment options, variable packet length (40+MAX_NUM_SEGMENTS*3)
   //12: enhanced effect sliders, 2D & mapping options
-  udpOut[11] = 12;
+  //13: delta packets (segment record size 0), only segment bytes changed since last full packet follow the header
+  udpOut[11] = 13;
   col = mainseg.colors[1];
   udpOut[12] = R(col);
   udpOut[13] = G(col);
@@ -89,50 +166,53 @@ void notify(byte callMode, bool followUp)
   udpOut[37] = strip.hasCCTBus() ? 0 : 255; //check this is 0 for the next value to be significant
   udpOut[38] = mainseg.cct;
 
-  udpOut[39] = strip.getActiveSegmentsNum();
-  udpOut[40] = UDP_SEG_SIZE; //size of each loop iteration (one segment)
-  size_t s = 0, nsegs = strip.getSegmentsNum();
-  for (size_t i = 0; i < nsegs; i++) {
-    Segment &selseg = strip.getSegment(i);
-    if (!selseg.isActive()) continue;
-    uint16_t ofs = 41 + s*UDP_SEG_SIZE; //start of segment offset byte
-    udpOut[0 +ofs] = s;
-    udpOut[1 +ofs] = selseg.start >> 8;
-    udpOut[2 +ofs] = selseg.start & 0xFF;
-    udpOut[3 +ofs] = selseg.stop >> 8;
-    udpOut[4 +ofs] = selseg.stop & 0xFF;
-    udpOut[5 +ofs] = selseg.grouping;
-    udpOut[6 +ofs] = selseg.spacing;
-    udpOut[7 +ofs] = selseg.offset >> 8;
-    udpOut[8 +ofs] = selseg.offset & 0xFF;
-    udpOut[9 +ofs] = selseg.options & 0x8F; //only take into account selected, mirrored, on, reversed, reverse_y (for 2D); ignore freeze, reset, transitional
-    udpOut[10+ofs] = selseg.opacity;
-    udpOut[11+ofs] = selseg.mode;
-    udpOut[12+ofs] = selseg.speed;
-    udpOut[13+ofs] = selseg.intensity;
-    udpOut[14+ofs] = selseg.palette;
-    udpOut[15+ofs] = R(selseg.colors[0]);
-    udpOut[16+ofs] = G(selseg.colors[0]);
-    udpOut[17+ofs] = B(selseg.colors[0]);
-    udpOut[18+ofs] = W(selseg.colors[0]);
-    udpOut[19+ofs] = R(selseg.colors[1]);
-    udpOut[20+ofs] = G(selseg.colors[1]);
-    udpOut[21+ofs] = B(selseg.colors[1]);
-    udpOut[22+ofs] = W(selseg.colors[1]);
-    udpOut[23+ofs] = R(selseg.colors[2]);
-    udpOut[24+ofs] = G(selseg.colors[2]);
-    udpOut[25+ofs] = B(selseg.colors[2]);
-    udpOut[26+ofs] = W(selseg.colors[2]);
-    udpOut[27+ofs] = selseg.cct;
-    udpOut[28+ofs] = (selseg.options>>8) & 0xFF; //mirror_y, transpose, 2D mapping & sound
-    udpOut[29+ofs] = selseg.custom1;
-    udpOut[30+ofs] = selseg.custom2;
-    udpOut[31+ofs] = selseg.custom3 | (selseg.check1<<5) | (selseg.check2<<6) | (selseg.check3<<7);
-    udpOut[32+ofs] = selseg.startY >> 8;
-    udpOut[33+ofs] = selseg.startY & 0xFF;
-    udpOut[34+ofs] = selseg.stopY >> 8;
-    udpOut[35+ofs] = selseg.stopY & 0xFF;
-    ++s;
+  uint8_t nActive = strip.getActiveSegmentsNum();
+  if (!udpSyncDelta && udpSegCache) {
+    free(udpSegCache);
+    free(udpSegDirty);
+    udpSegCache = nullptr;
+    udpSegDirty = nullptr;
+  } else if (udpSyncDelta && !udpSegCache) {
+    udpSegCache = (byte*)malloc(MAX_NUM_SEGMENTS*UDP_SEG_SIZE);
+    udpSegDirty = (uint64_t*)malloc(MAX_NUM_SEGMENTS*sizeof(uint64_t));
+    if (!udpSegCache || !udpSegDirty) {
+      free(udpSegCache);
+      free(udpSegDirty);
+      udpSegCache = nullptr;
+      udpSegDirty = nullptr;
+    }
+    udpSegCacheCount = 0;
+  }
+
+  // delta packets report 0 segments of size 0 so that v12 receivers only apply the header
+  size_t packetSize = 0;
+  if (udpSegCache && udpSegCacheCount == nActive && millis() - udpFullSentTime < UDP_DELTA_FULL_INTERVAL) {
+    udpOut[39] = 0;
+    udpOut[40] = 0;
+    packetSize = packSegmentDeltas(udpOut);
+  }
+
+  if (packetSize) {
+    udpDeltaPending = true;
+  } else {
+    udpOut[39] = nActive;
+    udpOut[40] = UDP_SEG_SIZE; //size of each loop iteration (one segment)
+    size_t s = 0, nsegs = strip.getSegmentsNum();
+    for (size_t i = 0; i < nsegs; i++) {
+      Segment &selseg = strip.getSegment(i);
+      if (!selseg.isActive()) continue;
+      packSegment(udpOut + 41 + s*UDP_SEG_SIZE, selseg, s); //start of segment offset byte
+      ++s;
+    }
+    packetSize = WLEDPACKETSIZE;
+    if (udpSegCache) {
+      memcpy(udpSegCache, udpOut + 41, s*UDP_SEG_SIZE);
+      memset(udpSegDirty, 0, MAX_NUM_SEGMENTS*sizeof(uint64_t));
+      udpSegCacheCount = s;
+      packetSize = 41 + s*UDP_SEG_SIZE; // v13 receivers do not rely on fixed packet size
+    }
+    udpFullSentTime = millis();
+    udpDeltaPending = false;
   }
 
   //uint16_t offs = SEG_OFFSET;
@@ -142,13 +222,155 @@ void notify(byte callMode, bool followUp)
   broadcastIp = ~uint32_t(Network.subnetMask()) | uint32_t(Network.gatewayIP());
 
   notifierUdp.beginPacket(broadcastIp, udpPort);
-  notifierUdp.write(udpOut, WLEDPACKETSIZE);
+  notifierUdp.write(udpOut, packetSize);
   notifierUdp.endPacket();
   notificationSentCallMode = callMode;
   notificationSentTime = millis();
   notificationCount = followUp ? notificationCount + 1 : 0;
 }
 
+// apply a received notifier segment record, mask selects which record bytes are to be applied
+static void applySegmentSync(const byte *rec, byte version, bool applyEffects, bool applyColors, uint64_t mask)
+{
+  #define SEG_CHANGED(b) ((mask >> (b)) & 0x01)
+  uint8_t id = rec[0];
+  Segment& selseg = strip.getSegment(id);
+  if (!selseg.isActive() || !selseg.isSelected()) return; //do not apply to non selected segments
+
+  uint16_t startY = 0, start  = (rec[1] << 8 | rec[2]);
+  uint16_t stopY  = 1, stop   = (rec[3] << 8 | rec[4]);
+  uint16_t offset = (rec[7] << 8 | rec[8]);
+  bool boundsChanged = SEG_CHANGED(1) || SEG_CHANGED(2) || SEG_CHANGED(3) || SEG_CHANGED(4) || SEG_CHANGED(7) || SEG_CHANGED(8)
+                    || SEG_CHANGED(32) || SEG_CHANGED(33) || SEG_CHANGED(34) || SEG_CHANGED(35);
+  if (!receiveSegmentOptions) {
+    if (boundsChanged) selseg.setUp(start, stop, selseg.grouping, selseg.spacing, offset, startY, stopY);
+    return;
+  }
+  //for (size_t j = 1; j<4; j++) selseg.setOption(j, (rec[9] >> j) & 0x01); //only take into account mirrored, on, reversed; ignore selected
+  if (SEG_CHANGED(9)) selseg.options = (selseg.options & 0x0071U) | (rec[9] & 0x0E); // ignore selected, freeze, reset & transitional
+  if (SEG_CHANGED(10)) selseg.setOpacity(rec[10]);
+  if (applyEffects) {
+    if (SEG_CHANGED(11)) strip.setMode(id, rec[11]);
+    if (SEG_CHANGED(12)) selseg.speed     = rec[12];
+    if (SEG_CHANGED(13)) selseg.intensity = rec[13];
+    if (SEG_CHANGED(14)) selseg.palette   = rec[14];
+  }
+  if (applyColors) {
+    if (SEG_CHANGED(15) || SEG_CHANGED(16) || SEG_CHANGED(17) || SEG_CHANGED(18)) selseg.setColor(0, RGBW32(rec[15],rec[16],rec[17],rec[18]));
+    if (SEG_CHANGED(19) || SEG_CHANGED(20) || SEG_CHANGED(21) || SEG_CHANGED(22)) selseg.setColor(1, RGBW32(rec[19],rec[20],rec[21],rec[22]));
+    if (SEG_CHANGED(23) || SEG_CHANGED(24) || SEG_CHANGED(25) || SEG_CHANGED(26)) selseg.setColor(2, RGBW32(rec[23],rec[24],rec[25],rec[26]));
+    if (SEG_CHANGED(27)) selseg.setCCT(rec[27]);
+  }
+  if (version > 11) {
+    // when applying synced options ignore selected as it may be used as indicator of which segments to sync
+    // freeze, reset should never be synced
+    // LSB to MSB: select, reverse, on, mirror, freeze, reset, reverse_y, mirror_y, transpose, map1d2d (3), ssim (2), set (2)
+    if (SEG_CHANGED(9) || SEG_CHANGED(28)) selseg.options = (selseg.options & 0b0000000000110001U) | (rec[28]<<8) | (rec[9] & 0b11001110U); // ignore selected, freeze, reset
+    if (applyEffects) {
+      if (SEG_CHANGED(29)) selseg.custom1 = rec[29];
+      if (SEG_CHANGED(30)) selseg.custom2 = rec[30];
+      if (SEG_CHANGED(31)) {
+        selseg.custom3 = rec[31] & 0x1F;
+        selseg.check1  = (rec[31]>>5) & 0x1;
+        selseg.check2  = (rec[31]>>6) & 0x1;
+        selseg.check3  = (rec[31]>>7) & 0x1;
+      }
+    }
+    startY = (rec[32] << 8 | rec[33]);
+    stopY  = (rec[34] << 8 | rec[35]);
+  }
+  if (receiveSegmentBounds) {
+    if (boundsChanged || SEG_CHANGED(5) || SEG_CHANGED(6)) selseg.setUp(start, stop, rec[5], rec[6], offset, startY, stopY);
+  } else {
+    if (SEG_CHANGED(5) || SEG_CHANGED(6)) selseg.setUp(selseg.start, selseg.stop, rec[5], rec[6], selseg.offset, selseg.startY, selseg.stopY);
+  }
+  #undef SEG_CHANGED
+}
+
+/*********************************************************************************************\
+   Effect clock sync on node port: request (255,2), response (255,3)
+\*********************************************************************************************/
+static unsigned long timeSyncReqTime  = 0;
+static unsigned long timeSyncSlewTime = 0;
+static uint8_t       timeSyncSeq      = 0;
+static uint8_t       timeSyncMissed   = 0;
+
+static inline void writeUInt32(byte *buf, uint32_t v) { buf[0] = v >> 24; buf[1] = v >> 16; buf[2] = v >> 8; buf[3] = v; }
+static inline uint32_t readUInt32(const byte *buf) { return (uint32_t(buf[0]) << 24) | (uint32_t(buf[1]) << 16) | (uint32_t(buf[2]) << 8) | buf[3]; }
+
+static void followTimeSyncPeer(IPAddress ip)
+{
+  if (ip == timeSyncPeer) return;
+  timeSyncPeer    = ip;
+  timeSyncMissed  = 0;
+  timeSyncReqTime = 0; // request immediately
+  peerClock.reset();
+}
+
+static void handleTimeSync()
+{
+  if (!udpTimeSync || !udp2Connected) timeSyncPeer[0] = 0;
+  if (!timeSyncPeer[0]) return;
+
+  unsigned long now = millis();
+  if (now - timeSyncReqTime > (peerClock.getSamples() < TIMESYNC_SAMPLES/2 ? TIMESYNC_INTERVAL_FAST : TIMESYNC_INTERVAL)) {
+    timeSyncReqTime = now;
+    if (timeSyncMissed++ >= TIMESYNC_MAX_MISSED) {
+      DEBUG_PRINTLN(F("Time sync peer not responding."));
+      timeSyncPeer[0] = 0;
+      return;
+    }
+    //  0: 1 byte 'binary token 255'
+    //  1: 1 byte id '2' (request)
+    //  2: 1 byte sequence number
+    //  3: 4 byte t1 (request sent)
+    byte data[7];
+    data[0] = 255;
+    data[1] = 2;
+    data[2] = ++timeSyncSeq;
+    writeUInt32(data+3, millis());
+    notifier2Udp.beginPacket(timeSyncPeer, udpPort2);
+    notifier2Udp.write(data, sizeof(data));
+    notifier2Udp.endPacket();
+  }
+
+  if (now - timeSyncSlewTime > TIMESYNC_SLEW_INTERVAL) {
+    timeSyncSlewTime = now;
+    strip.timebase = peerClock.slew(strip.timebase);
+  }
+}
+
+static void handleTimeSyncPacket(const byte *udpIn, size_t len, uint32_t rxTime)
+{
+  if (udpIn[1] == 2 && len >= 7) { // request, reply to sender
+    //  0: 1 byte 'binary token 255'
+    //  1: 1 byte id '3' (response)
+    //  2: 1 byte sequence number of request
+    //  3: 4 byte t1 (from request)
+    //  7: 4 byte t2 (request received)
+    // 11: 4 byte t3 (response sent)
+    // 15: 4 byte effect time at t3 (millis + timebase)
+    byte data[19];
+    data[0] = 255;
+    data[1] = 3;
+    data[2] = udpIn[2];
+    memcpy(data+3, udpIn+3, 4);
+    writeUInt32(data+7, rxTime);
+    uint32_t t3 = millis();
+    writeUInt32(data+11, t3);
+    writeUInt32(data+15, t3 + strip.timebase);
+    notifier2Udp.beginPacket(notifier2Udp.remoteIP(), notifier2Udp.remotePort());
+    notifier2Udp.write(data, sizeof(data));
+    notifier2Udp.endPacket();
+    return;
+  }
+  if (udpIn[1] == 3 && len >= 19) { // response to our request
+    if (!timeSyncPeer[0] || notifier2Udp.remoteIP() != timeSyncPeer || udpIn[2] != timeSyncSeq) return; // stale or unsolicited
+    timeSyncMissed = 0;
+    peerClock.addSample(readUInt32(udpIn+3), readUInt32(udpIn+7), readUInt32(udpIn+11), rxTime, readUInt32(udpIn+15));
+  }
+}
+
 void realtimeLock(uint32_t timeoutMs, byte md)
 {
   if (!realtimeMode && !realtimeOverride) {
@@ -221,6 +443,12 @@ void handleNotifications()
     notify(notificationSentCallMode,true);
   }
 
+  //v13 deltas are relative to the last full packet, refresh it periodically for late joiners and lost packets
+  if (udpConnected && udpDeltaPending && (millis()-notificationSentTime) > UDP_DELTA_FULL_INTERVAL) {
+    udpDeltaPending = false;
+    notify(notificationSentCallMode,true);
+  }
+
   if (e131NewData && millis() - strip.getLastShow() > 15)
   {
     e131NewData = false;
@@ -230,6 +458,8 @@ void handleNotifications()
   //unlock strip when realtime UDP times out
   if (realtimeMode && millis() > realtimeTimeout) exitRealtime();
 
+  handleTimeSync();
+
   //receive UDP notifications
   if (!udpConnected) return;
 
@@ -239,6 +469,7 @@ void handleNotifications()
     packetSize = notifier2Udp.parsePacket();
     isSupp = true;
   }
+  uint32_t rxTime = millis(); // as close to reception as we get, used for effect clock sync
 
   //hyperion / raw RGB
   if (!packetSize && udpRgbConnected) {
@@ -264,8 +495,6 @@ void handleNotifications()
     }
   }
 
-  if (!(receiveNotifications || receiveDirect)) return;
-
   localIP = Network.localIP();
   //notifier and UDP realtime
   if (!packetSize || packetSize > UDP_IN_MAXSIZE) return;
@@ -276,6 +505,14 @@ void handleNotifications()
   if (isSupp) len = notifier2Udp.read(udpIn, packetSize);
   else        len =  notifierUdp.read(udpIn, packetSize);
 
+  // WLED effect clock sync, answered even if not receiving notifications (we may be the sync source)
+  if (isSupp && udpIn[0] == 255 && (udpIn[1] == 2 || udpIn[1] == 3)) {
+    handleTimeSyncPacket(udpIn, len, rxTime);
+    return;
+  }
+
+  if (!(receiveNotifications || receiveDirect)) return;
+
   // WLED nodes info notifications
   if (isSupp && udpIn[0] == 255 && udpIn[1] == 1 && len >= 40) {
     if (!nodeListEnabled || notifier2Udp.remoteIP() == localIP) return;
@@ -359,57 +596,29 @@ void handleNotifications()
     {
       if (applyEffects && currentPlaylist >= 0) unloadPlaylist();
       if (version > 10 && (receiveSegmentOptions || receiveSegmentBounds)) {
-        uint8_t numSrcSegs = udpIn[39];
-        for (size_t i = 0; i < numSrcSegs; i++) {
-          uint16_t ofs = 41 + i*udpIn[40]; //start of segment offset byte
-          uint8_t id = udpIn[0 +ofs];
-          if (id > strip.getSegmentsNum()) break;
-
-          Segment& selseg = strip.getSegment(id);
-          if (!selseg.isActive() || !selseg.isSelected()) continue; //do not apply to non selected segments
-
-          uint16_t startY = 0, start  = (udpIn[1+ofs] << 8 | udpIn[2+ofs]);
-          uint16_t stopY  = 1, stop   = (udpIn[3+ofs] << 8 | udpIn[4+ofs]);
-          uint16_t offset = (udpIn[7+ofs] << 8 | udpIn[8+ofs]);
-          if (!receiveSegmentOptions) {
-            selseg.setUp(start, stop, selseg.grouping, selseg.spacing, offset, startY, stopY);
-            continue;
-          }
-          //for (size_t j = 1; j<4; j++) selseg.setOption(j, (udpIn[9 +ofs] >> j) & 0x01); //only take into account mirrored, on, reversed; ignore selected
-          selseg.options = (selseg.options & 0x0071U) | (udpIn[9 +ofs] & 0x0E); // ignore selected, freeze, reset & transitional
-          selseg.setOpacity(udpIn[10+ofs]);
-          if (applyEffects) {
-            strip.setMode(id,  udpIn[11+ofs]);
-            selseg.speed     = udpIn[12+ofs];
-            selseg.intensity = udpIn[13+ofs];
-            selseg.palette   = udpIn[14+ofs];
-          }
-          if (receiveNotificationColor || !someSel) {
-            selseg.setColor(0, RGBW32(udpIn[15+ofs],udpIn[16+ofs],udpIn[17+ofs],udpIn[18+ofs]));
-            selseg.setColor(1, RGBW32(udpIn[19+ofs],udpIn[20+ofs],udpIn[21+ofs],udpIn[22+ofs]));
-            selseg.setColor(2, RGBW32(udpIn[23+ofs],udpIn[24+ofs],udpIn[25+ofs],udpIn[26+ofs]));
-            selseg.setCCT(udpIn[27+ofs]);
-          }
-          if (version > 11) {
-            // when applying synced options ignore selected as it may be used as indicator of which segments to sync
-            // freeze, reset should never be synced
-            // LSB to MSB: select, reverse, on, mirror, freeze, reset, reverse_y, mirror_y, transpose, map1d2d (3), ssim (2), set (2)
-            selseg.options = (selseg.options & 0b0000000000110001U) | (udpIn[28+ofs]<<8) | (udpIn[9 +ofs] & 0b11001110U); // ignore selected, freeze, reset
-            if (applyEffects) {
-              selseg.custom1 = udpIn[29+ofs];
-              selseg.custom2 = udpIn[30+ofs];
-              selseg.custom3 = udpIn[31+ofs] & 0x1F;
-              selseg.check1  = (udpIn[31+ofs]>>5) & 0x1;
-              selseg.check1  = (udpIn[31+ofs]>>6) & 0x1;
-              selseg.check1  = (udpIn[31+ofs]>>7) & 0x1;
-            }
-            startY = (udpIn[32+ofs] << 8 | udpIn[33+ofs]);
-            stopY  = (udpIn[34+ofs] << 8 | udpIn[35+ofs]);
+        bool applyColors = (receiveNotificationColor || !someSel);
+        if (version > 12 && udpIn[40] == 0) {
+          // v13 delta packet: records contain only bytes changed since the last full packet, the rest is taken from own segment (udp_delta.h)
+          uint8_t numRecs = (len > 41) ? udpIn[41] : 0;
+          size_t ofs = 42;
+          for (size_t i = 0; i < numRecs && ofs < len; i++) {
+            uint8_t id = udpIn[ofs];
+            uint64_t mask = 0;
+            byte rec[UDP_SEG_SIZE];
+            packSegment(rec, strip.getSegment(id), id);
+            size_t recLen = udpUnpackDelta(udpIn + ofs, len - ofs, rec, mask);
+            if (!recLen) break; // truncated
+            ofs += recLen;
+            if (id >= strip.getSegmentsNum()) continue;
+            applySegmentSync(rec, version, applyEffects, applyColors, mask);
           }
-          if (receiveSegmentBounds) {
-            selseg.setUp(start, stop, udpIn[5+ofs], udpIn[6+ofs], offset, startY, stopY);
-          } else {
-            selseg.setUp(selseg.start, selseg.stop, udpIn[5+ofs], udpIn[6+ofs], selseg.offset, selseg.startY, selseg.stopY);
+        } else {
+          uint8_t numSrcSegs = udpIn[39];
+          for (size_t i = 0; i < numSrcSegs; i++) {
+            uint16_t ofs = 41 + i*udpIn[40]; //start of segment offset byte
+            uint8_t id = udpIn[0 +ofs];
+            if (id > strip.getSegmentsNum()) break;
+            applySegmentSync(&udpIn[ofs], version, applyEffects, applyColors, UDP_SEG_ALL_FIELDS);
           }
         }
         stateChanged = true;
@@ -429,11 +638,17 @@ void handleNotifications()
       }
 
       if (applyEffects && version > 5) {
-        uint32_t t = (udpIn[25] << 24) | (udpIn[26] << 16) | (udpIn[27] << 8) | (udpIn[28]);
-        t += PRESUMED_NETWORK_DELAY; //adjust trivially for network delay
-        t -= millis();
-        strip.timebase = t;
-        timebaseUpdated = true;
+        IPAddress sender = isSupp ? notifier2Udp.remoteIP() : notifierUdp.remoteIP();
+        if (udpTimeSync && udp2Connected && sender == timeSyncPeer && peerClock.isValid()) {
+          // timebase is already following this node, it will be slewed by the estimator instead of stepped
+        } else {
+          uint32_t t = (udpIn[25] << 24) | (udpIn[26] << 16) | (udpIn[27] << 8) | (udpIn[28]);
+          t += PRESUMED_NETWORK_DELAY; //adjust trivially for network delay
+          t -= millis();
+          strip.timebase = t;
+          timebaseUpdated = true;
+          if (udpTimeSync && udp2Connected) followTimeSyncPeer(sender);
+        }
       }
     }
 
@@ -574,6 +789,12 @@ void handleNotifications()
     return;
   }
 
+  // binary control API over UDP
+  if (udpIn[0] == BINAPI_MAGIC) {
+    handleBinaryControl(udpIn, len);
+    return;
+  }
+
   // API over UDP
   udpIn[packetSize] = '\0';
 
@@ -721,6 +942,23 @@ void sendSysInfoUDP()
 // isRGBW - true if the buffer contains 4 components per pixel
 
 static       size_t sequenceNumber = 0; // this needs to be shared across all outputs
+#ifdef ARDUINO_ARCH_ESP32
+static portMUX_TYPE sequenceMux = portMUX_INITIALIZER_UNLOCKED; // outputs may be sent from other tasks (BusNetwork)
+#define SEQ_LOCK()   portENTER_CRITICAL(&sequenceMux)
+#define SEQ_UNLOCK() portEXIT_CRITICAL(&sequenceMux)
+#else
+#define SEQ_LOCK()
+#define SEQ_UNLOCK()
+#endif
+
+// fetch and increment, sequence numbers are 0..(wrap-1)
+static uint8_t nextSequenceNumber(size_t wrap) {
+  SEQ_LOCK();
+  if (sequenceNumber >= wrap) sequenceNumber = 0;
+  uint8_t seq = sequenceNumber++;
+  SEQ_UNLOCK();
+  return seq;
+}
 static const size_t ART_NET_HEADER_SIZE = 12;
 static const byte   ART_NET_HEADER[] PROGMEM = {0x41,0x72,0x74,0x2d,0x4e,0x65,0x74,0x00,0x00,0x50,0x00,0x0e};
 
@@ -742,8 +980,6 @@ uint8_t realtimeBroadcast(uint8_t type, IPAddress client, uint16_t length, uint8
       size_t bufferOffset = 0;
 
       for (size_t currentPacket = 0; currentPacket < packetCount; currentPacket++) {
-        if (sequenceNumber > 15) sequenceNumber = 0;
-
         if (!ddpUdp.beginPacket(client, DDP_DEFAULT_PORT)) {  // port defined in ESPAsyncE131.h
           DEBUG_PRINTLN(F("WiFiUDP.beginPacket returned an error"));
           return 1; // problem
@@ -764,7 +1000,7 @@ uint8_t realtimeBroadcast(uint8_t type, IPAddress client, uint16_t length, uint8
 
         // write the header
         /*0*/ddpUdp.write(flags);
-        /*1*/ddpUdp.write(sequenceNumber++ & 0x0F); // sequence may be unnecessary unless we are sending twice (as requested in Sync settings)
+        /*1*/ddpUdp.write(nextSequenceNumber(16)); // sequence may be unnecessary unless we are sending twice (as requested in Sync settings)
         /*2*/ddpUdp.write(isRGBW ?  DDP_TYPE_RGBW32 : DDP_TYPE_RGB24);
         /*3*/ddpUdp.write(DDP_ID_DISPLAY);
         // data offset in bytes, 32-bit number, MSB first
@@ -808,12 +1044,10 @@ uint8_t realtimeBroadcast(uint8_t type, IPAddress client, uint16_t length, uint8
       uint32_t channel = 0; 
       size_t bufferOffset = 0;
 
-      sequenceNumber++;
+      uint8_t artnetSequence = nextSequenceNumber(255) + 1; // same for all universes of a frame, 0 would disable sequencing
 
       for (size_t currentPacket = 0; currentPacket < packetCount; currentPacket++) {
 
-        if (sequenceNumber > 255) sequenceNumber = 0;
-
         if (!ddpUdp.beginPacket(client, ARTNET_DEFAULT_PORT)) {
           DEBUG_PRINTLN(F("Art-Net WiFiUDP.beginPacket returned an error"));
           return 1; // borked
@@ -831,7 +1065,7 @@ uint8_t realtimeBroadcast(uint8_t type, IPAddress client, uint16_t length, uint8
         byte header_buffer[ART_NET_HEADER_SIZE];
         memcpy_P(header_buffer, ART_NET_HEADER, ART_NET_HEADER_SIZE);
         ddpUdp.write(header_buffer, ART_NET_HEADER_SIZE); // This doesn't change. Hard coded ID, OpCode, and protocol version.
-        ddpUdp.write(sequenceNumber & 0xFF); // sequence number. 1..255
+        ddpUdp.write(artnetSequence); // sequence number. 1..255
         ddpUdp.write(0x00); // physical - more an FYI, not really used for anything. 0..3
         ddpUdp.write((currentPacket) & 0xFF); // Universe LSB. 1 full packet == 1 full universe, so just use current packet number.
         ddpUdp.write(0x00); // Universe MSB, unused.
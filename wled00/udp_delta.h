@@ -0,0 +1,56 @@
+#ifndef WLED_UDP_DELTA_H
+#define WLED_UDP_DELTA_H
+
+/*
+ * v13 notifier delta records (see notify() in udp.cpp)
+ * Record: segment ID, 40 bit change mask (LE, bit b set: byte b of the segment record follows), changed bytes
+ * The sender keeps the mask sticky until the next full packet: a delta carries every byte that differs or
+ * differed from the last full packet, so changes undone in the meantime and lost deltas are repaired.
+ * Encoding and decoding are free of Arduino calls so they can be run on the host.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define UDP_SEG_SIZE 36
+#define UDP_DELTA_HDR_SIZE 6 //v13 delta segment record header: segment id + 36 bit change mask
+#define UDP_SEG_ALL_FIELDS 0xFFFFFFFFFULL //change mask with all bytes of a segment record set
+
+// adds the bytes of rec that differ from base (record of the last full packet) to the sticky mask
+inline uint64_t udpDeltaMask(const uint8_t *rec, const uint8_t *base, uint64_t mask) {
+  for (size_t b = 1; b < UDP_SEG_SIZE; b++) if (rec[b] != base[b]) mask |= 1ULL << b;
+  return mask;
+}
+
+inline size_t udpDeltaSize(uint64_t mask) {
+  size_t len = UDP_DELTA_HDR_SIZE;
+  for (size_t b = 1; b < UDP_SEG_SIZE; b++) len += (mask >> b) & 0x01;
+  return len;
+}
+
+// writes the delta record of rec, returns its length
+inline size_t udpPackDelta(uint8_t *out, const uint8_t *rec, uint64_t mask) {
+  size_t len = 0;
+  out[len++] = rec[0];
+  for (size_t m = 0; m < 5; m++) out[len++] = (mask >> (8*m)) & 0xFF;
+  for (size_t b = 1; b < UDP_SEG_SIZE; b++) if ((mask >> b) & 0x01) out[len++] = rec[b];
+  return len;
+}
+
+// applies the delta record at in onto rec (the receiver's own segment record), returns its length
+// returns 0 if the record is truncated, rec is then incomplete and must not be applied
+inline size_t udpUnpackDelta(const uint8_t *in, size_t len, uint8_t *rec, uint64_t &mask) {
+  if (len < UDP_DELTA_HDR_SIZE) return 0;
+  mask = 0;
+  for (size_t m = 0; m < 5; m++) mask |= uint64_t(in[1+m]) << (8*m);
+  mask &= UDP_SEG_ALL_FIELDS & ~1ULL;
+  size_t ofs = UDP_DELTA_HDR_SIZE;
+  for (size_t b = 1; b < UDP_SEG_SIZE; b++) {
+    if (!((mask >> b) & 0x01)) continue;
+    if (ofs >= len) return 0;
+    rec[b] = in[ofs++];
+  }
+  return ofs;
+}
+
+#endif
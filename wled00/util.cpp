@@ -1,4 +1,5 @@
 #include "wled.h"
+#include "json_pool.h"
 #include "fcn_declare.h"
 #include "const.h"
 
@@ -198,36 +199,120 @@ bool isAsterisksOnly(const char* str, byte maxLen)
 
 
 //threading/network callback details: https://github.com/Aircoookie/WLED/pull/2336#discussion_r762276994
-bool requestJSONBufferLock(uint8_t module)
+// JSON document pool: slot 0 is the global "doc" (used via fileDoc by state/preset consumers),
+// additional documents are allocated at boot and handed out as JsonLease
+static JsonDocument* jsonPool[WLED_JSON_POOL_SIZE] = {&doc};
+static JsonPoolOwners<WLED_JSON_POOL_SIZE> jsonPoolOwners; // slot 0 owner mirrored in jsonBufferLock
+
+#ifdef ARDUINO_ARCH_ESP32
+static portMUX_TYPE jsonPoolMux = portMUX_INITIALIZER_UNLOCKED;
+#define JSONPOOL_LOCK()   portENTER_CRITICAL(&jsonPoolMux)
+#define JSONPOOL_UNLOCK() portEXIT_CRITICAL(&jsonPoolMux)
+#else
+#define JSONPOOL_LOCK()
+#define JSONPOOL_UNLOCK()
+#endif
+
+void initJsonPool()
 {
-  unsigned long now = millis();
+  #ifdef WLED_JSON_POOL_PSRAM_ONLY
+  if (!psramFound()) return; // would take JSON_BUFFER_SIZE of internal RAM per document
+  #endif
+  for (size_t i = 1; i < WLED_JSON_POOL_SIZE; i++) {
+    if (jsonPool[i]) continue;
+    jsonPool[i] = new PSRAMDynamicJsonDocument(JSON_BUFFER_SIZE);
+    if (jsonPool[i] && jsonPool[i]->capacity() == 0) { // allocation failed
+      delete jsonPool[i];
+      jsonPool[i] = nullptr;
+    }
+    JSONPOOL_LOCK();
+    jsonPoolOwners.setPresent(i, jsonPool[i] != nullptr);
+    JSONPOOL_UNLOCK();
+    DEBUG_PRINT(F("JSON pool document ")); DEBUG_PRINT(i); DEBUG_PRINTLN(jsonPool[i] ? F(" allocated.") : F(" failed!"));
+  }
+}
 
-  while (jsonBufferLock && millis()-now < 1000) delay(1); // wait for a second for buffer lock
+static int8_t claimJsonDocument(uint8_t module, uint8_t prio, bool primary)
+{
+  JSONPOOL_LOCK();
+  int8_t slot = jsonPoolOwners.claim(module, prio == JSON_PRIO_LOOP, primary);
+  if (slot == 0) jsonBufferLock = module;
+  JSONPOOL_UNLOCK();
+  return slot;
+}
 
-  if (millis()-now >= 1000) {
+// returns pool slot or -1, timeout 0 only tries once
+// loop consumers take precedence: while one is waiting, network callbacks (JSON_PRIO_NET) are not served
+int8_t acquireJsonDocument(uint8_t module, uint8_t prio, uint16_t timeout, bool primary)
+{
+  if (!module) module = 255;
+  unsigned long now = millis();
+  int8_t slot = claimJsonDocument(module, prio, primary);
+  if (slot < 0 && timeout) {
+    if (prio == JSON_PRIO_LOOP) { JSONPOOL_LOCK(); jsonPoolOwners.waitBegin(); JSONPOOL_UNLOCK(); }
+    while (slot < 0 && millis()-now < timeout) {
+      delay(1);
+      slot = claimJsonDocument(module, prio, primary);
+    }
+    if (prio == JSON_PRIO_LOOP) { JSONPOOL_LOCK(); jsonPoolOwners.waitEnd(); JSONPOOL_UNLOCK(); }
+  }
+  uint16_t waited = millis()-now;
+  if (waited > jsonLockWaitMax) jsonLockWaitMax = waited;
+
+  if (slot < 0) {
+    jsonLockFails++;
     DEBUG_PRINT(F("ERROR: Locking JSON buffer failed! ("));
-    DEBUG_PRINT(jsonBufferLock);
+    DEBUG_PRINT(module); DEBUG_PRINT('/'); DEBUG_PRINT(jsonBufferLock);
     DEBUG_PRINTLN(")");
-    return false; // waiting time-outed
+    return -1;
   }
-
-  jsonBufferLock = module ? module : 255;
   DEBUG_PRINT(F("JSON buffer locked. ("));
-  DEBUG_PRINT(jsonBufferLock);
+  DEBUG_PRINT(module); DEBUG_PRINT('@'); DEBUG_PRINT(slot);
   DEBUG_PRINTLN(")");
+  jsonPool[slot]->clear();
+  return slot;
+}
+
+void releaseJsonDocument(int8_t slot)
+{
+  if (slot < 0 || slot >= WLED_JSON_POOL_SIZE) return;
+  DEBUG_PRINT(F("JSON buffer released. ("));
+  DEBUG_PRINT(jsonPoolOwners.owner(slot)); DEBUG_PRINT('@'); DEBUG_PRINT(slot);
+  DEBUG_PRINTLN(")");
+  JSONPOOL_LOCK();
+  jsonPoolOwners.release(slot);
+  if (slot == 0) jsonBufferLock = 0;
+  JSONPOOL_UNLOCK();
+}
+
+JsonDocument* getJsonDocument(int8_t slot)
+{
+  return (slot < 0 || slot >= WLED_JSON_POOL_SIZE) ? nullptr : jsonPool[slot];
+}
+
+uint8_t getJsonPoolSize()
+{
+  return jsonPoolOwners.count(false);
+}
+
+uint8_t getJsonPoolFree()
+{
+  return jsonPoolOwners.count(true);
+}
+
+// locks the global "doc"
+bool requestJSONBufferLock(uint8_t module, uint8_t prio, uint16_t timeout)
+{
+  if (acquireJsonDocument(module, prio, timeout, true) < 0) return false;
   fileDoc = &doc;  // used for applying presets (presets.cpp)
-  doc.clear();
   return true;
 }
 
 
 void releaseJSONBufferLock()
 {
-  DEBUG_PRINT(F("JSON buffer released. ("));
-  DEBUG_PRINT(jsonBufferLock);
-  DEBUG_PRINTLN(")");
   fileDoc = nullptr;
-  jsonBufferLock = 0;
+  releaseJsonDocument(0);
 }
 
 
@@ -533,7 +618,7 @@ void enumerateLedmaps() {
   for (size_t i=1; i<WLED_MAX_LEDMAPS; i++) {
     char fileName[33];
     sprintf_P(fileName, PSTR("/ledmap%d.json"), i);
-    bool isFile = WLED_FS.exists(fileName);
+    bool isFile = fileExists(fileName);
 
     #ifndef ESP8266
     if (ledmapNames[i-1]) { //clear old name
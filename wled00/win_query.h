@@ -0,0 +1,75 @@
+#ifndef WLED_WIN_QUERY_H
+#define WLED_WIN_QUERY_H
+
+/*
+ * HTTP API (/win) request parser
+ * The query is split once into a key->value table instead of searching the whole request for every parameter.
+ * Keys are 1-3 characters packed into uint32_t (WK("FX")). Like the previous parser, value parameters
+ * need '=' (get(), has()), while flags (H2, IN, NN, ...) are found with or without one (flag()).
+ * Free of Arduino calls so request corpora can be replayed on the host.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <type_traits>
+
+constexpr uint32_t winKey(const char *k, int i = 0) { return (i < 3 && k[i]) ? (uint32_t(uint8_t(k[i])) << (8*i)) | winKey(k, i+1) : 0; }
+#define WK(k) std::integral_constant<uint32_t, winKey(k)>::value // evaluated at compile time, no string in RAM
+
+class WinQuery {
+  typedef struct {
+    uint32_t    key;
+    const char *val; // nullptr if there is no '='
+  } Param;
+
+  char    *_buf;
+  Param    *_p;
+  uint16_t  _n;
+
+  public:
+    WinQuery(const char *req) : _p(nullptr), _n(0) {
+      _buf = strdup(req);
+      char *tok = _buf ? strstr(_buf, "win") : nullptr;
+      if (!tok) return;
+      tok += 3; // parameters may follow "win" without separator
+      size_t maxParams = 1;
+      for (const char *c = tok; *c; c++) if (*c == '&') maxParams++;
+      _p = (Param*) malloc(maxParams * sizeof(Param)); // table for all parameters, none is ignored
+      if (!_p) return;
+      while (tok) {
+        char *next = strchr(tok, '&');
+        if (next) *next++ = '\0';
+        char *eq = strchr(tok, '=');
+        if (eq) *eq = '\0';
+        if (*tok && strlen(tok) <= 3) {
+          _p[_n].key = winKey(tok);
+          _p[_n].val = eq ? eq+1 : nullptr;
+          _n++;
+        }
+        tok = next;
+      }
+    }
+    ~WinQuery() { free(_p); free(_buf); }
+    WinQuery(const WinQuery&) = delete;
+    WinQuery& operator=(const WinQuery&) = delete;
+
+    inline bool valid() const { return _p != nullptr; }
+
+    // value of the first "key=" parameter
+    const char* get(uint32_t key) const {
+      for (size_t i = 0; i < _n; i++) if (_p[i].key == key && _p[i].val) return _p[i].val;
+      return nullptr;
+    }
+    inline bool has(uint32_t key)    const { return get(key) != nullptr; }
+    inline long getInt(uint32_t key) const { const char *v = get(key); return v ? atol(v) : 0; }
+    inline bool getBool(uint32_t key) const { const char *v = get(key); return v && v[0] != '0'; }
+
+    // flag parameter, with or without value
+    bool flag(uint32_t key) const {
+      for (size_t i = 0; i < _n; i++) if (_p[i].key == key) return true;
+      return false;
+    }
+};
+
+#endif
@@ -89,6 +89,9 @@ void WLED::loop()
     closeFile();
     yield();
   }
+  handlePresetsCompaction();
+  handlePresetsJournal();
+  handleDirIndex();
 
   #ifdef WLED_DEBUG
   stripMillis = millis();
@@ -118,12 +121,20 @@ void WLED::loop()
       delay(1); //required to make sure ESP enters modem sleep (see #1184)
     #endif
   }
+  #ifndef ARDUINO_ARCH_ESP32
+  BusNetwork::sendQueued(); // network bus frames are sent from sender task on ESP32
+  #endif
   #ifdef WLED_DEBUG
   stripMillis = millis() - stripMillis;
   avgStripMillis += stripMillis;
   if (stripMillis > maxStripMillis) maxStripMillis = stripMillis;
   #endif
 
+  if (!bootTime.reached(BOOT_DEFERRED)) { // boot initialization not needed for the first frames
+    enumerateLedmaps();
+    bootTime.mark(BOOT_DEFERRED, millis());
+  }
+
   yield();
 #ifdef ESP8266
   MDNS.update();
@@ -176,6 +187,7 @@ void WLED::loop()
       delete busConfigs[i]; busConfigs[i] = nullptr;
     }
     strip.finalizeInit(); // also loads default ledmap if present
+    enumerateLedmaps();   // not in finalizeInit(), deferred at boot
     if (aligned) strip.makeAutoSegments();
     else strip.fixInvalidSegments();
     doSerializeConfig = true;
@@ -185,7 +197,7 @@ void WLED::loop()
     loadLedmap = -1;
   }
   yield();
-  if (doSerializeConfig) serializeConfig();
+  handleSerializeConfig();
 
   yield();
   handleWs();
@@ -391,6 +403,8 @@ pinManager.allocateMultiplePins(pins, sizeof(pins)/sizeof(managed_pin_type), Pin
   pinManager.allocatePin(2, true, PinOwner::DMX);
 #endif
 
+  initJsonPool(); // allocate additional JSON documents (after PSRAM is available)
+
   DEBUG_PRINTLN(F("Registering usermods ..."));
   registerUsermods();
 
@@ -409,12 +423,24 @@ pinManager.allocateMultiplePins(pins, sizeof(pins)/sizeof(managed_pin_type), Pin
     DEBUGFS_PRINTLN(F("FS failed!"));
     errorFlag = ERR_FS_BEGIN;
   }
+  else {
+    restoreFile("/presets.tmp", "/presets.json"); // finish a compaction interrupted by reset
+    #ifdef WLED_USE_MSGPACK_FS
+    migrateToMsgPack();
+    #endif
+  }
 #ifdef WLED_ADD_EEPROM_SUPPORT
-  else deEEP();
+  if (fsinit) deEEP();
 #else
   initPresetsFile();
 #endif
+  if (fsinit) {
+    handleDirIndex();
+    initPresetJournal(); // replay saves not yet merged into presets.json
+    initPresetIndex();
+  }
   updateFSInfo();
+  bootTime.mark(BOOT_FS, millis());
 
   // generate module IDs must be done before AP setup
   escapedMac = WiFi.macAddress();
@@ -425,6 +451,7 @@ pinManager.allocateMultiplePins(pins, sizeof(pins)/sizeof(managed_pin_type), Pin
 
   DEBUG_PRINTLN(F("Reading config"));
   deserializeConfigFromFS();
+  bootTime.mark(BOOT_CFG, millis());
 
 #if defined(STATUSLED) && STATUSLED>=0
   if (!pinManager.isPinAllocated(STATUSLED)) {
@@ -436,11 +463,19 @@ pinManager.allocateMultiplePins(pins, sizeof(pins)/sizeof(managed_pin_type), Pin
 
   DEBUG_PRINTLN(F("Initializing strip"));
   beginStrip();
+  bootTime.mark(BOOT_STRIP, millis());
   DEBUG_PRINT(F("heap ")); DEBUG_PRINTLN(ESP.getFreeHeap());
 
+  // show boot preset before usermods and network are set up (ledmap names are enumerated in first loop)
+  handlePresets();
+  strip.service();
+  bootTime.mark(BOOT_FRAME, millis());
+
   DEBUG_PRINTLN(F("Usermods setup"));
   userSetup();
   usermods.setup();
+  if (bootPreset && presetToApply != bootPreset) applyPresetToUsermods(bootPreset); // usermods missed the boot preset
+  bootTime.mark(BOOT_USERMODS, millis());
   DEBUG_PRINT(F("heap ")); DEBUG_PRINTLN(ESP.getFreeHeap());
 
   if (strcmp(clientSSID, DEFAULT_CLIENT_SSID) == 0)
@@ -500,6 +535,8 @@ pinManager.allocateMultiplePins(pins, sizeof(pins)/sizeof(managed_pin_type), Pin
   DEBUG_PRINT(F("heap ")); DEBUG_PRINTLN(ESP.getFreeHeap());
 
   enableWatchdog();
+  bootTime.mark(BOOT_SETUP, millis());
+  DEBUG_PRINTF("Boot: FS %u, config %u, strip %u, first frame %u, setup %u ms\n", bootTime[BOOT_FS], bootTime[BOOT_CFG], bootTime[BOOT_STRIP], bootTime[BOOT_FRAME], bootTime[BOOT_SETUP]);
 
   #if defined(ARDUINO_ARCH_ESP32) && defined(WLED_DISABLE_BROWNOUT_DET)
   WRITE_PERI_REG(RTC_CNTL_BROWN_OUT_REG, 1); //enable brownout detector
@@ -819,6 +856,9 @@ void WLED::handleConnection()
     } else if (heap < MIN_HEAP_SIZE) {
       strip.purgeSegments();
     }
+    #ifdef WLED_PALETTE_LUT
+    if (heap < PALETTE_LUT_MIN_HEAP) Segment::freePaletteLUTs(heap < MIN_HEAP_SIZE); // palettes are still rendered without LUTs
+    #endif
     lastHeap = heap;
     heapTime = now;
   }
@@ -873,6 +913,7 @@ void WLED::handleConnection()
       initAP();
     }
   } else if (!interfacesInited) { //newly connected
+    bootTime.mark(BOOT_NETWORK, millis());
     DEBUG_PRINTLN("");
     DEBUG_PRINT(F("Connected! IP address: "));
     DEBUG_PRINTLN(Network.localIP());
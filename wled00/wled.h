@@ -176,6 +176,9 @@ using PSRAMDynamicJsonDocument = BasicJsonDocument<PSRAM_Allocator>;
 #include "const.h"
 #include "fcn_declare.h"
 #include "NodeStruct.h"
+#include "timesync.h"
+#include "boot_profile.h"
+#include "binapi.h"
 #include "pin_manager.h"
 #include "bus_manager.h"
 #include "FX.h"
@@ -363,6 +366,7 @@ WLED_GLOBAL char serverDescription[33] _INIT(SERVERNAME);  // use predefined nam
 WLED_GLOBAL bool syncToggleReceive     _INIT(false);   // UIs which only have a single button for sync should toggle send+receive if this is true, only send otherwise
 WLED_GLOBAL bool simplifiedUI          _INIT(false);   // enable simplified UI
 WLED_GLOBAL byte cacheInvalidate       _INIT(0);       // used to invalidate browser cache when switching from regular to simplified UI
+WLED_GLOBAL uint16_t cfgVersion        _INIT(0);       // incremented on each configuration change (invalidates cached settings JS)
 
 // Sync CONFIG
 WLED_GLOBAL NodesMap Nodes;
@@ -394,6 +398,8 @@ WLED_GLOBAL bool notifyAlexa  _INIT(false);                       // send notifi
 WLED_GLOBAL bool notifyMacro  _INIT(false);                       // send notification for macro
 WLED_GLOBAL bool notifyHue    _INIT(true);                        // send notification if Hue light changes
 WLED_GLOBAL uint8_t udpNumRetries _INIT(0);                       // Number of times a UDP sync message is retransmitted. Increase to increase reliability
+WLED_GLOBAL bool udpTimeSync _INIT(true);                         // estimate delay to the effect sync source via node port and slew timebase instead of stepping it
+WLED_GLOBAL bool udpSyncDelta _INIT(false);                       // send only segment data changed since last full notification (v13), saves airtime with many nodes
 
 WLED_GLOBAL bool alexaEnabled _INIT(false);                       // enable device discovery by Amazon Echo
 WLED_GLOBAL char alexaInvocationName[33] _INIT("Light");          // speech control name of device. Choose something voice-to-text can understand
@@ -579,6 +585,8 @@ WLED_GLOBAL bool stateChanged _INIT(false);
 
 // network
 WLED_GLOBAL bool udpConnected _INIT(false), udp2Connected _INIT(false), udpRgbConnected _INIT(false);
+WLED_GLOBAL IPAddress timeSyncPeer _INIT_N(((0, 0, 0, 0)));  // node whose effect clock (timebase) we follow
+WLED_GLOBAL PeerClock peerClock;
 
 // ui style
 WLED_GLOBAL bool showWelcomePage _INIT(false);
@@ -666,6 +674,11 @@ WLED_GLOBAL uint16_t olen _INIT(0);
 WLED_GLOBAL size_t fsBytesUsed _INIT(0);
 WLED_GLOBAL size_t fsBytesTotal _INIT(0);
 WLED_GLOBAL unsigned long presetsModifiedTime _INIT(0L);
+WLED_GLOBAL uint16_t cfgWriteCount _INIT(0);  // cfg.json writes since boot
+WLED_GLOBAL uint16_t cfgWriteTime _INIT(0);   // ms spent on the last cfg.json write
+
+// boot profiling
+WLED_GLOBAL BootProfile bootTime;  // end of each boot phase (BOOT_*) in ms
 WLED_GLOBAL JsonDocument* fileDoc;
 WLED_GLOBAL bool doCloseFile _INIT(false);
 
@@ -756,6 +769,8 @@ WLED_GLOBAL int8_t spi_sclk  _INIT(SPISCLKPIN);
 // global ArduinoJson buffer
 WLED_GLOBAL StaticJsonDocument<JSON_BUFFER_SIZE> doc;
 WLED_GLOBAL volatile uint8_t jsonBufferLock _INIT(0);
+WLED_GLOBAL uint16_t jsonLockWaitMax _INIT(0); // longest wait for a JSON document (ms)
+WLED_GLOBAL uint32_t jsonLockFails _INIT(0);   // JSON document requests which timed out
 
 // enable additional debug output
 #if defined(WLED_DEBUG_HOST)
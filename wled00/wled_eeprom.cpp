@@ -451,6 +451,7 @@ void deEEP() {
   }
   serializeJson(doc, f);
   f.close();
+  invalidateDirIndex();
 
   releaseJSONBufferLock();
 
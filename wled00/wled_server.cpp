@@ -18,8 +18,11 @@
  * Integrated HTTP web server page declarations
  */
 
-bool handleIfNoneMatchCacheHeader(AsyncWebServerRequest* request);
-void setStaticContentCacheHeaders(AsyncWebServerResponse *response);
+bool handleIfNoneMatchCacheHeader(AsyncWebServerRequest* request, const char* etag);
+void setStaticContentCacheHeaders(AsyncWebServerResponse *response, const char* etag);
+void serveStaticContent(AsyncWebServerRequest* request, int code, const char* contentType, const uint8_t* content, size_t len);
+
+#define JSON_MAX_BODY_SIZE 16384 // bytes, larger POST /json requests are not buffered and answered with 413
 
 // define flash strings once (saves flash memory)
 static const char s_redirecting[] PROGMEM = "Redirecting...";
@@ -50,15 +53,26 @@ void handleUpload(AsyncWebServerRequest *request, const String& filename, size_t
     }
 
     request->_tempFile = WLED_FS.open(finalname, "w");
+    invalidateDirIndex();
     DEBUG_PRINT(F("Uploading "));
     DEBUG_PRINTLN(finalname);
-    if (finalname.equals("/presets.json")) presetsModifiedTime = toki.second();
+    if (finalname.equals("/presets.json")) {
+      presetsModifiedTime = toki.second();
+      requestPresetJournalDiscard();
+      invalidatePresetIndex();
+      invalidatePresetCache();
+    }
   }
   if (len) {
     request->_tempFile.write(data,len);
   }
   if (final) {
     request->_tempFile.close();
+    invalidateDirIndex(); // indexes may have been rebuilt from the incomplete file
+    if (filename.indexOf(F("presets.json")) >= 0) {
+      invalidatePresetIndex();
+      invalidatePresetCache();
+    }
     if (filename.indexOf(F("cfg.json")) >= 0) { // check for filename with or without slash
       doReboot = true;
       request->send(200, "text/plain", F("Configuration restore successful.\nRebooting..."));
@@ -79,6 +93,24 @@ void createEditHandler(bool enable) {
       #else
       editHandler = &server.addHandler(new SPIFFSEditor("","",WLED_FS));//http_username,http_password));
       #endif
+      editHandler->setFilter([](AsyncWebServerRequest *request) { // called for any request until a handler matches
+        if (!request->url().startsWith(F("/edit"))) return true;
+        syncPresetJournal(); // editor shows and replaces presets.json
+        if (request->method() != HTTP_GET) { // files may be created or deleted, presets.json replaced
+          invalidateDirIndex();
+          invalidatePresetIndex();
+          invalidatePresetCache();
+          request->onDisconnect([request]() { // request is complete, uploaded file name or deleted path are known
+            invalidateDirIndex(); // may have been rebuilt before the editor created the file
+            invalidatePresetIndex();
+            invalidatePresetCache();
+            for (size_t i = 0; i < request->params(); i++) {
+              if (request->getParam(i)->value().endsWith(F("presets.json"))) requestPresetJournalDiscard();
+            }
+          });
+        }
+        return true;
+      });
     #else
       editHandler = &server.on(SET_F("/edit"), HTTP_GET, [](AsyncWebServerRequest *request){
         serveMessage(request, 501, "Not implemented", F("The FS editor is disabled in this build."), 254);
@@ -118,20 +150,12 @@ void initServer()
 #ifdef WLED_ENABLE_WEBSOCKETS
   #ifndef WLED_DISABLE_2D
   server.on(SET_F("/liveview2D"), HTTP_GET, [](AsyncWebServerRequest *request){
-    if (handleIfNoneMatchCacheHeader(request)) return;
-    AsyncWebServerResponse *response = request->beginResponse_P(200, "text/html", PAGE_liveviewws2D, PAGE_liveviewws2D_length);
-    response->addHeader(FPSTR(s_content_enc),"gzip");
-    setStaticContentCacheHeaders(response);
-    request->send(response);
+    serveStaticContent(request, 200, "text/html", PAGE_liveviewws2D, PAGE_liveviewws2D_length);
   });
   #endif
 #endif
   server.on(SET_F("/liveview"), HTTP_GET, [](AsyncWebServerRequest *request){
-    if (handleIfNoneMatchCacheHeader(request)) return;
-    AsyncWebServerResponse *response = request->beginResponse_P(200, "text/html", PAGE_liveview, PAGE_liveview_length);
-    response->addHeader(FPSTR(s_content_enc),"gzip");
-    setStaticContentCacheHeaders(response);
-    request->send(response);
+    serveStaticContent(request, 200, "text/html", PAGE_liveview, PAGE_liveview_length);
   });
 
   //settings page
@@ -142,11 +166,7 @@ void initServer()
   // "/settings/settings.js&p=x" request also handled by serveSettings()
 
   server.on(SET_F("/style.css"), HTTP_GET, [](AsyncWebServerRequest *request){
-    if (handleIfNoneMatchCacheHeader(request)) return;
-    AsyncWebServerResponse *response = request->beginResponse_P(200, "text/css", PAGE_settingsCss, PAGE_settingsCss_length);
-    response->addHeader(FPSTR(s_content_enc),"gzip");
-    setStaticContentCacheHeaders(response);
-    request->send(response);
+    serveStaticContent(request, 200, "text/css", PAGE_settingsCss, PAGE_settingsCss_length);
   });
 
   server.on(SET_F("/favicon.ico"), HTTP_GET, [](AsyncWebServerRequest *request){
@@ -177,7 +197,7 @@ void initServer()
     bool verboseResponse = false;
     bool isConfig = false;
 
-    if (!requestJSONBufferLock(14)) return;
+    if (!requestJSONBufferLock(14, JSON_PRIO_NET)) return;
 
     DeserializationError error = deserializeJson(doc, (uint8_t*)(request->_tempObject));
     JsonObject root = doc.as<JsonObject>();
@@ -220,6 +240,7 @@ void initServer()
     }
     request->send(200, "application/json", F("{\"success\":true}"));
   }, JSON_BUFFER_SIZE);
+  handler->setMaxContentLength(JSON_MAX_BODY_SIZE + 1); // limit is exclusive
   server.addHandler(handler);
 
   server.on(SET_F("/version"), HTTP_GET, [](AsyncWebServerRequest *request){
@@ -236,11 +257,7 @@ void initServer()
 
 #ifdef WLED_ENABLE_USERMOD_PAGE
   server.on("/u", HTTP_GET, [](AsyncWebServerRequest *request){
-    if (handleIfNoneMatchCacheHeader(request)) return;
-    AsyncWebServerResponse *response = request->beginResponse_P(200, "text/html", PAGE_usermod, PAGE_usermod_length);
-    response->addHeader(FPSTR(s_content_enc),"gzip");
-    setStaticContentCacheHeaders(response);
-    request->send(response);
+    serveStaticContent(request, 200, "text/html", PAGE_usermod, PAGE_usermod_length);
   });
 #endif
 
@@ -256,26 +273,16 @@ void initServer()
 #ifdef WLED_ENABLE_SIMPLE_UI
   server.on(SET_F("/simple.htm"), HTTP_GET, [](AsyncWebServerRequest *request){
     if (handleFileRead(request, "/simple.htm")) return;
-    if (handleIfNoneMatchCacheHeader(request)) return;
-    AsyncWebServerResponse *response = request->beginResponse_P(200, "text/html", PAGE_simple, PAGE_simple_L);
-    response->addHeader(FPSTR(s_content_enc),"gzip");
-    setStaticContentCacheHeaders(response);
-    request->send(response);
+    serveStaticContent(request, 200, "text/html", PAGE_simple, PAGE_simple_L);
   });
 #endif
 
   server.on(SET_F("/iro.js"), HTTP_GET, [](AsyncWebServerRequest *request){
-    AsyncWebServerResponse *response = request->beginResponse_P(200, "application/javascript", iroJs, iroJs_length);
-    response->addHeader(FPSTR(s_content_enc),"gzip");
-    setStaticContentCacheHeaders(response);
-    request->send(response);
+    serveStaticContent(request, 200, "application/javascript", iroJs, iroJs_length);
   });
 
   server.on(SET_F("/rangetouch.js"), HTTP_GET, [](AsyncWebServerRequest *request){
-    AsyncWebServerResponse *response = request->beginResponse_P(200, "application/javascript", rangetouchJs, rangetouchJs_length);
-    response->addHeader(FPSTR(s_content_enc),"gzip");
-    setStaticContentCacheHeaders(response);
-    request->send(response);
+    serveStaticContent(request, 200, "application/javascript", rangetouchJs, rangetouchJs_length);
   });
 
   createEditHandler(correctPIN);
@@ -356,32 +363,20 @@ void initServer()
   #ifdef WLED_ENABLE_PIXART
   server.on(SET_F("/pixart.htm"), HTTP_GET, [](AsyncWebServerRequest *request){
     if (handleFileRead(request, F("/pixart.htm"))) return;
-    if (handleIfNoneMatchCacheHeader(request)) return;
-    AsyncWebServerResponse *response = request->beginResponse_P(200, "text/html", PAGE_pixart, PAGE_pixart_L);
-    response->addHeader(FPSTR(s_content_enc),"gzip");
-    setStaticContentCacheHeaders(response);
-    request->send(response);
+    serveStaticContent(request, 200, "text/html", PAGE_pixart, PAGE_pixart_L);
   });
   #endif
 
   #ifndef WLED_DISABLE_PXMAGIC
   server.on(SET_F("/pxmagic.htm"), HTTP_GET, [](AsyncWebServerRequest *request){
     if (handleFileRead(request, F("/pxmagic.htm"))) return;
-    if (handleIfNoneMatchCacheHeader(request)) return;
-    AsyncWebServerResponse *response = request->beginResponse_P(200, "text/html", PAGE_pxmagic, PAGE_pxmagic_L);
-    response->addHeader(FPSTR(s_content_enc),"gzip");
-    setStaticContentCacheHeaders(response);
-    request->send(response);
+    serveStaticContent(request, 200, "text/html", PAGE_pxmagic, PAGE_pxmagic_L);
   });
   #endif
 
   server.on(SET_F("/cpal.htm"), HTTP_GET, [](AsyncWebServerRequest *request){
     if (handleFileRead(request, F("/cpal.htm"))) return;
-    if (handleIfNoneMatchCacheHeader(request)) return;
-    AsyncWebServerResponse *response = request->beginResponse_P(200, "text/html", PAGE_cpal, PAGE_cpal_L);
-    response->addHeader(FPSTR(s_content_enc),"gzip");
-    setStaticContentCacheHeaders(response);
-    request->send(response);
+    serveStaticContent(request, 200, "text/html", PAGE_cpal, PAGE_cpal_L);
   });
 
   #ifdef WLED_ENABLE_WEBSOCKETS
@@ -408,26 +403,22 @@ void initServer()
     if(espalexa.handleAlexaApiCall(request)) return;
     #endif
     if(handleFileRead(request, request->url())) return;
-    AsyncWebServerResponse *response = request->beginResponse_P(404, "text/html", PAGE_404, PAGE_404_length);
-    response->addHeader(FPSTR(s_content_enc),"gzip");
-    setStaticContentCacheHeaders(response);
-    request->send(response);
+    serveStaticContent(request, 404, "text/html", PAGE_404, PAGE_404_length);
   });
 }
 
-bool handleIfNoneMatchCacheHeader(AsyncWebServerRequest* request)
+bool handleIfNoneMatchCacheHeader(AsyncWebServerRequest* request, const char* etag)
 {
   AsyncWebHeader* header = request->getHeader("If-None-Match");
-  if (header && header->value() == String(VERSION)) {
+  if (header && header->value().equals(etag)) {
     request->send(304);
     return true;
   }
   return false;
 }
 
-void setStaticContentCacheHeaders(AsyncWebServerResponse *response)
+void setStaticContentCacheHeaders(AsyncWebServerResponse *response, const char* etag)
 {
-  char tmp[12];
   // https://medium.com/@codebyamir/a-web-developers-guide-to-browser-caching-cc41f3b73e7c
   #ifndef WLED_DEBUG
   //this header name is misleading, "no-cache" will not disable cache,
@@ -436,27 +427,43 @@ void setStaticContentCacheHeaders(AsyncWebServerResponse *response)
   #else
   response->addHeader(F("Cache-Control"),"no-store,max-age=0"); // prevent caching if debug build
   #endif
-  sprintf_P(tmp, PSTR("%8d-%02x"), VERSION, cacheInvalidate);
-  response->addHeader(F("ETag"), tmp);
+  response->addHeader(F("ETag"), etag);
+}
+
+// gzipped content ends with CRC32 of uncompressed data (and its size), a free content hash
+static uint32_t getContentHash(const uint8_t* content, size_t len)
+{
+  uint32_t crc = 0;
+  if (len < 18) return crc; // not a gzip stream
+  for (size_t i = 0; i < 4; i++) crc |= uint32_t(pgm_read_byte(content + len - 8 + i)) << (8*i);
+  return crc;
+}
+
+// streams gzipped PROGMEM content directly from flash
+// ETag is the content hash, so revalidation answers 304 until the firmware changes the content
+void serveStaticContent(AsyncWebServerRequest* request, int code, const char* contentType, const uint8_t* content, size_t len)
+{
+  char etag[14];
+  uint32_t hash = getContentHash(content, len);
+  sprintf_P(etag, PSTR("\"%08x%02x\""), (unsigned)hash, cacheInvalidate);
+  if (code == 200 && handleIfNoneMatchCacheHeader(request, etag)) return;
+
+  AsyncWebServerResponse *response = request->beginResponse_P(code, contentType, content, len);
+  response->addHeader(FPSTR(s_content_enc),"gzip");
+  setStaticContentCacheHeaders(response, etag);
+  request->send(response);
 }
 
 void serveIndex(AsyncWebServerRequest* request)
 {
   if (handleFileRead(request, F("/index.htm"))) return;
 
-  if (handleIfNoneMatchCacheHeader(request)) return;
-
-  AsyncWebServerResponse *response;
 #ifdef WLED_ENABLE_SIMPLE_UI
   if (simplifiedUI)
-    response = request->beginResponse_P(200, "text/html", PAGE_simple, PAGE_simple_L);
+    serveStaticContent(request, 200, "text/html", PAGE_simple, PAGE_simple_L);
   else
 #endif
-    response = request->beginResponse_P(200, "text/html", PAGE_index, PAGE_index_L);
-
-  response->addHeader(FPSTR(s_content_enc),"gzip");
-  setStaticContentCacheHeaders(response);
-  request->send(response);
+    serveStaticContent(request, 200, "text/html", PAGE_index, PAGE_index_L);
 }
 
 
@@ -527,6 +534,18 @@ String dmxProcessor(const String& var)
 #endif
 
 
+// settings JS of these subpages depends on configuration only
+#define SETTINGS_JS_CACHEABLE ((1<<SUBPAGE_MENU) | (1<<SUBPAGE_UI) | (1<<SUBPAGE_SEC) | (1<<SUBPAGE_DMX) | (1<<SUBPAGE_UPDATE) | (1<<SUBPAGE_2D))
+#ifdef ARDUINO_ARCH_ESP32
+  #define WLED_SETTINGS_JS_CACHE // generate once per configuration change (ESP8266 only answers revalidation)
+#endif
+
+static uint16_t settingsJSSalt = 0;
+#ifdef WLED_SETTINGS_JS_CACHE
+static String   settingsJSCache[SUBPAGE_2D+1];
+static uint16_t settingsJSCacheVersion[SUBPAGE_2D+1];
+#endif
+
 void serveSettingsJS(AsyncWebServerRequest* request)
 {
   char buf[SETTINGS_STACK_BUF_SIZE+37];
@@ -542,14 +561,40 @@ void serveSettingsJS(AsyncWebServerRequest* request)
     request->send(401, "application/javascript", buf);
     return;
   }
-  strcat_P(buf,PSTR("function GetV(){var d=document;"));
-  getSettingsJS(subPage, buf+strlen(buf));  // this may overflow by 35bytes!!!
-  strcat_P(buf,PSTR("}"));
-  
-  AsyncWebServerResponse *response;
-  response = request->beginResponse(200, "application/javascript", buf);
-  response->addHeader(F("Cache-Control"),"no-store");
-  response->addHeader(F("Expires"),"0");
+
+  // pages without runtime values (IP, time, power, status) only change with configuration
+  bool cacheable = (SETTINGS_JS_CACHEABLE >> subPage) & 1;
+  char etag[24];
+  if (cacheable) {
+    if (!settingsJSSalt) settingsJSSalt = random(1, 0xFFFF); // configuration may have been changed while powered off
+    sprintf_P(etag, PSTR("\"s%d-%04x-%04x\""), subPage, settingsJSSalt, cfgVersion);
+    if (handleIfNoneMatchCacheHeader(request, etag)) return;
+  }
+
+  AsyncWebServerResponse *response = nullptr;
+  #ifdef WLED_SETTINGS_JS_CACHE
+  if (cacheable && settingsJSCacheVersion[subPage] == cfgVersion && settingsJSCache[subPage].length())
+    response = request->beginResponse(200, "application/javascript", settingsJSCache[subPage]);
+  #endif
+  if (!response) {
+    strcat_P(buf,PSTR("function GetV(){var d=document;"));
+    getSettingsJS(subPage, buf+strlen(buf));  // this may overflow by 35bytes!!!
+    strcat_P(buf,PSTR("}"));
+    #ifdef WLED_SETTINGS_JS_CACHE
+    if (cacheable) {
+      settingsJSCache[subPage] = buf;
+      settingsJSCacheVersion[subPage] = cfgVersion;
+    }
+    #endif
+    response = request->beginResponse(200, "application/javascript", buf);
+  }
+  if (cacheable) {
+    response->addHeader(F("Cache-Control"),"no-cache"); // revalidate using ETag
+    response->addHeader(F("ETag"), etag);
+  } else {
+    response->addHeader(F("Cache-Control"),"no-store");
+    response->addHeader(F("Expires"),"0");
+  }
   request->send(response);
 }
 
@@ -621,22 +666,21 @@ void serveSettings(AsyncWebServerRequest* request, bool post)
     }
   }
 
-  AsyncWebServerResponse *response;
   switch (subPage)
   {
-    case SUBPAGE_WIFI    : response = request->beginResponse_P(200, "text/html", PAGE_settings_wifi, PAGE_settings_wifi_length); break;
-    case SUBPAGE_LEDS    : response = request->beginResponse_P(200, "text/html", PAGE_settings_leds, PAGE_settings_leds_length); break;
-    case SUBPAGE_UI      : response = request->beginResponse_P(200, "text/html", PAGE_settings_ui,   PAGE_settings_ui_length);   break;
-    case SUBPAGE_SYNC    : response = request->beginResponse_P(200, "text/html", PAGE_settings_sync, PAGE_settings_sync_length); break;
-    case SUBPAGE_TIME    : response = request->beginResponse_P(200, "text/html", PAGE_settings_time, PAGE_settings_time_length); break;
-    case SUBPAGE_SEC     : response = request->beginResponse_P(200, "text/html", PAGE_settings_sec,  PAGE_settings_sec_length);  break;
+    case SUBPAGE_WIFI    : serveStaticContent(request, 200, "text/html", PAGE_settings_wifi, PAGE_settings_wifi_length); break;
+    case SUBPAGE_LEDS    : serveStaticContent(request, 200, "text/html", PAGE_settings_leds, PAGE_settings_leds_length); break;
+    case SUBPAGE_UI      : serveStaticContent(request, 200, "text/html", PAGE_settings_ui,   PAGE_settings_ui_length);   break;
+    case SUBPAGE_SYNC    : serveStaticContent(request, 200, "text/html", PAGE_settings_sync, PAGE_settings_sync_length); break;
+    case SUBPAGE_TIME    : serveStaticContent(request, 200, "text/html", PAGE_settings_time, PAGE_settings_time_length); break;
+    case SUBPAGE_SEC     : serveStaticContent(request, 200, "text/html", PAGE_settings_sec,  PAGE_settings_sec_length);  break;
 #ifdef WLED_ENABLE_DMX
-    case SUBPAGE_DMX     : response = request->beginResponse_P(200, "text/html", PAGE_settings_dmx,  PAGE_settings_dmx_length);  break;
+    case SUBPAGE_DMX     : serveStaticContent(request, 200, "text/html", PAGE_settings_dmx,  PAGE_settings_dmx_length);  break;
 #endif
-    case SUBPAGE_UM      : response = request->beginResponse_P(200, "text/html", PAGE_settings_um,   PAGE_settings_um_length);   break;
-    case SUBPAGE_UPDATE  : response = request->beginResponse_P(200, "text/html", PAGE_update,        PAGE_update_length);        break;
+    case SUBPAGE_UM      : serveStaticContent(request, 200, "text/html", PAGE_settings_um,   PAGE_settings_um_length);   break;
+    case SUBPAGE_UPDATE  : serveStaticContent(request, 200, "text/html", PAGE_update,        PAGE_update_length);        break;
 #ifndef WLED_DISABLE_2D
-    case SUBPAGE_2D      : response = request->beginResponse_P(200, "text/html", PAGE_settings_2D,   PAGE_settings_2D_length);   break;
+    case SUBPAGE_2D      : serveStaticContent(request, 200, "text/html", PAGE_settings_2D,   PAGE_settings_2D_length);   break;
 #endif
     case SUBPAGE_LOCK    : {
       correctPIN = !strlen(settingsPIN); // lock if a pin is set
@@ -644,13 +688,10 @@ void serveSettings(AsyncWebServerRequest* request, bool post)
       serveMessage(request, 200, strlen(settingsPIN) > 0 ? PSTR("Settings locked") : PSTR("No PIN set"), FPSTR(s_redirecting), 1);
       return;
     }
-    case SUBPAGE_PINREQ  : response = request->beginResponse_P(401, "text/html", PAGE_settings_pin,  PAGE_settings_pin_length);  break;
-    case SUBPAGE_CSS     : response = request->beginResponse_P(200, "text/css",  PAGE_settingsCss,   PAGE_settingsCss_length);   break;
+    case SUBPAGE_PINREQ  : serveStaticContent(request, 401, "text/html", PAGE_settings_pin,  PAGE_settings_pin_length);  break;
+    case SUBPAGE_CSS     : serveStaticContent(request, 200, "text/css",  PAGE_settingsCss,   PAGE_settingsCss_length);   break;
     case SUBPAGE_JS      : serveSettingsJS(request); return;
-    case SUBPAGE_WELCOME : response = request->beginResponse_P(200, "text/html", PAGE_welcome,       PAGE_welcome_length);       break;
-    default:  response = request->beginResponse_P(200, "text/html", PAGE_settings,      PAGE_settings_length);      break;
+    case SUBPAGE_WELCOME : serveStaticContent(request, 200, "text/html", PAGE_welcome,       PAGE_welcome_length);       break;
+    default:  serveStaticContent(request, 200, "text/html", PAGE_settings,      PAGE_settings_length);      break;
   }
-  response->addHeader(FPSTR(s_content_enc),"gzip");
-  setStaticContentCacheHeaders(response);
-  request->send(response);
 }
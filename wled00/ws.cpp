@@ -1,25 +1,237 @@
 #include "wled.h"
+#include "ws_delta.h"
+#include "live_enc.h"
 
 /*
  * WebSockets server for bidirectional communication
  */
 #ifdef WLED_ENABLE_WEBSOCKETS
 
-uint16_t wsLiveClientId = 0;
-unsigned long wsLastLiveTime = 0;
-//uint8_t* wsFrameBuffer = nullptr;
+unsigned long wsLastCleanupTime = 0;
 
-#define WS_LIVE_INTERVAL 40
+// reassembly of messages split into multiple frames/packets (large presets, playlists, per-LED "i" arrays)
+#define WS_MAX_REASSEMBLY 2 // clients which may send a fragmented message at the same time
+#ifdef ESP8266
+  #define WS_MAX_MESSAGE_SIZE 8192
+#else
+  #define WS_MAX_MESSAGE_SIZE 16384
+#endif
+#define WS_REASSEMBLY_TIMEOUT 3000
+
+typedef struct {
+  uint32_t id;     // WS client id, 0 = free slot
+  uint8_t *buf;
+  size_t   len;    // bytes received
+  size_t   size;   // bytes allocated
+  unsigned long start;
+  bool     discard; // message too large or out of memory, remaining fragments are dropped
+} WsReassembly;
+
+static WsReassembly wsReassembly[WS_MAX_REASSEMBLY] = {{0, nullptr, 0, 0, 0, false}};
+
+/*
+ * Binary live view
+ * {"lv":true} legacy subscription: version 1 (1D) / 2 (2D) frames, RGB888 decimated to 256/1024 LEDs
+ * {"lv":{"fps":25,"enc":2}} version 3 frames: 'L',3,enc,step,width(LE16),height(LE16),payload
+ *   enc 0: RGB888, 1: RGB565 (LE16), 2: RLE of RGB565 ([count,LE16]...), 3: palette + RLE
+ *   ([ncolors (0=256)],[LE16 colors...],[count,index]...), falls back to 2 if there are more than 256 colors
+ *   step: sampling step (every step-th pixel, or step*step block in 2D) when there are more than WS_LIVE_MAX_PIXELS
+ * {"lv":false} unsubscribes. Each encoding is built once per frame and shared by all subscribers using it,
+ * clients which did not consume the previous frame yet skip frames (back-pressure).
+ */
+#define WS_LIVE_INTERVAL    40 // default/legacy frame interval (ms)
+#define WS_MAX_LIVE_CLIENTS 4
+#ifdef ESP8266
+  #define WS_LIVE_MAX_PIXELS 1024
+#else
+  #define WS_LIVE_MAX_PIXELS 8192
+#endif
+
+typedef struct {
+  uint32_t id;       // WS client id, 0 = free slot
+  uint16_t interval; // ms between frames
+  uint8_t  enc;      // LIVE_ENC_*
+  unsigned long lastSent;
+} LiveClient;
+
+static LiveClient wsLiveClients[WS_MAX_LIVE_CLIENTS] = {{0, 0, 0, 0}};
+static uint16_t  liveW = 0, liveH = 0, liveStep = 1; // sampled frame dimensions
+static uint16_t *liveScratch = nullptr;              // RGB565 copy of sampled frame
+static size_t    liveScratchSize = 0;
+static LivePalette livePal;                         // colors of sampled frame for LIVE_ENC_PALRLE
+
+static void setLiveClient(uint32_t id, JsonVariant lv);
+
+/*
+ * Delta state push (opt-in per client)
+ * {"dlt":true} subscribes (and resyncs), {"dlt":false} unsubscribes.
+ * Subscriber receives a full snapshot {"state":{..},"info":{..},"seq":n}, then only
+ * {"seq":n+1,"delta":true,"state":{changed keys,"seg":[changed segments]}} (removed key: "key":null,
+ * removed segment: {"id":x,"stop":0}).
+ * A gap in "seq" means a delta was lost and the client should resubscribe. Messages without "seq" are full state.
+ * Info is pushed separately every WS_DELTA_INFO_INTERVAL ms as {"info":{..}}.
+ */
+#define WS_MAX_TRACKED_CLIENTS 8
+#define WS_DELTA_INFO_INTERVAL 5000
+
+static uint32_t wsClientIds[WS_MAX_TRACKED_CLIENTS]   = {0};     // connected clients (0 = free slot)
+static bool     wsDeltaClient[WS_MAX_TRACKED_CLIENTS] = {false}; // client subscribed to delta push
+static uint32_t wsDeltaSeq = 0;
+static unsigned long wsDeltaInfoTime = 0;
+static WsDeltaState<MAX_NUM_SEGMENTS> wsDeltaState; // state known to all delta subscribers (last delta or full broadcast)
+static volatile bool wsDeltaResync = false;         // set when a single subscriber was sent a snapshot
+
+static int8_t wsFindClient(uint32_t id)
+{
+  for (size_t i = 0; i < WS_MAX_TRACKED_CLIENTS; i++) if (wsClientIds[i] == id) return i;
+  return -1;
+}
+
+static void wsTrackClient(uint32_t id, bool connected)
+{
+  int8_t i = wsFindClient(connected ? 0 : id);
+  if (i < 0) return; // untracked client (only gets full state broadcasts)
+  wsClientIds[i]   = connected ? id : 0;
+  wsDeltaClient[i] = false;
+}
+
+static uint8_t wsTrackedClients(bool deltaOnly)
+{
+  uint8_t n = 0;
+  for (size_t i = 0; i < WS_MAX_TRACKED_CLIENTS; i++) if (wsClientIds[i] && (!deltaOnly || wsDeltaClient[i])) n++;
+  return n;
+}
+
+// removes state keys and segments which did not change since the last delta push, returns false if nothing is left
+static bool reduceToDelta(JsonObject state)
+{
+  if (wsDeltaResync) { // a subscriber got a snapshot and may be ahead of the others, resend everything
+    wsDeltaResync = false;
+    wsDeltaState.invalidate();
+  }
+  return wsDeltaState.reduce(state);
+}
+
+// applies JSON message (complete, single frame or reassembled)
+static void handleWsJson(AsyncWebSocketClient * client, uint8_t *data, size_t len)
+{
+  bool verboseResponse = false;
+  bool deltaSync = false;
+  if (!requestJSONBufferLock(11, JSON_PRIO_NET)) return;
+
+  DeserializationError error = deserializeJson(doc, data, len);
+  JsonObject root = doc.as<JsonObject>();
+  if (error || root.isNull()) {
+    releaseJSONBufferLock();
+    return;
+  }
+  if (root["v"] && root.size() == 1) {
+    //if the received value is just "{"v":true}", send only to this client
+    verboseResponse = true;
+  } else if (root.containsKey("lv")) {
+    setLiveClient(client->id(), root["lv"]);
+  } else if (root.containsKey(F("dlt"))) {
+    int8_t i = wsFindClient(client->id());
+    if (i >= 0) wsDeltaClient[i] = root[F("dlt")];
+    deltaSync = true; // (re)send snapshot
+  } else {
+    verboseResponse = deserializeState(root);
+  }
+  releaseJSONBufferLock(); // will clean fileDoc
+
+  if (deltaSync) {
+    sendDataWs(client);
+    return;
+  }
+  if (!interfaceUpdateCallMode) { // individual client response only needed if no WS broadcast soon
+    if (verboseResponse) {
+      sendDataWs(client);
+    } else {
+      // we have to send something back otherwise WS connection closes
+      client->text(F("{\"success\":true}"));
+    }
+    // force broadcast in 500ms after updating client
+    //lastInterfaceUpdate = millis() - (INTERFACE_UPDATE_COOLDOWN -500); // ESP8266 does not like this
+  }
+}
+
+static void freeReassembly(WsReassembly &r)
+{
+  if (r.buf) free(r.buf);
+  r.buf  = nullptr;
+  r.id   = 0;
+  r.len  = 0;
+  r.size = 0;
+  r.discard = false;
+}
+
+// collects fragments of a text message, applies it once complete
+static void handleWsFragment(AsyncWebSocketClient * client, AwsFrameInfo * info, uint8_t *data, size_t len)
+{
+  if (info->message_opcode != WS_TEXT) return;
+  unsigned long now = millis();
+  WsReassembly *r = nullptr;
+  for (size_t i = 0; i < WS_MAX_REASSEMBLY; i++) {
+    if (wsReassembly[i].id && now - wsReassembly[i].start > WS_REASSEMBLY_TIMEOUT) freeReassembly(wsReassembly[i]); // abandoned
+    if (wsReassembly[i].id == client->id()) r = &wsReassembly[i];
+  }
+  bool first = (info->num == 0 && info->index == 0);
+  if (first) {
+    if (r) freeReassembly(*r); // previous message was never completed
+    for (size_t i = 0; !r && i < WS_MAX_REASSEMBLY; i++) if (!wsReassembly[i].id) r = &wsReassembly[i];
+    if (!r) {
+      DEBUG_PRINTLN(F("WS reassembly busy."));
+      if (info->final && info->index + len == info->len) client->text(F("{\"error\":3}"));
+      return;
+    }
+    r->id    = client->id();
+    r->start = now;
+  }
+  if (!r) return; // first fragment was rejected
+
+  // frame length is known at its start, grow buffer once per frame (+1 for terminating null)
+  if (!r->discard && info->index == 0 && r->len + info->len + 1 > r->size) {
+    size_t newSize = r->len + info->len + 1;
+    uint8_t *newBuf = (newSize <= WS_MAX_MESSAGE_SIZE+1) ? (uint8_t*) realloc(r->buf, newSize) : nullptr;
+    if (newBuf) {
+      r->buf  = newBuf;
+      r->size = newSize;
+    } else {
+      DEBUG_PRINTLN(F("WS message too large."));
+      r->discard = true;
+    }
+  }
+  if (!r->discard) {
+    if (r->len + len < r->size) {
+      memcpy(r->buf + r->len, data, len);
+      r->len += len;
+    } else
+      r->discard = true; // data beyond announced frame length
+  }
+
+  if (!info->final || info->index + len != info->len) return; // more to come
+  if (!r->discard) {
+    r->buf[r->len] = 0;
+    DEBUG_PRINT(F("WS reassembled message: ")); DEBUG_PRINTLN(r->len);
+    handleWsJson(client, r->buf, r->len);
+  } else {
+    client->text(F("{\"error\":9}")); // ERR_JSON, message was too large
+  }
+  freeReassembly(*r);
+}
 
 void wsEvent(AsyncWebSocket * server, AsyncWebSocketClient * client, AwsEventType type, void * arg, uint8_t *data, size_t len)
 {
   if(type == WS_EVT_CONNECT){
     //client connected
     DEBUG_PRINTLN(F("WS client connected."));
+    wsTrackClient(client->id(), true);
     sendDataWs(client);
   } else if(type == WS_EVT_DISCONNECT){
     //client disconnected
-    if (client->id() == wsLiveClientId) wsLiveClientId = 0;
+    setLiveClient(client->id(), JsonVariant());
+    for (size_t i = 0; i < WS_MAX_REASSEMBLY; i++) if (wsReassembly[i].id == client->id()) freeReassembly(wsReassembly[i]);
+    wsTrackClient(client->id(), false);
     DEBUG_PRINTLN(F("WS client disconnected."));
   } else if(type == WS_EVT_DATA){
     // data packet
@@ -35,55 +247,24 @@ void wsEvent(AsyncWebSocket * server, AsyncWebSocketClient * client, AwsEventTyp
           return;
         }
 
-        bool verboseResponse = false;
-        if (!requestJSONBufferLock(11)) return;
-
-        DeserializationError error = deserializeJson(doc, data, len);
-        JsonObject root = doc.as<JsonObject>();
-        if (error || root.isNull()) {
+        handleWsJson(client, data, len);
+      } else if (info->opcode == WS_BINARY && len > 0 && data[0] == BINAPI_MAGIC) {
+        uint8_t err = BINAPI_ERR_BUSY;
+        if (requestJSONBufferLock(24, JSON_PRIO_NET)) { // serializes state changes with JSON commands and presets applied in loop()
+          err = handleBinaryControl(data, len);
           releaseJSONBufferLock();
-          return;
         }
-        if (root["v"] && root.size() == 1) {
-          //if the received value is just "{"v":true}", send only to this client
-          verboseResponse = true;
-        } else if (root.containsKey("lv")) {
-          wsLiveClientId = root["lv"] ? client->id() : 0;
-        } else {
-          verboseResponse = deserializeState(root);
-        }
-        releaseJSONBufferLock(); // will clean fileDoc
-
-        if (!interfaceUpdateCallMode) { // individual client response only needed if no WS broadcast soon
-          if (verboseResponse) {
-            sendDataWs(client);
-          } else {
-            // we have to send something back otherwise WS connection closes
-            client->text(F("{\"success\":true}"));
-          }
-          // force broadcast in 500ms after updating client
-          //lastInterfaceUpdate = millis() - (INTERFACE_UPDATE_COOLDOWN -500); // ESP8266 does not like this
+        if (err == BINAPI_OK && (data[2] & BINAPI_F_STATE)) {
+          sendDataWs(client);
+        } else if (err != BINAPI_OK || !interfaceUpdateCallMode) { // something has to be sent back otherwise WS connection closes
+          uint8_t ack[] = {BINAPI_MAGIC, BINAPI_VERSION, err};
+          client->binary((const uint8_t*)ack, sizeof(ack));
         }
       }
     } else {
       //message is comprised of multiple frames or the frame is split into multiple packets
-      //if(info->index == 0){
-        //if (!wsFrameBuffer && len < 4096) wsFrameBuffer = new uint8_t[4096];
-      //}
-
-      //if (wsFrameBuffer && len < 4096 && info->index + info->)
-      //{
-
-      //}
-
-      if((info->index + len) == info->len){
-        if(info->final){
-          if(info->message_opcode == WS_TEXT) {
-            client->text(F("{\"error\":9}")); // ERR_JSON we do not handle split packets right now
-          }
-        }
-      }
       DEBUG_PRINTLN(F("WS multipart message."));
+      handleWsFragment(client, info, data, len);
     }
   } else if(type == WS_EVT_ERROR){
     //error was received from the other end
@@ -96,30 +277,21 @@ void wsEvent(AsyncWebSocket * server, AsyncWebSocketClient * client, AwsEventTyp
   }
 }
 
-void sendDataWs(AsyncWebSocketClient * client)
+// serializes document into a new (locked) WS message buffer, nullptr if out of memory
+static AsyncWebSocketMessageBuffer* makeWsBuffer(JsonDocument &wsDoc)
 {
-  if (!ws.count()) return;
-  AsyncWebSocketMessageBuffer * buffer;
-
-  if (!requestJSONBufferLock(12)) return;
-
-  JsonObject state = doc.createNestedObject("state");
-  serializeState(state);
-  JsonObject info  = doc.createNestedObject("info");
-  serializeInfo(info);
-
-  size_t len = measureJson(doc);
-  DEBUG_PRINTF("JSON buffer size: %u for WS request (%u).\n", doc.memoryUsage(), len);
+  size_t len = measureJson(wsDoc);
+  DEBUG_PRINTF("JSON buffer size: %u for WS request (%u).\n", wsDoc.memoryUsage(), len);
 
   size_t heap1 = ESP.getFreeHeap();
   DEBUG_PRINT(F("heap ")); DEBUG_PRINTLN(ESP.getFreeHeap());
   #ifdef ESP8266
   if (len>heap1) {
     DEBUG_PRINTLN(F("Out of memory (WS)!"));
-    return;
+    return nullptr;
   }
   #endif
-  buffer = ws.makeBuffer(len); // will not allocate correct memory sometimes on ESP8266
+  AsyncWebSocketMessageBuffer * buffer = ws.makeBuffer(len); // will not allocate correct memory sometimes on ESP8266
   #ifdef ESP8266
   size_t heap2 = ESP.getFreeHeap();
   DEBUG_PRINT(F("heap ")); DEBUG_PRINTLN(ESP.getFreeHeap());
@@ -127,36 +299,100 @@ void sendDataWs(AsyncWebSocketClient * client)
   size_t heap2 = 0; // ESP32 variants do not have the same issue and will work without checking heap allocation
   #endif
   if (!buffer || heap1-heap2<len) {
-    releaseJSONBufferLock();
     DEBUG_PRINTLN(F("WS buffer allocation failed."));
+    return nullptr;
+  }
+
+  buffer->lock();
+  serializeJson(wsDoc, (char *)buffer->get(), len);
+  return buffer;
+}
+
+static void sendToTrackedWs(AsyncWebSocketMessageBuffer * buffer, bool delta)
+{
+  for (size_t i = 0; i < WS_MAX_TRACKED_CLIENTS; i++) {
+    if (!wsClientIds[i] || wsDeltaClient[i] != delta) continue;
+    AsyncWebSocketClient * c = ws.client(wsClientIds[i]);
+    if (c) c->text(buffer);
+  }
+}
+
+void sendDataWs(AsyncWebSocketClient * client)
+{
+  if (!ws.count()) return;
+  AsyncWebSocketMessageBuffer * buffer;
+
+  JsonLease lease(12, JSON_PRIO_NET); // read-only, any pooled document will do
+  if (!lease) return;
+  JsonDocument &wsDoc = *lease;
+
+  JsonObject state = wsDoc.createNestedObject("state");
+  serializeState(state);
+  JsonObject info  = wsDoc.createNestedObject("info");
+  serializeInfo(info);
+
+  int8_t slot = client ? wsFindClient(client->id()) : -1;
+  if (slot >= 0 && wsDeltaClient[slot]) wsDoc["seq"] = wsDeltaSeq; // snapshot, following deltas continue from here
+  // deltas can only be pushed if full state clients can be addressed individually
+  bool deltaPush = !client && wsTrackedClients(true) && wsTrackedClients(false) == ws.count();
+
+  buffer = makeWsBuffer(wsDoc);
+  if (!buffer) {
+    lease.release();
     ws.closeAll(1013); //code 1013 = temporary overload, try again later
     ws.cleanupClients(0); //disconnect all clients to release memory
     ws._cleanBuffers();
     return; //out of memory
   }
 
-  buffer->lock();
-  serializeJson(doc, (char *)buffer->get(), len);
-
   DEBUG_PRINT(F("Sending WS data "));
   if (client) {
     client->text(buffer);
     DEBUG_PRINTLN(F("to a single client."));
-  } else {
+  } else if (!deltaPush) {
     ws.textAll(buffer);
     DEBUG_PRINTLN(F("to multiple clients."));
+  } else {
+    sendToTrackedWs(buffer, false);
+    DEBUG_PRINTLN(F("to full state clients."));
   }
   buffer->unlock();
   ws._cleanBuffers();
+  if (!deltaPush) {
+    if (slot >= 0 && wsDeltaClient[slot]) wsDeltaResync = true;       // subscriber may be ahead of the others
+    else if (!client && wsTrackedClients(true)) reduceToDelta(state); // everybody has this state now
+    return;
+  }
 
-  releaseJSONBufferLock();
+  // delta subscribers: only changed state, info is pushed on its own cadence (handleWs())
+  wsDoc.remove("info");
+  if (!reduceToDelta(state)) return; // nothing changed
+  wsDoc["seq"] = ++wsDeltaSeq; // incremented even if sending fails so clients notice the gap
+  wsDoc[F("delta")] = true;
+  buffer = makeWsBuffer(wsDoc);
+  if (!buffer) return;
+  sendToTrackedWs(buffer, true);
+  DEBUG_PRINTF("WS delta %u sent.\n", wsDeltaSeq);
+  buffer->unlock();
+  ws._cleanBuffers();
 }
 
-bool sendLiveLedsWs(uint32_t wsClient)
+static void sendDeltaInfoWs()
 {
-  AsyncWebSocketClient * wsc = ws.client(wsClient);
-  if (!wsc || wsc->queueLength() > 0) return false; //only send if queue free
+  JsonLease lease(12, JSON_PRIO_NET, 0); // called from loop, do not wait
+  if (!lease) return;
+  JsonObject info = lease->createNestedObject("info");
+  serializeInfo(info);
+  AsyncWebSocketMessageBuffer * buffer = makeWsBuffer(*lease);
+  if (!buffer) return;
+  sendToTrackedWs(buffer, true);
+  buffer->unlock();
+  ws._cleanBuffers();
+}
 
+// version 1/2 frame for {"lv":true} subscribers
+static AsyncWebSocketMessageBuffer* makeLegacyLiveBuffer()
+{
   size_t used = strip.getLengthTotal();
 #ifdef ESP8266
   const size_t MAX_LIVE_LEDS_WS = 256U;
@@ -168,7 +404,7 @@ bool sendLiveLedsWs(uint32_t wsClient)
   size_t bufSize = pos + (used/n)*3;
 
   AsyncWebSocketMessageBuffer * wsBuf = ws.makeBuffer(bufSize);
-  if (!wsBuf) return false; //out of memory
+  if (!wsBuf) return nullptr; //out of memory
   uint8_t* buffer = wsBuf->get();
   buffer[0] = 'L';
   buffer[1] = 1; //version
@@ -208,23 +444,142 @@ bool sendLiveLedsWs(uint32_t wsClient)
     buffer[pos++] = scale8(qadd8(w, b), strip.getBrightness()); //B
   }
 
-  wsc->binary(wsBuf);
+  return wsBuf;
+}
+
+static void setLiveClient(uint32_t id, JsonVariant lv)
+{
+  LiveClient *lc = nullptr;
+  for (size_t i = 0; i < WS_MAX_LIVE_CLIENTS; i++) if (wsLiveClients[i].id == id) { lc = &wsLiveClients[i]; break; }
+  if (!lc) for (size_t i = 0; i < WS_MAX_LIVE_CLIENTS; i++) if (!wsLiveClients[i].id) { lc = &wsLiveClients[i]; break; }
+  if (!lc) return; // too many subscribers
+
+  if (lv.is<JsonObject>()) {
+    uint8_t fps  = constrain((int)(lv[F("fps")] | 25), 1, 50);
+    lc->enc      = lv[F("enc")] | LIVE_ENC_RGB888;
+    if (lc->enc >= LIVE_ENC_LEGACY) lc->enc = LIVE_ENC_RGB888;
+    lc->interval = 1000 / fps;
+  } else if (lv.as<bool>()) {
+    lc->enc      = LIVE_ENC_LEGACY;
+    lc->interval = WS_LIVE_INTERVAL;
+  } else {
+    lc->id = 0;
+    return;
+  }
+  lc->id       = id;
+  lc->lastSent = 0;
+}
+
+// determine sampled frame size, full resolution up to WS_LIVE_MAX_PIXELS
+static void setupLiveSampling()
+{
+  #ifndef WLED_DISABLE_2D
+  bool matrix = strip.isMatrix;
+  #else
+  bool matrix = false;
+  #endif
+  liveSampling(matrix, Segment::maxWidth, Segment::maxHeight, strip.getLengthTotal(), WS_LIVE_MAX_PIXELS, liveStep, liveW, liveH);
+}
+
+// i-th sampled pixel as shown (brightness applied, white added to RGB)
+static uint32_t getLivePixel(size_t i)
+{
+  uint32_t c = strip.getPixelColor(livePixelIndex(i, liveW, liveH, liveStep, Segment::maxWidth));
+  uint8_t w = W(c);
+  return RGBW32(scale8(qadd8(w, R(c)), strip.getBrightness()),
+                scale8(qadd8(w, G(c)), strip.getBrightness()),
+                scale8(qadd8(w, B(c)), strip.getBrightness()), 0);
+}
+
+// version 3 frame, scratch must be valid for RGB565 based encodings
+static AsyncWebSocketMessageBuffer* makeLiveBuffer(uint8_t enc)
+{
+  size_t n = liveW * liveH;
+  if (enc == LIVE_ENC_PALRLE && !livePal.build(liveScratch, n)) enc = LIVE_ENC_RLE565; // too many colors
+  size_t len = (enc == LIVE_ENC_RGB888) ? 3*n : encodeLive565(nullptr, liveScratch, n, enc, &livePal);
+  AsyncWebSocketMessageBuffer * wsBuf = ws.makeBuffer(LIVE_HDR_SIZE + len);
+  if (!wsBuf) return nullptr; //out of memory
+  uint8_t* buffer = wsBuf->get();
+  writeLiveHeader(buffer, enc, liveStep, liveW, liveH);
+  if (enc == LIVE_ENC_RGB888) {
+    for (size_t i = 0, pos = LIVE_HDR_SIZE; i < n; i++) {
+      uint32_t c = getLivePixel(i);
+      buffer[pos++] = R(c);
+      buffer[pos++] = G(c);
+      buffer[pos++] = B(c);
+    }
+  } else
+    encodeLive565(buffer + LIVE_HDR_SIZE, liveScratch, n, enc, &livePal);
+  return wsBuf;
+}
+
+// snapshot of sampled frame as RGB565, shared by all 565 based encodings
+static bool fillLiveScratch()
+{
+  size_t n = liveW * liveH;
+  if (n > liveScratchSize) {
+    if (liveScratch) free(liveScratch);
+    liveScratch = (uint16_t*) malloc(n * sizeof(uint16_t));
+    liveScratchSize = liveScratch ? n : 0;
+    if (!liveScratch) return false;
+  }
+  for (size_t i = 0; i < n; i++) {
+    uint32_t c = getLivePixel(i);
+    liveScratch[i] = toRGB565(R(c), G(c), B(c));
+  }
   return true;
 }
 
+static void sendLiveFramesWs(unsigned long now)
+{
+  AsyncWebSocketMessageBuffer *frames[LIVE_ENC_LEGACY+1] = {nullptr};
+  bool sampled = false, scratch = false;
+
+  for (size_t i = 0; i < WS_MAX_LIVE_CLIENTS; i++) {
+    LiveClient &lc = wsLiveClients[i];
+    if (!lc.id || now - lc.lastSent < lc.interval) continue;
+    AsyncWebSocketClient * wsc = ws.client(lc.id);
+    if (!wsc) { lc.id = 0; continue; }
+    if (wsc->queueLength() > 0) continue; // previous frame not sent yet, skip this one
+    uint8_t e = lc.enc;
+    if (!frames[e]) {
+      if (e == LIVE_ENC_LEGACY) frames[e] = makeLegacyLiveBuffer();
+      else {
+        if (!sampled) { setupLiveSampling(); sampled = true; }
+        if (e != LIVE_ENC_RGB888 && !scratch) {
+          scratch = fillLiveScratch();
+          if (!scratch) continue; // out of memory
+        }
+        frames[e] = makeLiveBuffer(e);
+      }
+      if (!frames[e]) continue; // out of memory
+      frames[e]->lock();
+    }
+    wsc->binary(frames[e]);
+    lc.lastSent = now;
+  }
+
+  bool sent = false;
+  for (size_t e = 0; e <= LIVE_ENC_LEGACY; e++) if (frames[e]) { frames[e]->unlock(); sent = true; }
+  if (sent) ws._cleanBuffers();
+}
+
 void handleWs()
 {
-  if (millis() - wsLastLiveTime > WS_LIVE_INTERVAL)
+  unsigned long now = millis();
+  if (now - wsLastCleanupTime > WS_LIVE_INTERVAL)
   {
     #ifdef ESP8266
     ws.cleanupClients(3);
     #else
     ws.cleanupClients();
     #endif
-    bool success = true;
-    if (wsLiveClientId) success = sendLiveLedsWs(wsLiveClientId);
-    wsLastLiveTime = millis();
-    if (!success) wsLastLiveTime -= 20; //try again in 20ms if failed due to non-empty WS queue
+    wsLastCleanupTime = now;
+  }
+  sendLiveFramesWs(now);
+  if (millis() - wsDeltaInfoTime > WS_DELTA_INFO_INTERVAL) {
+    wsDeltaInfoTime = millis();
+    if (wsTrackedClients(true)) sendDeltaInfoWs();
   }
 }
 
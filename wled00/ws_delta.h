@@ -0,0 +1,101 @@
+#ifndef WLED_WS_DELTA_H
+#define WLED_WS_DELTA_H
+
+/*
+ * Delta state push over WebSocket (ws.cpp): reduces a serialized state to what changed since the last push.
+ * Changes are detected with FNV-1a hashes of each top-level key and each segment, no copy of the state is kept.
+ * Removed keys are sent as "key":null, removed segments as {"id":x,"stop":0}.
+ * Free of Arduino calls so deltas can be replayed against snapshots on the host.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#define WS_DELTA_MAX_KEYS      24
+#define WS_DELTA_KEY_LEN       16 // longer keys are not tracked and always sent
+
+// FNV-1a hash of serialized JSON (ArduinoJson custom writer)
+class JsonHashWriter {
+  public:
+    uint32_t hash = 2166136261UL;
+    size_t write(uint8_t c) { hash = (hash ^ c) * 16777619UL; return 1; }
+    size_t write(const uint8_t *buffer, size_t size) { for (size_t i = 0; i < size; i++) write(buffer[i]); return size; }
+};
+
+template<size_t SEGMENTS> class WsDeltaState {
+  char     _keys[WS_DELTA_MAX_KEYS][WS_DELTA_KEY_LEN] = {{0}}; // "" = free slot
+  uint32_t _valHash[WS_DELTA_MAX_KEYS] = {0}; // 0 = unknown, always sent
+  uint32_t _segHash[SEGMENTS] = {0};          // 0 = segment not present, 1 = unknown
+
+  static uint32_t hashJson(JsonVariantConst v) {
+    JsonHashWriter h;
+    serializeJson(v, h);
+    return h.hash > 1 ? h.hash : 2; // 0 and 1 are reserved
+  }
+
+  public:
+    // next reduce() keeps everything (a subscriber got a snapshot and may be ahead of the others)
+    void invalidate() {
+      for (size_t i = 0; i < WS_DELTA_MAX_KEYS; i++) _valHash[i] = 0;
+      for (size_t id = 0; id < SEGMENTS; id++) if (_segHash[id]) _segHash[id] = 1;
+    }
+
+    // removes state keys and segments which did not change since the last call and adds removed ones,
+    // returns false if nothing is left
+    bool reduce(JsonObject state) {
+      const char *unchanged[WS_DELTA_MAX_KEYS];
+      size_t nUnchanged = 0;
+      bool seen[WS_DELTA_MAX_KEYS] = {false};
+
+      for (JsonPair kv : state) {
+        const char *key = kv.key().c_str();
+        if (!strcmp(key, "seg")) continue;
+        uint32_t v = hashJson(kv.value());
+        int8_t slot = -1;
+        for (size_t i = 0; i < WS_DELTA_MAX_KEYS; i++) if (!strcmp(_keys[i], key)) { slot = i; break; }
+        if (slot < 0 && strlen(key) < WS_DELTA_KEY_LEN) for (size_t i = 0; i < WS_DELTA_MAX_KEYS; i++) if (!_keys[i][0]) {
+          slot = i;
+          strcpy(_keys[i], key);
+          _valHash[i] = 0;
+          break;
+        }
+        if (slot < 0) continue; // table full or key too long, key is always sent
+        seen[slot] = true;
+        if (_valHash[slot] == v) {
+          if (nUnchanged < WS_DELTA_MAX_KEYS) unchanged[nUnchanged++] = key;
+        } else
+          _valHash[slot] = v;
+      }
+      for (size_t i = 0; i < WS_DELTA_MAX_KEYS; i++) {
+        if (!_keys[i][0] || seen[i]) continue;
+        state[(char*)_keys[i]] = nullptr; // key was removed (name is copied, slot is freed)
+        _keys[i][0] = 0;
+      }
+      for (size_t i = 0; i < nUnchanged; i++) state.remove(unchanged[i]);
+
+      JsonArray segs = state["seg"];
+      bool present[SEGMENTS] = {false};
+      for (int i = segs.size()-1; i >= 0; i--) {
+        JsonObject sg = segs[i];
+        uint8_t id = sg["id"] | 255;
+        if (id >= SEGMENTS) continue;
+        present[id] = true;
+        uint32_t h = hashJson(sg);
+        if (_segHash[id] == h) segs.remove(i);
+        else _segHash[id] = h;
+      }
+      for (size_t id = 0; id < SEGMENTS; id++) {
+        if (!_segHash[id] || present[id]) continue;
+        if (segs.isNull()) segs = state.createNestedArray("seg");
+        JsonObject sg = segs.createNestedObject(); // segment was deleted
+        sg["id"]   = id;
+        sg["stop"] = 0;
+        _segHash[id] = 0;
+      }
+      if (segs.size() == 0) state.remove("seg");
+
+      return state.size() > 0;
+    }
+};
+
+#endif
@@ -131,7 +131,7 @@ void appendGPIOinfo() {
     oappend(","); oappend(itoa(spi_sclk,nS,10));
   }
   // usermod pin reservations will become unnecessary when settings pages will read cfg.json directly
-  if (requestJSONBufferLock(6)) {
+  if (requestJSONBufferLock(6, JSON_PRIO_NET)) {
     // if we can't allocate JSON buffer ignore usermod pins
     JsonObject mods = doc.createNestedObject(F("um"));
     usermods.addToConfig(mods);
@@ -372,6 +372,7 @@ void getSettingsJS(byte subPage, char* dest)
       char aw[4] = "AW"; aw[2] = 48+s; aw[3] = 0; //auto white mode
       char wo[4] = "WO"; wo[2] = 48+s; wo[3] = 0; //swap channels
       char sp[4] = "SP"; sp[2] = 48+s; sp[3] = 0; //bus clock speed
+      char nf[4] = "NF"; nf[2] = 48+s; nf[3] = 0; //max. fps (network)
       oappend(SET_F("addLEDs(1);"));
       uint8_t pins[5];
       uint8_t nPins = bus->getPins(pins);
@@ -409,6 +410,7 @@ void getSettingsJS(byte subPage, char* dest)
         }
       }
       sappend('v',sp,speed);
+      if (bus->getType() >= TYPE_NET_DDP_RGB && bus->getType() < 96) sappend('v',nf,bus->getFrequency());
     }
     sappend('v',SET_F("MA"),strip.ablMilliampsMax);
     sappend('v',SET_F("LA"),strip.milliampsPerLed);